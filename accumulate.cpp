@@ -198,6 +198,93 @@ SegmentAccumulator& SegmentAccumulator::operator+=(const SegmentAccumulator& rhs
     average_phred += rhs.average_phred;
     return *this;
 };
+void SegmentAccumulator::encode_raw(Value& container, Document& document) const {
+    Document::AllocatorType& allocator = document.GetAllocator();
+    container.SetObject();
+    encode_key_value("shortest", shortest, container, document);
+    encode_key_value("capacity", capacity, container, document);
+    encode_key_value("nucleotide count", nucleic_acid_count_by_code, container, document);
+    encode_key_value("average phred count", average_phred.count, container, document);
+    encode_key_value("average phred min", average_phred.min_value, container, document);
+    encode_key_value("average phred max", average_phred.max_value, container, document);
+    encode_key_value("average phred sum", average_phred.sum_value, container, document);
+    encode_key_value("average phred distribution", average_phred.distribution, container, document);
+
+    /* cycle phred distributions are sparse and encoded as [ cycle, nucleotide, phred, count ] */
+    Value cycle_distribution(kArrayType);
+    for(int32_t c(0); c < capacity; ++c) {
+        const CycleAccumulator& cycle(cycle_by_index[c]);
+        for(uint8_t n(0); n < cycle.nucleotide_by_code.size(); ++n) {
+            const vector< uint64_t >& distribution(cycle.nucleotide_by_code[n].distribution);
+            for(uint8_t q(0); q < distribution.size(); ++q) {
+                if(distribution[q] > 0) {
+                    Value record(kArrayType);
+                    record.PushBack(Value(c).Move(), allocator);
+                    record.PushBack(Value(static_cast< uint32_t >(n)).Move(), allocator);
+                    record.PushBack(Value(static_cast< uint32_t >(q)).Move(), allocator);
+                    record.PushBack(Value(distribution[q]).Move(), allocator);
+                    cycle_distribution.PushBack(record.Move(), allocator);
+                }
+            }
+        }
+    }
+    container.AddMember("cycle phred distribution", cycle_distribution.Move(), allocator);
+};
+void SegmentAccumulator::merge_raw(const Value& container) {
+    int32_t other_capacity(0);
+    decode_value_by_key< int32_t >("capacity", other_capacity, container);
+    if(other_capacity > capacity) {
+        cycle_by_index.resize(other_capacity);
+        capacity = other_capacity;
+    }
+    int32_t other_shortest(numeric_limits< int32_t >::max());
+    decode_value_by_key< int32_t >("shortest", other_shortest, container);
+    shortest = min(shortest, other_shortest);
+
+    vector< uint64_t > count;
+    if(decode_value_by_key< vector< uint64_t > >("nucleotide count", count, container)) {
+        if(count.size() != nucleic_acid_count_by_code.size()) {
+            throw ConfigurationError("raw nucleotide count has " + to_string(count.size()) + " elements");
+        }
+        for(size_t n(0); n < count.size(); ++n) {
+            nucleic_acid_count_by_code[n] += count[n];
+        }
+    }
+
+    AveragePhreadAccumulator other;
+    decode_value_by_key< uint64_t >("average phred count", other.count, container);
+    decode_value_by_key< double >("average phred min", other.min_value, container);
+    decode_value_by_key< double >("average phred max", other.max_value, container);
+    decode_value_by_key< double >("average phred sum", other.sum_value, container);
+    if(decode_value_by_key< vector< uint64_t > >("average phred distribution", count, container)) {
+        if(count.size() != other.distribution.size()) {
+            throw ConfigurationError("raw average phred distribution has " + to_string(count.size()) + " elements");
+        }
+        other.distribution = count;
+    }
+    average_phred += other;
+
+    Value::ConstMemberIterator reference = container.FindMember("cycle phred distribution");
+    if(reference != container.MemberEnd() && reference->value.IsArray()) {
+        uint64_t field[4];
+        for(const auto& record : reference->value.GetArray()) {
+            size_t position(0);
+            if(record.IsArray() && record.Size() == 4) {
+                for(const auto& element : record.GetArray()) {
+                    if(element.IsUint64()) {
+                        field[position] = element.GetUint64();
+                        ++position;
+                    } else { break; }
+                }
+            }
+            if(position == 4) {
+                if(field[0] < static_cast< uint64_t >(capacity) && field[1] < IUPAC_CODE_SIZE && field[2] < EFFECTIVE_PHRED_RANGE) {
+                    cycle_by_index[field[0]].nucleotide_by_code[field[1]].distribution[field[2]] += field[3];
+                } else { throw ConfigurationError("raw cycle phred distribution record out of range"); }
+            } else { throw ConfigurationError("raw cycle phred distribution record must be an array of 4 unsigned integers"); }
+        }
+    }
+};
 template<> vector< SegmentAccumulator > decode_value_by_key(const Value::Ch* key, const Value& container) {
     if(!container.IsNull()) {
         Value::ConstMemberIterator reference = container.FindMember(key);
@@ -359,6 +446,55 @@ ChannelAccumulator& ChannelAccumulator::operator+=(const ChannelAccumulator& rhs
     }
     return *this;
 };
+void ChannelAccumulator::encode_raw(Value& container, Document& document) const {
+    container.SetObject();
+    encode_key_value("index", index, container, document);
+    encode_key_value("count", count, container, document);
+    encode_key_value("pf count", pf_count, container, document);
+    encode_key_value("accumulated multiplex distance", accumulated_multiplex_distance, container, document);
+    encode_key_value("accumulated multiplex confidence", accumulated_multiplex_confidence, container, document);
+    encode_key_value("accumulated pf multiplex distance", accumulated_pf_multiplex_distance, container, document);
+    encode_key_value("accumulated pf multiplex confidence", accumulated_pf_multiplex_confidence, container, document);
+    Value segment_array(kArrayType);
+    for(const auto& accumulator : segment_by_index) {
+        Value segment;
+        accumulator.encode_raw(segment, document);
+        segment_array.PushBack(segment.Move(), document.GetAllocator());
+    }
+    container.AddMember("segment", segment_array.Move(), document.GetAllocator());
+};
+void ChannelAccumulator::merge_raw(const Value& container) {
+    uint64_t other_index(0);
+    if(!decode_value_by_key< uint64_t >("index", other_index, container) || other_index != index) {
+        throw ConfigurationError("raw channel " + to_string(other_index) + " does not match channel " + to_string(index));
+    }
+    uint64_t counter(0);
+    double accumulator(0);
+    if(decode_value_by_key< uint64_t >("count", counter, container)) {
+        count += counter;
+    }
+    if(decode_value_by_key< uint64_t >("pf count", counter, container)) {
+        pf_count += counter;
+    }
+    if(decode_value_by_key< uint64_t >("accumulated multiplex distance", counter, container)) {
+        accumulated_multiplex_distance += counter;
+    }
+    if(decode_value_by_key< double >("accumulated multiplex confidence", accumulator, container)) {
+        accumulated_multiplex_confidence += accumulator;
+    }
+    if(decode_value_by_key< uint64_t >("accumulated pf multiplex distance", counter, container)) {
+        accumulated_pf_multiplex_distance += counter;
+    }
+    if(decode_value_by_key< double >("accumulated pf multiplex confidence", accumulator, container)) {
+        accumulated_pf_multiplex_confidence += accumulator;
+    }
+    const Value& segment_array(find_value_by_key("segment", container));
+    if(segment_array.IsArray() && segment_array.Size() == segment_by_index.size()) {
+        for(size_t i(0); i < segment_by_index.size(); ++i) {
+            segment_by_index[i].merge_raw(segment_array[static_cast< SizeType >(i)]);
+        }
+    } else { throw ConfigurationError("raw channel " + to_string(index) + " segment count does not match the configuration"); }
+};
 template<> vector< ChannelAccumulator > decode_value_by_key(const Value::Ch* key, const Value& container) {
     vector< ChannelAccumulator > value;
     Value::ConstMemberIterator reference = container.FindMember(key);
@@ -456,6 +592,33 @@ InputAccumulator& InputAccumulator::operator+=(const InputAccumulator& rhs) {
     }
     return *this;
 };
+void InputAccumulator::encode_raw(Value& container, Document& document) const {
+    container.SetObject();
+    encode_key_value("count", count, container, document);
+    encode_key_value("pf count", pf_count, container, document);
+    Value segment_array(kArrayType);
+    for(const auto& accumulator : segment_by_index) {
+        Value segment;
+        accumulator.encode_raw(segment, document);
+        segment_array.PushBack(segment.Move(), document.GetAllocator());
+    }
+    container.AddMember("segment", segment_array.Move(), document.GetAllocator());
+};
+void InputAccumulator::merge_raw(const Value& container) {
+    uint64_t counter(0);
+    if(decode_value_by_key< uint64_t >("count", counter, container)) {
+        count += counter;
+    }
+    if(decode_value_by_key< uint64_t >("pf count", counter, container)) {
+        pf_count += counter;
+    }
+    const Value& segment_array(find_value_by_key("segment", container));
+    if(segment_array.IsArray() && segment_array.Size() == segment_by_index.size()) {
+        for(size_t i(0); i < segment_by_index.size(); ++i) {
+            segment_by_index[i].merge_raw(segment_array[static_cast< SizeType >(i)]);
+        }
+    } else { throw ConfigurationError("raw input segment count does not match the configuration"); }
+};
 bool encode_key_value(const string& key, const InputAccumulator& value, Value& container, Document& document) {
     if(container.IsObject()) {
         Value element(kObjectType);
@@ -554,6 +717,27 @@ OutputAccumulator& OutputAccumulator::operator+=(const OutputAccumulator& rhs) {
     }
     return *this;
 };
+void OutputAccumulator::encode_raw(Value& container, Document& document) const {
+    container.SetObject();
+    Value element;
+    undetermined.encode_raw(element, document);
+    container.AddMember("undetermined", element.Move(), document.GetAllocator());
+    Value channel_array(kArrayType);
+    for(const auto& channel : channel_by_index) {
+        channel.encode_raw(element, document);
+        channel_array.PushBack(element.Move(), document.GetAllocator());
+    }
+    container.AddMember("channel", channel_array.Move(), document.GetAllocator());
+};
+void OutputAccumulator::merge_raw(const Value& container) {
+    undetermined.merge_raw(find_value_by_key("undetermined", container));
+    const Value& channel_array(find_value_by_key("channel", container));
+    if(channel_array.IsArray() && channel_array.Size() == channel_by_index.size()) {
+        for(size_t i(0); i < channel_by_index.size(); ++i) {
+            channel_by_index[i].merge_raw(channel_array[static_cast< SizeType >(i)]);
+        }
+    } else { throw ConfigurationError("raw channel count does not match the configuration"); }
+};
 bool encode_key_value(const string& key, const OutputAccumulator& value, Value& container, Document& document) {
     if(container.IsObject()) {
         Value element(kObjectType);
@@ -36,6 +36,13 @@ class ChannelAccumulator;
 class PipelineAccumulator;
 class OutputAccumulator;
 
+/*  Raw accumulator state
+
+    A finalized report holds statistics, such as quantiles and means, that can not be combined.
+    encode_raw writes the counters and distributions those statistics are computed from and
+    merge_raw adds a previously encoded state to an accumulator, so the reports of several
+    shards of the same input can be merged into the report a single run would have produced.
+*/
 class NucleotideAccumulator {
     public:
         uint64_t count;
@@ -123,8 +130,9 @@ class AveragePhreadAccumulator {
         inline void increment(const Segment& segment) {
             ++count;
             double value(0);
+            const uint8_t* quality(segment.packed() ? bam_get_qual(segment.record) : segment.quality);
             for(int32_t i(0); i < segment.length; ++i) {
-                value += segment.quality[i];
+                value += quality[i];
             }
             value /= double(segment.length);
             sum_value += value;
@@ -170,15 +178,28 @@ class SegmentAccumulator {
             if(segment.length < shortest) {
                 shortest = segment.length;
             }
-            for(int32_t i(0); i < segment.length; ++i) {
-                ++(nucleic_acid_count_by_code[NO_NUCLEOTIDE]);
-                ++(nucleic_acid_count_by_code[segment.code[i]]);
-                cycle_by_index[i].increment(segment.code[i], segment.quality[i]);
+            if(segment.packed()) {
+                const uint8_t* code(bam_get_seq(segment.record));
+                const uint8_t* quality(bam_get_qual(segment.record));
+                for(int32_t i(0); i < segment.length; ++i) {
+                    const uint8_t nucleotide(bam_seqi(code, i));
+                    ++(nucleic_acid_count_by_code[NO_NUCLEOTIDE]);
+                    ++(nucleic_acid_count_by_code[nucleotide]);
+                    cycle_by_index[i].increment(nucleotide, quality[i]);
+                }
+            } else {
+                for(int32_t i(0); i < segment.length; ++i) {
+                    ++(nucleic_acid_count_by_code[NO_NUCLEOTIDE]);
+                    ++(nucleic_acid_count_by_code[segment.code[i]]);
+                    cycle_by_index[i].increment(segment.code[i], segment.quality[i]);
+                }
             }
             average_phred.increment(segment);
         };
         void finalize();
         SegmentAccumulator& operator+=(const SegmentAccumulator& rhs);
+        void encode_raw(Value& container, Document& document) const;
+        void merge_raw(const Value& container);
 };
 bool encode_value(const SegmentAccumulator& value, Value& container, Document& document);
 
@@ -233,12 +254,17 @@ class ChannelAccumulator {
                     accumulated_pf_multiplex_confidence += read.multiplex_decoding_confidence;
                 }
             }
-            for(size_t i(0); i < segment_by_index.size(); ++i) {
-                segment_by_index[i].increment(read[i]);
+            /* segment statistics are only reported with quality control and forwarded segments are not decoded */
+            if(!disable_quality_control) {
+                for(size_t i(0); i < segment_by_index.size(); ++i) {
+                    segment_by_index[i].increment(read[i]);
+                }
             }
         };
         void finalize(const OutputAccumulator& decoder_accumulator);
         ChannelAccumulator& operator+=(const ChannelAccumulator& rhs);
+        void encode_raw(Value& container, Document& document) const;
+        void merge_raw(const Value& container);
 };
 template<> vector< ChannelAccumulator > decode_value_by_key(const Value::Ch* key, const Value& container);
 bool encode_value(const ChannelAccumulator& value, Value& container, Document& document);
@@ -257,12 +283,17 @@ class InputAccumulator {
             if(!read.qcfail()) {
                 ++pf_count;
             }
-            for(size_t i(0); i < segment_by_index.size(); ++i) {
-                segment_by_index[i].increment(read[i]);
+            /* segment statistics are only reported with quality control and forwarded segments are not decoded */
+            if(!disable_quality_control) {
+                for(size_t i(0); i < segment_by_index.size(); ++i) {
+                    segment_by_index[i].increment(read[i]);
+                }
             }
         };
         void finalize();
         InputAccumulator& operator+=(const InputAccumulator& rhs);
+        void encode_raw(Value& container, Document& document) const;
+        void merge_raw(const Value& container);
 };
 bool encode_key_value(const string& key, const InputAccumulator& value, Value& container, Document& document);
 
@@ -298,6 +329,8 @@ class OutputAccumulator {
         };
         void finalize();
         OutputAccumulator& operator+=(const OutputAccumulator& rhs);
+        void encode_raw(Value& container, Document& document) const;
+        void merge_raw(const Value& container);
 };
 bool encode_key_value(const string& key, const OutputAccumulator& value, Value& container, Document& document);
 
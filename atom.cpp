@@ -321,6 +321,7 @@ void to_string(const Algorithm& value, string& result) {
         case Algorithm::NAIVE:        result.assign("naive");      break;
         case Algorithm::PIPE:         result.assign("pipe");       break;
         case Algorithm::BENCHMARK:    result.assign("benchmark");  break;
+        case Algorithm::DIRECTIONAL:  result.assign("directional"); break;
         default:                                                   break;
     }
 };
@@ -331,6 +332,7 @@ bool from_string(const char* value, Algorithm& result) {
     else if(!strcmp(value, "naive"))        result = Algorithm::NAIVE;
     else if(!strcmp(value, "pipe"))         result = Algorithm::PIPE;
     else if(!strcmp(value, "benchmark"))    result = Algorithm::BENCHMARK;
+    else if(!strcmp(value, "directional"))  result = Algorithm::DIRECTIONAL;
     else                                    result = Algorithm::UNKNOWN;
 
     return (result == Algorithm::UNKNOWN ? false : true);
@@ -381,16 +383,19 @@ template <> Algorithm decode_value_by_key(const Value::Ch* key, const Value& con
 HeadHDAtom::HeadHDAtom() :
     VN({ 0, 0, NULL }),
     SO({ 0, 0, NULL }),
-    GO({ 0, 0, NULL }) {
+    GO({ 0, 0, NULL }),
+    SS({ 0, 0, NULL }) {
 };
 HeadHDAtom::HeadHDAtom(const Value& ontology) try :
     VN({ 0, 0, NULL }),
     SO({ 0, 0, NULL }),
-    GO({ 0, 0, NULL }) {
+    GO({ 0, 0, NULL }),
+    SS({ 0, 0, NULL }) {
 
     decode_value_by_key< kstring_t >("VN", VN, ontology);
     decode_value_by_key< kstring_t >("SO", SO, ontology);
     decode_value_by_key< kstring_t >("GO", GO, ontology);
+    decode_value_by_key< kstring_t >("SS", SS, ontology);
 
     } catch(ConfigurationError& error) {
         throw ConfigurationError("HeadHDAtom :: " + error.message);
@@ -402,15 +407,18 @@ HeadHDAtom::HeadHDAtom(const Value& ontology) try :
 HeadHDAtom::HeadHDAtom(const HeadHDAtom& other) :
     VN({ 0, 0, NULL }),
     SO({ 0, 0, NULL }),
-    GO({ 0, 0, NULL }){
+    GO({ 0, 0, NULL }),
+    SS({ 0, 0, NULL }) {
     if(!ks_empty(other.VN)) ks_put_string(other.VN, VN);
     if(!ks_empty(other.SO)) ks_put_string(other.SO, SO);
     if(!ks_empty(other.GO)) ks_put_string(other.GO, GO);
+    if(!ks_empty(other.SS)) ks_put_string(other.SS, SS);
 };
 HeadHDAtom::~HeadHDAtom() {
     ks_free(VN);
     ks_free(SO);
     ks_free(GO);
+    ks_free(SS);
 };
 HeadHDAtom& HeadHDAtom::operator=(const HeadHDAtom& other) {
     if(&other == this) {
@@ -419,9 +427,11 @@ HeadHDAtom& HeadHDAtom::operator=(const HeadHDAtom& other) {
         ks_clear(VN);
         ks_clear(SO);
         ks_clear(GO);
+        ks_clear(SS);
         if(!ks_empty(other.VN)) ks_put_string(other.VN, VN);
         if(!ks_empty(other.SO)) ks_put_string(other.SO, SO);
         if(!ks_empty(other.GO)) ks_put_string(other.GO, GO);
+        if(!ks_empty(other.SS)) ks_put_string(other.SS, SS);
     }
     return *this;
 };
@@ -439,6 +449,10 @@ void HeadHDAtom::encode(kstring_t& buffer) const {
         ks_put_string_("\tGO:", 4, buffer);
         ks_put_string_(GO, buffer);
     }
+    if(!ks_empty(SS)) {
+        ks_put_string_("\tSS:", 4, buffer);
+        ks_put_string_(SS, buffer);
+    }
     ks_put_character(LINE_BREAK, buffer);
 };
 char* HeadHDAtom::decode(char* position, const char* end) {
@@ -459,6 +473,10 @@ char* HeadHDAtom::decode(char* position, const char* end) {
                 position = copy_until_tag_end(position, end, GO);
                 break;
             };
+            case uint16_t(HtsTagCode::SS): {
+                position = copy_until_tag_end(position, end, SS);
+                break;
+            };
             default:
                 position = skip_to_tab(position, end);
                 break;
@@ -472,6 +490,10 @@ void HeadHDAtom::set_alignment_sort_order(const HtsSortOrder& order) {
 void HeadHDAtom::set_alignment_grouping(const HtsGrouping& grouping) {
     to_kstring(grouping, GO);
 };
+void HeadHDAtom::set_alignment_subsort(const string& subsort) {
+    ks_clear(SS);
+    ks_put_string(subsort.c_str(), subsort.size(), SS);
+};
 void HeadHDAtom::set_version(const htsFormat* format) {
     ks_clear(VN);
     if(format != NULL) {
@@ -484,6 +506,7 @@ ostream& operator<<(ostream& o, const HeadHDAtom& hd) {
     if(!ks_empty(hd.VN)) o << "VN : " << hd.VN.s << endl;
     if(!ks_empty(hd.SO)) o << "SO : " << hd.SO.s << endl;
     if(!ks_empty(hd.GO)) o << "GO : " << hd.GO.s << endl;
+    if(!ks_empty(hd.SS)) o << "SS : " << hd.SS.s << endl;
     return o;
 };
 
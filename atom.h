@@ -45,6 +45,9 @@ enum class HtsTagCode : uint16_t;
             none
             query       grouped by QNAME
             reference   grouped by RNAME/POS
+    SS  Sub sorting order of alignments
+        The major sort order followed by one or more colon separated sub sort keys,
+        for instance unsorted:CB when records are only grouped by cellular barcode.
 */
 class HeadHDAtom {
     friend class HtsHeader;
@@ -54,6 +57,7 @@ class HeadHDAtom {
         kstring_t VN;
         kstring_t SO;
         kstring_t GO;
+        kstring_t SS;
 
         HeadHDAtom();
         HeadHDAtom(const Value& ontology);
@@ -61,6 +65,7 @@ class HeadHDAtom {
         ~HeadHDAtom();
         void set_alignment_sort_order(const HtsSortOrder& order);
         void set_alignment_grouping(const HtsGrouping& grouping);
+        void set_alignment_subsort(const string& subsort);
         void set_version(const htsFormat* format);
         HeadHDAtom& operator=(const HeadHDAtom& other);
 
@@ -343,6 +348,7 @@ enum class Algorithm : uint8_t {
     NAIVE,
     PIPE,
     BENCHMARK,
+    DIRECTIONAL,
 };
 void to_string(const Algorithm& value, string& result);
 bool from_string(const char* value, Algorithm& result);
@@ -447,6 +453,7 @@ enum class HtsTagCode : uint16_t {
     SO = 0x534f,
     SP = 0x5350,
     SQ = 0x5351,
+    SS = 0x5353,
     TC = 0x5443,
     U2 = 0x5532,
     UQ = 0x5551,
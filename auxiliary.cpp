@@ -374,6 +374,70 @@ void Auxiliary::encode(bam1_t* bam1) const {
         #endif
     }
 };
+/*  append the tags to a record that already has an auxiliary block.
+    tags in the record that encode is about to write are removed first, every other tag is kept in place */
+void Auxiliary::augment(bam1_t* bam1) const {
+    if(bam1 != NULL) {
+        uint8_t* target(bam_get_aux(bam1));
+        const uint8_t* position(target);
+        const uint8_t* next(target);
+        const uint8_t* const end(bam1->data + bam1->l_data);
+        while(end - next >= 4) {
+            position = next;
+            if((next = skip_aux(position + 2, end)) != NULL) {
+                if(!assigns(tag_to_code(position))) {
+                    if(target != position) {
+                        memmove(target, position, next - position);
+                    }
+                    target += next - position;
+                }
+            } else {
+                throw CorruptAuxiliaryError("corrupted aux in " + string(bam_get_qname(bam1)));
+            }
+        }
+        bam1->l_data = static_cast< int >(target - bam1->data);
+        encode(bam1);
+    }
+};
+bool Auxiliary::assigns(const uint16_t& code) const {
+    switch(code) {
+        case uint16_t(HtsTagCode::FI):  return TC > 2 && FI > 0;
+        case uint16_t(HtsTagCode::TC):  return TC > 2;
+        case uint16_t(HtsTagCode::FS):  return !ks_empty(FS);
+        case uint16_t(HtsTagCode::RG):  return !ks_empty(RG);
+        case uint16_t(HtsTagCode::PU):  return !ks_empty(PU);
+        case uint16_t(HtsTagCode::LB):  return !ks_empty(LB);
+        case uint16_t(HtsTagCode::PG):  return !ks_empty(PG);
+        case uint16_t(HtsTagCode::CO):  return !ks_empty(CO);
+
+        case uint16_t(HtsTagCode::BC):  return !ks_empty(BC);
+        case uint16_t(HtsTagCode::QT):  return !ks_empty(QT);
+        case uint16_t(HtsTagCode::XB):  return XB > 0;
+
+        case uint16_t(HtsTagCode::RX):  return !ks_empty(RX);
+        case uint16_t(HtsTagCode::QX):  return !ks_empty(QX);
+        case uint16_t(HtsTagCode::OX):  return !ks_empty(OX);
+        case uint16_t(HtsTagCode::BZ):  return !ks_empty(BZ);
+        case uint16_t(HtsTagCode::MI):  return !ks_empty(MI);
+        case uint16_t(HtsTagCode::XM):  return XM > 0;
+
+        case uint16_t(HtsTagCode::CB):  return !ks_empty(CB);
+        case uint16_t(HtsTagCode::CR):  return !ks_empty(CR);
+        case uint16_t(HtsTagCode::CY):  return !ks_empty(CY);
+        case uint16_t(HtsTagCode::XC):  return XC > 0;
+
+        case uint16_t(HtsTagCode::EE):  return EE > 0;
+
+        default:
+            #if defined(PHENIQS_EXTENDED_SAM_TAG)
+            {
+                auto record(extended.find(code));
+                return record != extended.end() && !record->second.empty();
+            }
+            #endif
+            return false;
+    }
+};
 ostream& operator<<(ostream& o, const Auxiliary& auxiliary) {
     if(auxiliary.FI   > 0)      o << "FI : " << auxiliary.FI   << endl;
     if(auxiliary.TC   > 0)      o << "TC : " << auxiliary.TC   << endl;
@@ -195,6 +195,8 @@ class Auxiliary {
         ~Auxiliary();
         void decode(const bam1_t* bam1);
         void encode(bam1_t* bam1) const;
+        void augment(bam1_t* bam1) const;
+        bool assigns(const uint16_t& code) const;
 
         inline void set_RG(const HeadRGAtom& rg) {
             if(!ks_empty(rg.ID)) ks_put_string(rg.ID, RG);
@@ -227,6 +229,19 @@ class Auxiliary {
             }
             observation.encode_iupac_ambiguity(CB);
         };
+        inline void update_cellular_barcode(const uint8_t* code, const int32_t& length) {
+            if(CB.l > 0) {
+                ks_put_character('-', CB);
+            }
+            if(length > 0) {
+                ks_increase_by_size(CB, length + 2);
+                for(int32_t i(0); i < length; ++i) {
+                    CB.s[CB.l + i] = BamToAmbiguousAscii[code[i]];
+                }
+                CB.l += length;
+                ks_terminate(CB);
+            }
+        };
         inline void update_raw_cellular_barcode(const Observation& observation) {
             if(CR.l > 0) {
                 ks_put_character('-', CR);
@@ -250,6 +265,12 @@ class Auxiliary {
             observation.encode_iupac_ambiguity(RX);
             observation.encode_phred_quality(QX, SAM_PHRED_DECODING_OFFSET);
         };
+        inline void update_molecular_quality(const Observation& observation) {
+            if(QX.l > 0) {
+                ks_put_character(' ', QX);
+            }
+            observation.encode_phred_quality(QX, SAM_PHRED_DECODING_OFFSET);
+        };
         inline void update_raw_molecular_barcode(const Observation& observation) {
             if(OX.l > 0) {
                 ks_put_character('-', OX);
@@ -258,6 +279,12 @@ class Auxiliary {
             observation.encode_iupac_ambiguity(OX);
             observation.encode_phred_quality(BZ, SAM_PHRED_DECODING_OFFSET);
         };
+        inline void update_molecular_identifier(const string& identifier) {
+            if(MI.l > 0) {
+                ks_put_character('-', MI);
+            }
+            ks_put_string(identifier, MI);
+        };
 
         inline void clear() {
             /* FI and TC don't change during demultiplexing */
@@ -0,0 +1,42 @@
+/*
+    Pheniqs : PHilology ENcoder wIth Quality Statistics
+    Copyright (C) 2018  Lior Galanti
+    NYU Center for Genetics and System Biology
+
+    Author: Lior Galanti <lior.galanti@nyu.edu>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PHENIQS_BACKEND_H
+#define PHENIQS_BACKEND_H
+
+#include "include.h"
+
+/*  The hFILE backend interface is declared in hfile_internal.h, which htslib does not install.
+    It has not changed since htslib 1.3 and is the same interface the htslib plugins implement.
+    A backend embeds hFILE as the first member of its own structure allocated with hfile_init */
+extern "C" {
+    struct hFILE_backend {
+        ssize_t (*read)(hFILE* fp, void* buffer, size_t nbytes);
+        ssize_t (*write)(hFILE* fp, const void* buffer, size_t nbytes);
+        off_t (*seek)(hFILE* fp, off_t offset, int whence);
+        int (*flush)(hFILE* fp);
+        int (*close)(hFILE* fp);
+    };
+    hFILE* hfile_init(size_t struct_size, const char* mode, size_t capacity);
+    void hfile_destroy(hFILE* fp);
+}
+
+#endif /* PHENIQS_BACKEND_H */
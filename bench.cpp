@@ -0,0 +1,938 @@
+/*
+    Pheniqs : PHilology ENcoder wIth Quality Statistics
+    Copyright (C) 2018  Lior Galanti
+    NYU Center for Genetics and System Biology
+
+    Author: Lior Galanti <lior.galanti@nyu.edu>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*  Pheniqs benchmark harness
+
+    Generates synthetic reads with a configurable barcode error profile, codec size and segment layout
+    and times every stage of the demultiplexing hot path in isolation followed by a comparison of
+    BGZF and zstd compression over a range of levels, an end to end multi threaded scaling run
+    and end to end runs writing BAM output at several compression levels.
+    Results are written as JSON so regressions can be tracked across commits.
+    Built and executed with `make bench`.
+*/
+
+#include "include.h"
+#include "environment.h"
+
+static inline double elapsed_seconds(const steady_clock::time_point& begin) {
+    return duration< double >(steady_clock::now() - begin).count();
+};
+static vector< uint64_t > decode_cardinality_list(const string& value) {
+    vector< uint64_t > result;
+    size_t position(0);
+    while(position < value.size()) {
+        size_t end(value.find(',', position));
+        if(end == string::npos) {
+            end = value.size();
+        }
+        if(end > position) {
+            result.push_back(stoull(value.substr(position, end - position)));
+        }
+        position = end + 1;
+    }
+    return result;
+};
+
+/*  HtsFeed that exposes the protected segment to bam1_t encoder
+    so BAM encoding can be measured without opening a file */
+class BenchmarkHtsFeed : public HtsFeed {
+    public:
+        BenchmarkHtsFeed(const FeedProxy& proxy) :
+            HtsFeed(proxy) {
+        };
+        inline void encode_segment(bam1_t* record, const Segment& segment) const {
+            encode(record, segment);
+        };
+};
+
+class Benchmark {
+    Benchmark(Benchmark const &) = delete;
+    void operator=(Benchmark const &) = delete;
+
+    public:
+        Benchmark(const int argc, const char** argv);
+        ~Benchmark();
+        void execute();
+        void print_report() const;
+
+    private:
+        const string application_name;
+        const uint8_t phred_offset;
+        string output_path;
+        string directory;
+        uint64_t read_cardinality;
+        uint64_t pool_cardinality;
+        uint64_t decoding_budget;
+        uint64_t seed;
+        int32_t template_length;
+        int32_t template_segment_cardinality;
+        int32_t barcode_segment_cardinality;
+        int32_t barcode_length;
+        double substitution_rate;
+        double noise;
+        vector< uint64_t > codec_cardinality_array;
+        vector< uint64_t > thread_cardinality_array;
+        uint64_t scaling_codec_cardinality;
+        bool keep;
+        bool help;
+        bool owns_directory;
+        mt19937_64 generator;
+        uniform_real_distribution< double > uniform;
+        int32_t segment_barcode_length;
+        vector< vector< string > > codec;
+        vector< string > input_path;
+        string instruction_path;
+        list< string > created;
+        Document report;
+        Value stage_array;
+        Value scaling_array;
+        Value compression_array;
+        Value output_compression_array;
+        void parse(const int argc, const char** argv);
+        void print_help(ostream& o) const;
+        void create_directory();
+        void remove_directory();
+        void generate_input(const uint64_t& codec_cardinality);
+        void write_instruction(const uint64_t& threads, const string& output, const int32_t& compression_level = DEFAULT_COMPRESSION_LEVEL);
+        MultiplexJob* compile_job();
+        uint64_t load_pool(const MultiplexJob& job, list< Read >& pool);
+        void benchmark_codec(const uint64_t& codec_cardinality, const bool& first);
+        void benchmark_scaling();
+        void benchmark_compression();
+        void benchmark_output_compression();
+        void encode_compression(const string& format, const int32_t& level, const uint64_t& size, const uint64_t& compressed_size, const double& compression_time, const double& decompression_time);
+        void encode_stage(const string& name, const uint64_t& codec_cardinality, const uint64_t& count, const double& elapsed);
+        void encode_parameter(Value& container);
+        inline char random_nucleotide() {
+            return "ACGT"[generator() & 3];
+        };
+        inline char substitute_nucleotide(const char& nucleotide) {
+            char result;
+            do {
+                result = random_nucleotide();
+            } while(result == nucleotide);
+            return result;
+        };
+        inline char high_quality() {
+            return static_cast< char >(phred_offset + 30 + generator() % 11);
+        };
+        inline char low_quality() {
+            return static_cast< char >(phred_offset + 2 + generator() % 13);
+        };
+        inline string path_of(const string& name) const {
+            return directory + "/" + name;
+        };
+};
+
+Benchmark::Benchmark(const int argc, const char** argv) try :
+    application_name(argv[0]),
+    phred_offset(33),
+    output_path("-"),
+    directory(getenv("TMPDIR") != NULL ? getenv("TMPDIR") : "/tmp"),
+    read_cardinality(100000),
+    pool_cardinality(4096),
+    decoding_budget(200000000),
+    seed(1),
+    template_length(100),
+    template_segment_cardinality(2),
+    barcode_segment_cardinality(1),
+    barcode_length(8),
+    substitution_rate(0.01),
+    noise(0.02),
+    /*  codec compilation no longer builds a pairwise distance matrix so the sweep
+        keeps the same eightfold step into the tens of thousands */
+    codec_cardinality_array({ 12, 96, 768, 6144, 49152 }),
+    scaling_codec_cardinality(96),
+    keep(false),
+    help(false),
+    owns_directory(false),
+    uniform(0, 1),
+    segment_barcode_length(0),
+    stage_array(kArrayType),
+    scaling_array(kArrayType),
+    compression_array(kArrayType),
+    output_compression_array(kArrayType) {
+
+    report.SetObject();
+    uint64_t hardware_concurrency(max(static_cast< uint64_t >(thread::hardware_concurrency()), static_cast< uint64_t >(1)));
+    for(uint64_t threads(1); threads < hardware_concurrency; threads *= 2) {
+        thread_cardinality_array.push_back(threads);
+    }
+    thread_cardinality_array.push_back(hardware_concurrency);
+    parse(argc, argv);
+
+    } catch(ConfigurationError& error) {
+        throw ConfigurationError("Benchmark :: " + error.message);
+
+    } catch(CommandLineError& error) {
+        throw CommandLineError("Benchmark :: " + error.message);
+
+    } catch(exception& error) {
+        throw CommandLineError("Benchmark :: " + string(error.what()));
+};
+Benchmark::~Benchmark() {
+    /*  directory is the user supplied parent until mkdtemp succeeds and must never be removed */
+    if(!keep && owns_directory) {
+        remove_directory();
+    }
+};
+void Benchmark::parse(const int argc, const char** argv) {
+    for(int i(1); i < argc; ++i) {
+        const string key(argv[i]);
+        if(key == "-h" || key == "--help") {
+            help = true;
+
+        } else if(key == "--keep") {
+            keep = true;
+
+        } else if(key == "--single") {
+            template_segment_cardinality = 1;
+
+        } else if(key == "--paired") {
+            template_segment_cardinality = 2;
+
+        } else {
+            if(i + 1 < argc) {
+                const string value(argv[++i]);
+                if(key == "-o" || key == "--output") {
+                    output_path = value;
+
+                } else if(key == "--directory") {
+                    directory = value;
+
+                } else if(key == "--reads") {
+                    read_cardinality = stoull(value);
+
+                } else if(key == "--pool") {
+                    pool_cardinality = stoull(value);
+
+                } else if(key == "--budget") {
+                    decoding_budget = stoull(value);
+
+                } else if(key == "--seed") {
+                    seed = stoull(value);
+
+                } else if(key == "--read-length") {
+                    template_length = stoi(value);
+
+                } else if(key == "--barcode-segments") {
+                    barcode_segment_cardinality = stoi(value);
+
+                } else if(key == "--barcode-length") {
+                    barcode_length = stoi(value);
+
+                } else if(key == "--substitution-rate") {
+                    substitution_rate = stod(value);
+
+                } else if(key == "--noise") {
+                    noise = stod(value);
+
+                } else if(key == "--codec-size") {
+                    codec_cardinality_array = decode_cardinality_list(value);
+
+                } else if(key == "--threads") {
+                    thread_cardinality_array = decode_cardinality_list(value);
+
+                } else if(key == "--scaling-codec-size") {
+                    scaling_codec_cardinality = stoull(value);
+
+                } else { throw CommandLineError("unknown argument " + key); }
+            } else { throw CommandLineError(key + " expects a value"); }
+        }
+    }
+
+    if(read_cardinality < 1) {
+        throw CommandLineError("read count must be positive");
+    }
+    if(pool_cardinality < 1) {
+        throw CommandLineError("pool size must be positive");
+    }
+    if(template_length < 1) {
+        throw CommandLineError("read length must be positive");
+    }
+    if(barcode_segment_cardinality < 1 || barcode_segment_cardinality > 2) {
+        throw CommandLineError("barcode segments must be 1 or 2");
+    }
+    if(barcode_length < 1) {
+        throw CommandLineError("barcode length must be positive");
+    }
+    if(substitution_rate < 0 || substitution_rate > 1) {
+        throw CommandLineError("substitution rate must be between 0 and 1");
+    }
+    if(noise < 0 || noise > 1) {
+        throw CommandLineError("noise must be between 0 and 1");
+    }
+    for(const auto& cardinality : codec_cardinality_array) {
+        if(cardinality < 1) {
+            throw CommandLineError("codec size must be positive");
+        }
+    }
+    for(const auto& cardinality : thread_cardinality_array) {
+        if(cardinality < 1) {
+            throw CommandLineError("thread count must be positive");
+        }
+    }
+};
+void Benchmark::print_help(ostream& o) const {
+    o << "Usage: " << application_name << " [OPTIONS]" << endl << endl;
+    o << "    -o, --output PATH             Path to write the JSON report, - for stdout. default: -" << endl;
+    o << "    --directory PATH              Directory for synthetic input and output. default: $TMPDIR or /tmp" << endl;
+    o << "    --keep                        Keep the synthetic files when done" << endl;
+    o << "    --reads COUNT                 Synthetic reads generated per codec. default: " << read_cardinality << endl;
+    o << "    --pool COUNT                  Decoded reads held in memory for stage benchmarks. default: " << pool_cardinality << endl;
+    o << "    --budget COUNT                Barcode comparisons allowed per decoder stage. default: " << decoding_budget << endl;
+    o << "    --seed NUMBER                 Random generator seed. default: " << seed << endl;
+    o << "    --single, --paired            Single or paired end template. default: paired" << endl;
+    o << "    --read-length LENGTH          Template segment length. default: " << template_length << endl;
+    o << "    --barcode-segments COUNT      Number of barcode segments, 1 or 2. default: " << barcode_segment_cardinality << endl;
+    o << "    --barcode-length LENGTH       Minimum barcode segment length. default: " << barcode_length << endl;
+    o << "    --substitution-rate RATE      Probability of a substitution in a barcode nucleotide. default: " << substitution_rate << endl;
+    o << "    --noise RATE                  Fraction of reads with a random barcode. default: " << noise << endl;
+    o << "    --codec-size LIST             Comma separated codec sizes. default: 12,96,768,6144,49152" << endl;
+    o << "    --threads LIST                Comma separated thread counts for the scaling benchmark" << endl;
+    o << "    --scaling-codec-size SIZE     Codec size for the scaling benchmark. default: " << scaling_codec_cardinality << endl;
+    o << "    -h, --help                    Show this help" << endl;
+};
+void Benchmark::create_directory() {
+    string pattern(path_of("pheniqs-bench.XXXXXX"));
+    vector< char > buffer(pattern.begin(), pattern.end());
+    buffer.push_back('\0');
+    if(mkdtemp(buffer.data()) != NULL) {
+        directory.assign(buffer.data());
+        owns_directory = true;
+    } else { throw IOError("failed to create a temporary directory in " + directory); }
+};
+void Benchmark::remove_directory() {
+    for(const auto& path : created) {
+        remove(path.c_str());
+    }
+    created.clear();
+    rmdir(directory.c_str());
+};
+void Benchmark::generate_input(const uint64_t& codec_cardinality) {
+    generator.seed(seed + codec_cardinality);
+
+    /*  make the barcode long enough for the codec to be a sparse subset of the word space */
+    int32_t nucleotide_cardinality(1);
+    while(pow(4.0, nucleotide_cardinality) < 16.0 * codec_cardinality) {
+        ++nucleotide_cardinality;
+    }
+    segment_barcode_length = max(barcode_length, (nucleotide_cardinality + barcode_segment_cardinality - 1) / barcode_segment_cardinality);
+
+    codec.clear();
+    codec.reserve(codec_cardinality);
+    set< string > unique;
+    while(codec.size() < codec_cardinality) {
+        vector< string > barcode(barcode_segment_cardinality);
+        string concatenated;
+        for(auto& segment : barcode) {
+            segment.resize(segment_barcode_length);
+            for(auto& nucleotide : segment) {
+                nucleotide = random_nucleotide();
+            }
+            concatenated.append(segment);
+        }
+        if(unique.insert(concatenated).second) {
+            codec.emplace_back(barcode);
+        }
+    }
+
+    /*  segment layout is template, barcode segments and an optional second template */
+    const int32_t segment_cardinality(template_segment_cardinality + barcode_segment_cardinality);
+    vector< ofstream > file_by_segment(segment_cardinality);
+    input_path.clear();
+    for(int32_t i(0); i < segment_cardinality; ++i) {
+        input_path.emplace_back("bench_" + to_string(i) + ".fastq");
+        const string path(path_of(input_path.back()));
+        file_by_segment[i].open(path, ios_base::out | ios_base::trunc);
+        if(!file_by_segment[i].good()) {
+            throw IOError("failed to open " + path + " for writing");
+        }
+        created.push_back(path);
+    }
+
+    uniform_int_distribution< uint64_t > barcode_distribution(0, codec_cardinality - 1);
+    string name;
+    string sequence;
+    string quality;
+    for(uint64_t read(0); read < read_cardinality; ++read) {
+        name.assign("@BENCH:" + to_string(read));
+        const bool random_barcode(uniform(generator) < noise);
+        const vector< string >& barcode(codec[barcode_distribution(generator)]);
+        for(int32_t i(0); i < segment_cardinality; ++i) {
+            sequence.clear();
+            quality.clear();
+            const int32_t barcode_index(i - 1);
+            if(barcode_index >= 0 && barcode_index < barcode_segment_cardinality) {
+                for(const auto& expected : barcode[barcode_index]) {
+                    if(random_barcode) {
+                        sequence.push_back(random_nucleotide());
+                        quality.push_back(high_quality());
+
+                    } else if(uniform(generator) < substitution_rate) {
+                        sequence.push_back(substitute_nucleotide(expected));
+                        quality.push_back(low_quality());
+
+                    } else {
+                        sequence.push_back(expected);
+                        quality.push_back(high_quality());
+                    }
+                }
+            } else {
+                for(int32_t j(0); j < template_length; ++j) {
+                    sequence.push_back(random_nucleotide());
+                    quality.push_back(high_quality());
+                }
+            }
+            ofstream& file(file_by_segment[i]);
+            file << name << '\n' << sequence << "\n+\n" << quality << '\n';
+        }
+    }
+    for(auto& file : file_by_segment) {
+        file.close();
+    }
+};
+void Benchmark::write_instruction(const uint64_t& threads, const string& output, const int32_t& compression_level) {
+    Document instruction(kObjectType);
+    const int32_t segment_cardinality(template_segment_cardinality + barcode_segment_cardinality);
+
+    encode_key_value("base input url", directory, instruction, instruction);
+    encode_key_value("base output url", directory, instruction, instruction);
+    encode_key_value("input", input_path, instruction, instruction);
+    encode_key_value("output", vector< string >({ output }), instruction, instruction);
+    encode_key_value("threads", static_cast< int32_t >(threads), instruction, instruction);
+    if(compression_level != DEFAULT_COMPRESSION_LEVEL) {
+        encode_key_value("compression level", compression_level, instruction, instruction);
+    }
+
+    vector< string > template_token({ "0::" });
+    if(template_segment_cardinality > 1) {
+        template_token.push_back(to_string(segment_cardinality - 1) + "::");
+    }
+    Value template_transform(kObjectType);
+    encode_key_value("token", template_token, template_transform, instruction);
+    instruction.AddMember("transform", template_transform.Move(), instruction.GetAllocator());
+
+    vector< string > barcode_token;
+    for(int32_t i(0); i < barcode_segment_cardinality; ++i) {
+        barcode_token.push_back(to_string(i + 1) + "::" + to_string(segment_barcode_length));
+    }
+
+    Value codec_value(kObjectType);
+    for(size_t i(0); i < codec.size(); ++i) {
+        Value record(kObjectType);
+        encode_key_value("barcode", codec[i], record, instruction);
+        string key("@" + to_string(i));
+        codec_value.AddMember(Value(key.c_str(), key.size(), instruction.GetAllocator()).Move(), record.Move(), instruction.GetAllocator());
+    }
+
+    for(const auto& key : { "multiplex", "cellular" }) {
+        Value decoder(kObjectType);
+        Value transform(kObjectType);
+        encode_key_value("token", barcode_token, transform, instruction);
+        encode_key_value("algorithm", string("pamld"), decoder, instruction);
+        encode_key_value("noise", noise, decoder, instruction);
+        decoder.AddMember("transform", transform.Move(), instruction.GetAllocator());
+        decoder.AddMember("codec", Value(codec_value, instruction.GetAllocator()).Move(), instruction.GetAllocator());
+        instruction.AddMember(Value(key, instruction.GetAllocator()).Move(), decoder.Move(), instruction.GetAllocator());
+    }
+
+    instruction_path = path_of("bench.json");
+    ofstream file(instruction_path, ios_base::out | ios_base::trunc);
+    if(file.good()) {
+        print_json(instruction, file);
+        file.close();
+        created.push_back(instruction_path);
+    } else { throw IOError("failed to open " + instruction_path + " for writing"); }
+};
+MultiplexJob* Benchmark::compile_job() {
+    const char* argv[] = { application_name.c_str(), "demux", "--config", instruction_path.c_str() };
+    Interface interface(4, argv);
+    Document operation(interface.operation());
+    MultiplexJob* job(new MultiplexJob(operation));
+    try {
+        job->assemble();
+        job->compile();
+    } catch(...) {
+        delete job;
+        throw;
+    }
+    return job;
+};
+uint64_t Benchmark::load_pool(const MultiplexJob& job, list< Read >& pool) {
+    const Platform platform(decode_value_by_key< Platform >("platform", job.ontology));
+    const int32_t leading_segment_index(decode_value_by_key< int32_t >("leading segment index", job.ontology));
+    const int32_t input_segment_cardinality(decode_value_by_key< int32_t >("input segment cardinality", job.ontology));
+
+    vector< BGZF* > bgzf_by_segment;
+    vector< kseq_t* > kseq_by_segment;
+    for(const auto& name : input_path) {
+        const string path(path_of(name));
+        BGZF* bgzf(bgzf_open(path.c_str(), "r"));
+        if(bgzf != NULL) {
+            bgzf_by_segment.push_back(bgzf);
+            kseq_by_segment.push_back(kseq_init(bgzf));
+        } else { throw IOError("failed to open " + path + " for reading"); }
+    }
+
+    uint64_t count(0);
+    FastqRecord record;
+    Read input(input_segment_cardinality, platform, leading_segment_index);
+    while(kseq_read(kseq_by_segment[0]) >= 0) {
+        const bool pooled(count < pool_cardinality);
+        if(pooled) {
+            pool.emplace_back(input_segment_cardinality, platform, leading_segment_index);
+        }
+        for(size_t i(0); i < kseq_by_segment.size(); ++i) {
+            if(i > 0 && kseq_read(kseq_by_segment[i]) < 0) {
+                throw SequenceError("synthetic input segment " + to_string(i) + " is truncated");
+            }
+            record.decode(kseq_by_segment[i], phred_offset);
+            record.encode(input[i]);
+            if(pooled) {
+                record.encode(pool.back()[i]);
+            }
+        }
+        input.validate();
+        input.clear();
+        ++count;
+    }
+
+    for(auto kseq : kseq_by_segment) {
+        kseq_destroy(kseq);
+    }
+    for(auto bgzf : bgzf_by_segment) {
+        bgzf_close(bgzf);
+    }
+    return count;
+};
+void Benchmark::benchmark_codec(const uint64_t& codec_cardinality, const bool& first) {
+    steady_clock::time_point begin(steady_clock::now());
+    generate_input(codec_cardinality);
+    write_instruction(1, "bench.bam");
+    if(first) {
+        encode_stage("generate", codec_cardinality, read_cardinality, elapsed_seconds(begin));
+    }
+
+    begin = steady_clock::now();
+    MultiplexJob* job(compile_job());
+    encode_stage("compile", codec_cardinality, 1, elapsed_seconds(begin));
+
+    const Platform platform(decode_value_by_key< Platform >("platform", job->ontology));
+    const int32_t leading_segment_index(decode_value_by_key< int32_t >("leading segment index", job->ontology));
+    const int32_t output_segment_cardinality(decode_value_by_key< int32_t >("output segment cardinality", job->ontology));
+    const Value& multiplex_ontology(find_value_by_key("multiplex", job->ontology));
+    const Value& cellular_ontology(find_value_by_key("cellular", job->ontology));
+    const TemplateRule template_rule(decode_value_by_key< Rule >("transform", job->ontology));
+
+    list< Read > pool;
+    begin = steady_clock::now();
+    uint64_t count(load_pool(*job, pool));
+    if(first) {
+        encode_stage("fastq decode", 0, count, elapsed_seconds(begin));
+    }
+
+    Read output(output_segment_cardinality, platform, leading_segment_index);
+    if(first) {
+        begin = steady_clock::now();
+        auto read(pool.begin());
+        for(count = 0; count < read_cardinality; ++count) {
+            template_rule.apply(*read, output);
+            output.clear();
+            if(++read == pool.end()) { read = pool.begin(); }
+        }
+        encode_stage("template rule", 0, count, elapsed_seconds(begin));
+
+        const Rule rule(decode_value_by_key< Rule >("transform", multiplex_ontology));
+        Observation observation(decode_value_by_key< int32_t >("segment cardinality", multiplex_ontology));
+        begin = steady_clock::now();
+        read = pool.begin();
+        for(count = 0; count < read_cardinality; ++count) {
+            rule.apply(*read, observation);
+            observation.clear();
+            if(++read == pool.end()) { read = pool.begin(); }
+        }
+        encode_stage("multiplex rule", 0, count, elapsed_seconds(begin));
+    }
+
+    /*  PAMLD compares every observation to every barcode so cap the decoded reads
+        at the comparison budget to keep large codecs tractable */
+    const uint64_t decoding_cardinality(min(read_cardinality, max(static_cast< uint64_t >(pool.size()), decoding_budget / codec_cardinality)));
+    vector< pair< string, Decoder* > > decoder_array;
+    decoder_array.emplace_back("multiplex mdd", new MultiplexMDDecoder(multiplex_ontology));
+    decoder_array.emplace_back("multiplex pamld", new MultiplexPAMLDecoder(multiplex_ontology));
+    decoder_array.emplace_back("cellular mdd", new CellularMDDecoder(cellular_ontology));
+    decoder_array.emplace_back("cellular pamld", new CellularPAMLDecoder(cellular_ontology));
+    for(auto& record : decoder_array) {
+        Decoder* decoder(record.second);
+        begin = steady_clock::now();
+        auto read(pool.begin());
+        for(count = 0; count < decoding_cardinality; ++count) {
+            decoder->decode(*read, output);
+            output.clear();
+            if(++read == pool.end()) { read = pool.begin(); }
+        }
+        encode_stage(record.first, codec_cardinality, count, elapsed_seconds(begin));
+    }
+
+    if(first) {
+        /*  assemble fully decoded output reads for the accumulator and encoder benchmarks */
+        RoutingDecoder< Channel >* multiplex(static_cast< RoutingDecoder< Channel >* >(decoder_array[1].second));
+        Decoder* cellular(decoder_array[3].second);
+        list< Read > decoded;
+        vector< size_t > decoded_index;
+        decoded_index.reserve(pool.size());
+        for(const auto& read : pool) {
+            decoded.emplace_back(output_segment_cardinality, platform, leading_segment_index);
+            Read& target(decoded.back());
+            template_rule.apply(read, target);
+            multiplex->decode(read, target);
+            cellular->decode(read, target);
+            target.flush();
+            decoded_index.push_back(static_cast< size_t >(multiplex->decoded->index));
+        }
+
+        InputAccumulator input_accumulator(job->ontology);
+        begin = steady_clock::now();
+        auto read(pool.begin());
+        for(count = 0; count < read_cardinality; ++count) {
+            input_accumulator.increment(*read);
+            if(++read == pool.end()) { read = pool.begin(); }
+        }
+        encode_stage("input accumulator", 0, count, elapsed_seconds(begin));
+
+        OutputAccumulator output_accumulator(multiplex_ontology);
+        begin = steady_clock::now();
+        read = decoded.begin();
+        size_t position(0);
+        for(count = 0; count < read_cardinality; ++count) {
+            output_accumulator.increment(decoded_index[position], *read);
+            ++position;
+            if(++read == decoded.end()) {
+                read = decoded.begin();
+                position = 0;
+            }
+        }
+        encode_stage("output accumulator", codec_cardinality, count, elapsed_seconds(begin));
+
+        FastqRecord fastq_record;
+        kstring_t buffer({ 0, 0, NULL });
+        ks_terminate(buffer);
+        begin = steady_clock::now();
+        read = decoded.begin();
+        for(count = 0; count < read_cardinality; ++count) {
+            for(const auto& segment : *read) {
+                fastq_record.decode(segment);
+                fastq_record.encode(buffer, phred_offset);
+            }
+            if(buffer.l > 0x400000) { ks_clear(buffer); }
+            if(++read == decoded.end()) { read = decoded.begin(); }
+        }
+        encode_stage("fastq encode", 0, count, elapsed_seconds(begin));
+        ks_free(buffer);
+
+        Document proxy_ontology(kObjectType);
+        encode_key_value("index", static_cast< int32_t >(0), proxy_ontology, proxy_ontology);
+        encode_key_value("url", path_of("encode.bam"), proxy_ontology, proxy_ontology);
+        encode_key_value("direction", string("out"), proxy_ontology, proxy_ontology);
+        encode_key_value("phred offset", static_cast< int32_t >(phred_offset), proxy_ontology, proxy_ontology);
+        encode_key_value("capacity", static_cast< int32_t >(1), proxy_ontology, proxy_ontology);
+        encode_key_value("resolution", static_cast< int32_t >(1), proxy_ontology, proxy_ontology);
+        encode_key_value("platform", string("ILLUMINA"), proxy_ontology, proxy_ontology);
+        FeedProxy proxy(proxy_ontology);
+        BenchmarkHtsFeed hts_feed(proxy);
+        bam1_t* bam_record(bam_init1());
+        begin = steady_clock::now();
+        read = decoded.begin();
+        for(count = 0; count < read_cardinality; ++count) {
+            for(const auto& segment : *read) {
+                hts_feed.encode_segment(bam_record, segment);
+            }
+            if(++read == decoded.end()) { read = decoded.begin(); }
+        }
+        encode_stage("bam encode", 0, count, elapsed_seconds(begin));
+        bam_destroy1(bam_record);
+    }
+
+    for(auto& record : decoder_array) {
+        delete record.second;
+    }
+    delete job;
+};
+void Benchmark::benchmark_scaling() {
+    generate_input(scaling_codec_cardinality);
+    const string output("scaling.bam");
+    created.push_back(path_of(output));
+
+    double baseline(0);
+    for(const auto& threads : thread_cardinality_array) {
+        write_instruction(threads, output);
+        MultiplexJob* job(compile_job());
+        steady_clock::time_point begin(steady_clock::now());
+        job->execute();
+        double elapsed(elapsed_seconds(begin));
+        delete job;
+
+        if(baseline == 0) {
+            baseline = elapsed;
+        }
+        Value element(kObjectType);
+        encode_key_value("threads", threads, element, report);
+        encode_key_value("codec size", scaling_codec_cardinality, element, report);
+        encode_key_value("count", read_cardinality, element, report);
+        encode_key_value("time", elapsed, element, report);
+        encode_key_value("rate", elapsed > 0 ? read_cardinality / elapsed : 0.0, element, report);
+        encode_key_value("speedup", elapsed > 0 ? baseline / elapsed : 0.0, element, report);
+        scaling_array.PushBack(element.Move(), report.GetAllocator());
+        cerr << "scaling threads " << threads << " " << fixed << setprecision(0) << (elapsed > 0 ? read_cardinality / elapsed : 0.0) << " reads/s" << endl;
+    }
+};
+void Benchmark::benchmark_compression() {
+    /*  compress and decompress the first synthetic input segment with BGZF and zstd
+        over a range of levels so the formats can be compared at matching compression ratios.
+        Both run in a single thread to compare the cost per core */
+    string content;
+    const string source(path_of(input_path.front()));
+    ifstream file(source, ios_base::in | ios_base::binary);
+    if(file.good()) {
+        content.assign(istreambuf_iterator< char >(file), istreambuf_iterator< char >());
+        file.close();
+    } else { throw IOError("failed to open " + source + " for reading"); }
+
+    const string path(path_of("compression"));
+    created.push_back(path);
+    vector< char > buffer(0x100000);
+    struct stat status;
+
+    for(const auto& level : { 1, 6, 9 }) {
+        steady_clock::time_point begin(steady_clock::now());
+        BGZF* bgzf(bgzf_open(path.c_str(), ("w" + to_string(level)).c_str()));
+        if(bgzf == NULL || bgzf_write(bgzf, content.data(), content.size()) < 0 || bgzf_close(bgzf) < 0) {
+            throw IOError("failed to write " + path);
+        }
+        const double compression_time(elapsed_seconds(begin));
+
+        begin = steady_clock::now();
+        if((bgzf = bgzf_open(path.c_str(), "r")) == NULL) {
+            throw IOError("failed to open " + path + " for reading");
+        }
+        while(bgzf_read(bgzf, buffer.data(), buffer.size()) > 0);
+        bgzf_close(bgzf);
+        const double decompression_time(elapsed_seconds(begin));
+
+        stat(path.c_str(), &status);
+        encode_compression("bgzf", level, content.size(), status.st_size, compression_time, decompression_time);
+    }
+
+    #if defined(PHENIQS_ZSTD)
+    for(const auto& level : { 1, 3, 6, 9, 12 }) {
+        steady_clock::time_point begin(steady_clock::now());
+        hFILE* hfile(hopen(path.c_str(), "w"));
+        if(hfile == NULL) {
+            throw IOError("failed to open " + path + " for writing");
+        }
+        hFILE* zstd(hopen_zstd_writer(hfile, level, 0));
+        if(hwrite(zstd, content.data(), content.size()) != static_cast< ssize_t >(content.size()) || hclose(zstd) < 0) {
+            throw IOError("failed to write " + path);
+        }
+        const double compression_time(elapsed_seconds(begin));
+
+        begin = steady_clock::now();
+        if((hfile = hopen(path.c_str(), "r")) == NULL) {
+            throw IOError("failed to open " + path + " for reading");
+        }
+        zstd = hopen_zstd_reader(hfile);
+        while(hread(zstd, buffer.data(), buffer.size()) > 0);
+        hclose(zstd);
+        const double decompression_time(elapsed_seconds(begin));
+
+        stat(path.c_str(), &status);
+        encode_compression("zstd", level, content.size(), status.st_size, compression_time, decompression_time);
+    }
+    #endif
+};
+void Benchmark::benchmark_output_compression() {
+    /*  end to end runs writing BAM output at a range of compression levels with every available core,
+        showing the decoding throughput given up and the output size saved by each level */
+    generate_input(scaling_codec_cardinality);
+    const string output("level.bam");
+    created.push_back(path_of(output));
+    const uint64_t threads(thread_cardinality_array.empty() ? 1 : thread_cardinality_array.back());
+    struct stat status;
+
+    for(const auto& level : { 0, 1, 6, 9 }) {
+        write_instruction(threads, output, level);
+        MultiplexJob* job(compile_job());
+        steady_clock::time_point begin(steady_clock::now());
+        job->execute();
+        double elapsed(elapsed_seconds(begin));
+        delete job;
+
+        stat(path_of(output).c_str(), &status);
+        Value element(kObjectType);
+        encode_key_value("format", string("bam"), element, report);
+        encode_key_value("level", level, element, report);
+        encode_key_value("threads", threads, element, report);
+        encode_key_value("count", read_cardinality, element, report);
+        encode_key_value("time", elapsed, element, report);
+        encode_key_value("rate", elapsed > 0 ? read_cardinality / elapsed : 0.0, element, report);
+        encode_key_value("size", static_cast< uint64_t >(status.st_size), element, report);
+        output_compression_array.PushBack(element.Move(), report.GetAllocator());
+        cerr << "output bam level " << level << " " << fixed << setprecision(0) << (elapsed > 0 ? read_cardinality / elapsed : 0.0) << " reads/s";
+        cerr << " size " << setprecision(2) << static_cast< double >(status.st_size) / 1000000.0 << " MB" << endl;
+    }
+};
+void Benchmark::encode_compression(const string& format, const int32_t& level, const uint64_t& size, const uint64_t& compressed_size, const double& compression_time, const double& decompression_time) {
+    const double ratio(compressed_size > 0 ? static_cast< double >(size) / compressed_size : 0.0);
+    const double megabytes(static_cast< double >(size) / 1000000.0);
+    Value element(kObjectType);
+    encode_key_value("format", format, element, report);
+    encode_key_value("level", level, element, report);
+    encode_key_value("size", size, element, report);
+    encode_key_value("compressed size", compressed_size, element, report);
+    encode_key_value("ratio", ratio, element, report);
+    encode_key_value("compression time", compression_time, element, report);
+    encode_key_value("compression rate", compression_time > 0 ? megabytes / compression_time : 0.0, element, report);
+    encode_key_value("decompression time", decompression_time, element, report);
+    encode_key_value("decompression rate", decompression_time > 0 ? megabytes / decompression_time : 0.0, element, report);
+    compression_array.PushBack(element.Move(), report.GetAllocator());
+
+    cerr << format << " level " << level << " ratio " << fixed << setprecision(2) << ratio;
+    cerr << " compression " << setprecision(0) << (compression_time > 0 ? megabytes / compression_time : 0.0) << " MB/s";
+    cerr << " decompression " << (decompression_time > 0 ? megabytes / decompression_time : 0.0) << " MB/s" << endl;
+};
+void Benchmark::encode_stage(const string& name, const uint64_t& codec_cardinality, const uint64_t& count, const double& elapsed) {
+    Value element(kObjectType);
+    encode_key_value("name", name, element, report);
+    if(codec_cardinality > 0) {
+        encode_key_value("codec size", codec_cardinality, element, report);
+    }
+    encode_key_value("count", count, element, report);
+    encode_key_value("time", elapsed, element, report);
+    encode_key_value("rate", elapsed > 0 ? count / elapsed : 0.0, element, report);
+    stage_array.PushBack(element.Move(), report.GetAllocator());
+
+    cerr << name;
+    if(codec_cardinality > 0) {
+        cerr << " codec " << codec_cardinality;
+    }
+    cerr << " " << fixed << setprecision(0) << (elapsed > 0 ? count / elapsed : 0.0) << " per second" << endl;
+};
+void Benchmark::encode_parameter(Value& container) {
+    encode_key_value("reads", read_cardinality, container, report);
+    encode_key_value("pool", pool_cardinality, container, report);
+    encode_key_value("budget", decoding_budget, container, report);
+    encode_key_value("seed", seed, container, report);
+    encode_key_value("read length", template_length, container, report);
+    encode_key_value("template segments", template_segment_cardinality, container, report);
+    encode_key_value("barcode segments", barcode_segment_cardinality, container, report);
+    encode_key_value("barcode length", barcode_length, container, report);
+    encode_key_value("substitution rate", substitution_rate, container, report);
+    encode_key_value("noise", noise, container, report);
+    encode_key_value("scaling codec size", scaling_codec_cardinality, container, report);
+    Value codec_size(kArrayType);
+    for(const auto& cardinality : codec_cardinality_array) {
+        codec_size.PushBack(Value(cardinality).Move(), report.GetAllocator());
+    }
+    container.AddMember("codec size", codec_size.Move(), report.GetAllocator());
+    Value threads(kArrayType);
+    for(const auto& cardinality : thread_cardinality_array) {
+        threads.PushBack(Value(cardinality).Move(), report.GetAllocator());
+    }
+    container.AddMember("threads", threads.Move(), report.GetAllocator());
+};
+void Benchmark::execute() {
+    if(help) {
+        print_help(cout);
+
+    } else {
+        create_directory();
+        for(size_t i(0); i < codec_cardinality_array.size(); ++i) {
+            benchmark_codec(codec_cardinality_array[i], i == 0);
+        }
+        benchmark_compression();
+        if(!thread_cardinality_array.empty()) {
+            benchmark_scaling();
+        }
+        benchmark_output_compression();
+
+        encode_key_value("application version", string(PHENIQS_VERSION), report, report);
+        Value parameter(kObjectType);
+        encode_parameter(parameter);
+        report.AddMember("parameter", parameter.Move(), report.GetAllocator());
+        report.AddMember("stage", stage_array.Move(), report.GetAllocator());
+        report.AddMember("scaling", scaling_array.Move(), report.GetAllocator());
+        report.AddMember("compression", compression_array.Move(), report.GetAllocator());
+        report.AddMember("output compression", output_compression_array.Move(), report.GetAllocator());
+        print_report();
+    }
+};
+void Benchmark::print_report() const {
+    if(output_path == "-") {
+        print_json(report, cout);
+
+    } else {
+        ofstream file(output_path, ios_base::out | ios_base::trunc);
+        if(file.good()) {
+            print_json(report, file);
+            file.close();
+        } else { throw IOError("failed to open " + output_path + " for writing"); }
+    }
+};
+
+int main(int argc, char** argv) {
+    int return_code(static_cast< int >(ProgramState::OK));
+
+    try {
+        Benchmark benchmark(argc, (const char**)argv);
+        benchmark.execute();
+
+    } catch(InternalError& error) {
+        cerr << error.what() << endl;
+        return_code = static_cast< int >(ProgramState::INTERNAL_ERROR);
+
+    } catch(ConfigurationError& error) {
+        cerr << error.what() << endl;
+        return_code =  static_cast< int >(ProgramState::CONFIGURATION_ERROR);
+
+    } catch(OutOfMemoryError& error) {
+        cerr << error.what() << endl;
+        return_code =  static_cast< int >(ProgramState::OUT_OF_MEMORY_ERROR);
+
+    } catch(CommandLineError& error) {
+        cerr << error.what() << endl;
+        return_code =  static_cast< int >(ProgramState::COMMAND_LINE_ERROR);
+
+    } catch(IOError& error) {
+        cerr << error.what() << endl;
+        return_code =  static_cast< int >(ProgramState::IO_ERROR);
+
+    } catch(SequenceError& error) {
+        cerr << error.what() << endl;
+        return_code =  static_cast< int >(ProgramState::SEQUENCE_ERROR);
+
+    } catch(exception& error) {
+        cerr << error.what() << endl;
+        return_code =  static_cast< int >(ProgramState::UNKNOWN_ERROR);
+
+    }
+    return return_code;
+};
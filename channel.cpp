@@ -26,7 +26,9 @@ Channel::Channel(const Value& ontology) try :
     rg(ontology),
     include_filtered(decode_value_by_key< bool >("include filtered", ontology)),
     disable_quality_control(decode_value_by_key< bool >("disable quality control", ontology)),
-    output_feed_url_by_segment(decode_value_by_key< list< URL > >("output", ontology)) {
+    output_feed_url_by_segment(decode_value_by_key< list< URL > >("output", ontology)),
+    count(0),
+    output_count(0) {
 
     } catch(ConfigurationError& error) {
         throw ConfigurationError("Channel :: " + error.message);
@@ -41,7 +43,9 @@ Channel::Channel(const Channel& other) :
     disable_quality_control(other.disable_quality_control),
     output_feed_url_by_segment(other.output_feed_url_by_segment),
     output_feed_lock_order(other.output_feed_lock_order),
-    output_feed_by_segment(other.output_feed_by_segment) {
+    output_feed_by_segment(other.output_feed_by_segment),
+    count(other.count.load()),
+    output_count(other.output_count.load()) {
 };
 void Channel::populate(unordered_map< URL, Feed* >& feed_by_url) {
     map< int32_t, Feed* > feed_by_index;
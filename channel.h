@@ -35,11 +35,17 @@ class Channel : public Barcode {
         const list< URL > output_feed_url_by_segment;
         vector< Feed* > output_feed_lock_order;
         vector< Feed* > output_feed_by_segment;
+        /*  reads routed to the channel and reads actually written to the output feeds.
+            sampled by the progress reporter while the pivot threads are running */
+        atomic< uint64_t > count;
+        atomic< uint64_t > output_count;
         Channel(const Value& ontology);
         Channel(const Channel& other);
         inline void push(const Read& read) {
+            count.fetch_add(1, memory_order_relaxed);
             if(output_feed_lock_order.size() > 0) {
                 if(include_filtered || !read.qcfail()) {
+                    output_count.fetch_add(1, memory_order_relaxed);
                     // acquire a push lock for all feeds in a fixed order
                     vector< unique_lock< mutex > > feed_locks;
                     feed_locks.reserve(output_feed_lock_order.size());
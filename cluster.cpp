@@ -0,0 +1,141 @@
+/*
+    Pheniqs : PHilology ENcoder wIth Quality Statistics
+    Copyright (C) 2018  Lior Galanti
+    NYU Center for Genetics and System Biology
+
+    Author: Lior Galanti <lior.galanti@nyu.edu>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "cluster.h"
+
+/* BAM nucleotide codes a UMI position can be substituted with */
+static const uint8_t substitution_code[] = { 1, 2, 4, 8 };
+
+DirectionalClusterTable::DirectionalClusterTable(const Value& ontology) try :
+    capacity(decode_value_by_key< int32_t >("umi capacity", ontology)),
+    shard_array(CLUSTER_SHARD_CARDINALITY),
+    hasher(),
+    _frozen(false) {
+
+    if(capacity < 1) {
+        throw ConfigurationError("umi capacity must be a positive number");
+    }
+
+    } catch(ConfigurationError& error) {
+        throw ConfigurationError("DirectionalClusterTable :: " + error.message);
+
+    } catch(exception& error) {
+        throw InternalError("DirectionalClusterTable :: " + string(error.what()));
+};
+void DirectionalClusterTable::count(const string& group, const string& umi) {
+    Shard& shard(shard_array[hasher(group) % shard_array.size()]);
+    lock_guard< mutex > shard_lock(shard.shard_mutex);
+
+    ClusterGroup& cluster(shard.group_by_key[group]);
+    auto node = cluster.count_by_umi.find(umi);
+    if(node != cluster.count_by_umi.end()) {
+        ++(node->second);
+    } else if(cluster.count_by_umi.size() < static_cast< size_t >(capacity)) {
+        cluster.count_by_umi.emplace(make_pair(umi, 1));
+    }
+};
+void DirectionalClusterTable::freeze() {
+    /* number the groups in key order so group identifiers do not depend on the order groups were first seen */
+    vector< pair< const string*, ClusterGroup* > > group_array;
+    for(auto& shard : shard_array) {
+        lock_guard< mutex > shard_lock(shard.shard_mutex);
+        for(auto& record : shard.group_by_key) {
+            group_array.emplace_back(&record.first, &record.second);
+        }
+    }
+    sort(group_array.begin(), group_array.end(), [](const pair< const string*, ClusterGroup* >& left, const pair< const string*, ClusterGroup* >& right) {
+        return *left.first < *right.first;
+    });
+    uint64_t identifier(0);
+    for(auto& record : group_array) {
+        record.second->identifier = identifier;
+        ++identifier;
+    }
+    _frozen = true;
+};
+void DirectionalClusterTable::assign(const string& group, const string& umi, string& representative, string& candidate, string& parent, uint64_t& group_identifier) const {
+    /*  the table is read only once frozen so assignment needs no lock.
+        candidate and parent are scratch buffers owned by the calling decoder */
+    const Shard& shard(shard_array[hasher(group) % shard_array.size()]);
+    representative.assign(umi);
+    group_identifier = 0;
+
+    auto record = shard.group_by_key.find(group);
+    if(record == shard.group_by_key.end()) {
+        return;
+    }
+    const ClusterGroup& cluster(record->second);
+    group_identifier = cluster.identifier;
+
+    /*  walk to the most abundant adjacent UMI while the directional criterion holds.
+        Each step moves to a higher count, or to an equal count and a lexicographically
+        smaller UMI, so the walk terminates.
+        A UMI that was not counted because its group was full starts the walk with a count of 1 */
+    uint32_t current_count(max(count(cluster, umi), uint32_t(1)));
+    bool absorbed(true);
+    while(absorbed) {
+        absorbed = false;
+        uint32_t parent_count(0);
+        parent.clear();
+        candidate.assign(representative);
+        for(size_t i(0); i < candidate.size(); ++i) {
+            const char original(candidate[i]);
+            for(const auto& code : substitution_code) {
+                if(static_cast< char >(code) != original) {
+                    candidate[i] = static_cast< char >(code);
+                    uint32_t neighbor_count(count(cluster, candidate));
+                    if(neighbor_count > 0 && neighbor_count + 1 >= 2 * current_count) {
+                        if(neighbor_count > current_count || (neighbor_count == current_count && candidate < representative)) {
+                            if(neighbor_count > parent_count || (neighbor_count == parent_count && candidate < parent)) {
+                                parent_count = neighbor_count;
+                                parent.assign(candidate);
+                            }
+                        }
+                    }
+                }
+            }
+            candidate[i] = original;
+        }
+        if(parent_count > 0) {
+            representative.swap(parent);
+            current_count = parent_count;
+            absorbed = true;
+        }
+    }
+};
+void DirectionalClusterTable::encode(Value& container, Document& document) const {
+    uint64_t group_count(0);
+    uint64_t umi_count(0);
+    uint64_t saturated_count(0);
+    for(const auto& shard : shard_array) {
+        lock_guard< mutex > shard_lock(shard.shard_mutex);
+        group_count += shard.group_by_key.size();
+        for(const auto& record : shard.group_by_key) {
+            umi_count += record.second.count_by_umi.size();
+            if(record.second.count_by_umi.size() >= static_cast< size_t >(capacity)) {
+                ++saturated_count;
+            }
+        }
+    }
+    encode_key_value("group count", group_count, container, document);
+    encode_key_value("umi count", umi_count, container, document);
+    encode_key_value("saturated group count", saturated_count, container, document);
+};
@@ -0,0 +1,83 @@
+/*
+    Pheniqs : PHilology ENcoder wIth Quality Statistics
+    Copyright (C) 2018  Lior Galanti
+    NYU Center for Genetics and System Biology
+
+    Author: Lior Galanti <lior.galanti@nyu.edu>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PHENIQS_CLUSTER_H
+#define PHENIQS_CLUSTER_H
+
+#include "include.h"
+#include "json.h"
+
+#define CLUSTER_SHARD_CARDINALITY 64
+
+/*  Molecular identifier counts for one cellular and multiplex group */
+class ClusterGroup {
+    public:
+        uint64_t identifier;
+        unordered_map< string, uint32_t > count_by_umi;
+        ClusterGroup() :
+            identifier(0) {
+        };
+};
+
+/*  Directional adjacency clustering of molecular identifiers.
+
+    Clustering is done in two passes over the input. During the first pass all pivots count
+    into the table, which is partitioned into shards by group so pivots decoding reads from
+    different cells rarely contend on the same lock. The table is then frozen, groups are numbered
+    in lexicographic order of their key, and during the second pass every read is assigned against
+    the final counts without locking, so the assignment depends neither on input order nor on thread timing.
+    A UMI is absorbed by a neighbor one substitution away if the neighbor count n
+    satisfies n >= 2c - 1 where c is the UMI count, and the walk continues from the
+    neighbor until no such neighbor exists. The UMI at the end of the walk names the molecule.
+    Every group holds at most capacity distinct UMIs, a UMI first seen in a full group
+    is not counted but is still absorbed by a known neighbor.
+*/
+class DirectionalClusterTable {
+    DirectionalClusterTable(DirectionalClusterTable const &) = delete;
+    void operator=(DirectionalClusterTable const &) = delete;
+
+    public:
+        const int32_t capacity;
+        DirectionalClusterTable(const Value& ontology);
+        inline bool frozen() const {
+            return _frozen;
+        };
+        void count(const string& group, const string& umi);
+        void freeze();
+        void assign(const string& group, const string& umi, string& representative, string& candidate, string& parent, uint64_t& group_identifier) const;
+        void encode(Value& container, Document& document) const;
+
+    private:
+        class Shard {
+            public:
+                mutable mutex shard_mutex;
+                unordered_map< string, ClusterGroup > group_by_key;
+        };
+        vector< Shard > shard_array;
+        const hash< string > hasher;
+        bool _frozen;
+        inline uint32_t count(const ClusterGroup& group, const string& umi) const {
+            auto record = group.count_by_umi.find(umi);
+            return record != group.count_by_umi.end() ? record->second : 0;
+        };
+};
+
+#endif /* PHENIQS_CLUSTER_H */
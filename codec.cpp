@@ -0,0 +1,229 @@
+/*
+    Pheniqs : PHilology ENcoder wIth Quality Statistics
+    Copyright (C) 2018  Lior Galanti
+    NYU Center for Genetics and System Biology
+
+    Author: Lior Galanti <lior.galanti@nyu.edu>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "codec.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static inline size_t align_to_double(const size_t& offset) {
+    return (offset + sizeof(double) - 1) & ~(sizeof(double) - 1);
+};
+
+CodecIndex::CodecIndex(const URL& url) try :
+    url(url),
+    descriptor(-1),
+    size(0),
+    mapped(MAP_FAILED),
+    header(NULL),
+    _barcode_length(NULL),
+    _shannon_bound(NULL),
+    _concentration(NULL),
+    _code(NULL) {
+
+    try {
+        load();
+    } catch(...) {
+        release();
+        throw;
+    }
+
+    } catch(ConfigurationError& error) {
+        throw ConfigurationError("CodecIndex :: " + error.message);
+
+    } catch(IOError& error) {
+        throw IOError("CodecIndex :: " + error.message);
+
+    } catch(exception& error) {
+        throw InternalError("CodecIndex :: " + string(error.what()));
+};
+CodecIndex::~CodecIndex() {
+    release();
+};
+void CodecIndex::load() {
+    if((descriptor = open(url.path().c_str(), O_RDONLY)) < 0) {
+        throw IOError("could not open " + string(url) + " for reading");
+    }
+
+    struct stat status;
+    if(fstat(descriptor, &status) < 0) {
+        throw IOError("could not stat " + string(url));
+    }
+    size = static_cast< size_t >(status.st_size);
+    if(size < sizeof(CodecIndexHeader)) {
+        throw ConfigurationError(string(url) + " is not a codec index");
+    }
+
+    if((mapped = mmap(NULL, size, PROT_READ, MAP_SHARED, descriptor, 0)) == MAP_FAILED) {
+        throw IOError("could not map " + string(url));
+    }
+    header = static_cast< const CodecIndexHeader* >(mapped);
+
+    if(strncmp(header->magic, CODEC_INDEX_MAGIC, sizeof(header->magic))) {
+        throw ConfigurationError(string(url) + " is not a codec index");
+    }
+    if(header->version != CODEC_INDEX_FORMAT_VERSION) {
+        throw ConfigurationError (
+            string(url) + " is codec index version " + to_string(header->version) +
+            " but expecting version " + to_string(CODEC_INDEX_FORMAT_VERSION)
+        );
+    }
+
+    const uint8_t* base(static_cast< const uint8_t* >(mapped));
+    size_t offset(sizeof(CodecIndexHeader));
+    _barcode_length = reinterpret_cast< const int32_t* >(base + offset);
+    offset += sizeof(int32_t) * header->segment_cardinality;
+    _shannon_bound = reinterpret_cast< const int32_t* >(base + offset);
+    offset += sizeof(int32_t) * header->segment_cardinality;
+    offset = align_to_double(offset);
+    _concentration = reinterpret_cast< const double* >(base + offset);
+    offset += sizeof(double) * header->barcode_cardinality;
+    _code = base + offset;
+    offset += header->barcode_cardinality * header->nucleotide_cardinality;
+
+    if(offset != size) {
+        throw ConfigurationError(string(url) + " is a truncated codec index");
+    }
+    int32_t nucleotide_cardinality(0);
+    for(int32_t i(0); i < segment_cardinality(); ++i) {
+        nucleotide_cardinality += _barcode_length[i];
+    }
+    if(nucleotide_cardinality != this->nucleotide_cardinality()) {
+        throw ConfigurationError(string(url) + " is a corrupt codec index");
+    }
+
+    /* the decoders scan the whole table so ask the kernel to read ahead */
+    madvise(mapped, size, MADV_WILLNEED);
+};
+void CodecIndex::release() {
+    if(mapped != MAP_FAILED) {
+        munmap(mapped, size);
+        mapped = MAP_FAILED;
+    }
+    if(descriptor >= 0) {
+        close(descriptor);
+        descriptor = -1;
+    }
+};
+void CodecIndex::compile_decoder(Value& value, Document& document) const {
+    vector< int32_t > barcode_length(decode_value_by_key< vector< int32_t > >("barcode length", value));
+    if(static_cast< int32_t >(barcode_length.size()) != segment_cardinality()) {
+        throw ConfigurationError (
+            string(url) + " has " + to_string(segment_cardinality()) + " barcode segments but the transform produces " +
+            to_string(barcode_length.size())
+        );
+    }
+
+    vector< int32_t > shannon_bound_array(segment_cardinality());
+    for(int32_t i(0); i < segment_cardinality(); ++i) {
+        if(barcode_length[i] != _barcode_length[i]) {
+            throw ConfigurationError (
+                string(url) + " barcode segment " + to_string(i) + " is " + to_string(_barcode_length[i]) +
+                " nucleotide long but the transform produces " + to_string(barcode_length[i])
+            );
+        }
+        shannon_bound_array[i] = _shannon_bound[i];
+    }
+    encode_key_value("shannon bound", shannon_bound_array, value, document);
+
+    /* concentrations in the index were normalized against this noise prior */
+    encode_key_value("noise", noise(), value, document);
+
+    vector< int32_t > distance_tolerance;
+    if(decode_value_by_key< vector< int32_t > >("distance tolerance", distance_tolerance, value)) {
+        if(static_cast< int32_t >(distance_tolerance.size()) == segment_cardinality()) {
+            for(int32_t i(0); i < segment_cardinality(); ++i) {
+                if(distance_tolerance[i] > shannon_bound_array[i]) {
+                    throw ConfigurationError (
+                        "barcode tolerance for segment " + to_string(i) +
+                        " is higher than shannon bound " + to_string(shannon_bound_array[i])
+                    );
+                }
+            }
+        } else {
+            throw ConfigurationError (
+                to_string(distance_tolerance.size()) + " distance tolerance cardinality inconsistant with " +
+                to_string(segment_cardinality()) + " barcode segment cardinality"
+            );
+        }
+    } else { encode_key_value("distance tolerance", shannon_bound_array, value, document); }
+};
+void CodecIndex::write(const URL& url, const Value& ontology) {
+    const vector< Barcode > codec(decode_value_by_key< vector< Barcode > >("codec", ontology));
+    const vector< int32_t > barcode_length(decode_value_by_key< vector< int32_t > >("barcode length", ontology));
+    const vector< int32_t > shannon_bound(decode_value_by_key< vector< int32_t > >("shannon bound", ontology));
+
+    CodecIndexHeader header;
+    memset(&header, 0, sizeof(CodecIndexHeader));
+    strncpy(header.magic, CODEC_INDEX_MAGIC, sizeof(header.magic));
+    header.version = CODEC_INDEX_FORMAT_VERSION;
+    header.segment_cardinality = static_cast< uint32_t >(barcode_length.size());
+    header.nucleotide_cardinality = decode_value_by_key< uint32_t >("nucleotide cardinality", ontology);
+    header.barcode_cardinality = codec.size();
+    header.noise = decode_value_by_key< double >("noise", ontology);
+
+    /* sort the barcodes by their BAM encoded sequence so the table can be binary searched */
+    vector< pair< string, const Barcode* > > sorted;
+    sorted.reserve(codec.size());
+    for(const auto& barcode : codec) {
+        sorted.emplace_back(string(barcode), &barcode);
+        if(sorted.back().first.size() != header.nucleotide_cardinality) {
+            throw ConfigurationError (
+                "barcode " + barcode.iupac_ambiguity() + " is " + to_string(sorted.back().first.size()) +
+                " nucleotide long but expecting " + to_string(header.nucleotide_cardinality)
+            );
+        }
+    }
+    sort(sorted.begin(), sorted.end());
+    for(size_t i(1); i < sorted.size(); ++i) {
+        if(sorted[i].first == sorted[i - 1].first) {
+            throw ConfigurationError("duplicate barcode " + sorted[i].second->iupac_ambiguity());
+        }
+    }
+
+    ofstream file;
+    if(url.is_writable()) {
+        file.open(url.path(), ios_base::out | ios_base::trunc | ios_base::binary);
+    }
+    if(file.is_open()) {
+        size_t offset(sizeof(CodecIndexHeader));
+        file.write(reinterpret_cast< const char* >(&header), sizeof(CodecIndexHeader));
+        file.write(reinterpret_cast< const char* >(barcode_length.data()), sizeof(int32_t) * barcode_length.size());
+        file.write(reinterpret_cast< const char* >(shannon_bound.data()), sizeof(int32_t) * shannon_bound.size());
+        offset += 2 * sizeof(int32_t) * barcode_length.size();
+        while(offset < align_to_double(offset)) {
+            file.put(0);
+            ++offset;
+        }
+        for(const auto& record : sorted) {
+            const double concentration(record.second->concentration);
+            file.write(reinterpret_cast< const char* >(&concentration), sizeof(double));
+        }
+        for(const auto& record : sorted) {
+            file.write(record.first.c_str(), record.first.size());
+        }
+        file.close();
+        if(file.fail()) {
+            throw IOError("failed writing codec index to " + string(url));
+        }
+    } else { throw IOError("could not open " + string(url) + " for writing"); }
+};
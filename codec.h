@@ -0,0 +1,177 @@
+/*
+    Pheniqs : PHilology ENcoder wIth Quality Statistics
+    Copyright (C) 2018  Lior Galanti
+    NYU Center for Genetics and System Biology
+
+    Author: Lior Galanti <lior.galanti@nyu.edu>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PHENIQS_CODEC_H
+#define PHENIQS_CODEC_H
+
+#include "include.h"
+#include "url.h"
+#include "barcode.h"
+
+#define CODEC_INDEX_MAGIC "PHNQCDX"
+#define CODEC_INDEX_FORMAT_VERSION 1
+
+/*  Precompiled codec index file layout, all values in host byte order
+
+    CodecIndexHeader
+    int32_t barcode length[segment cardinality]
+    int32_t shannon bound[segment cardinality]
+    padding to an 8 byte boundary
+    double concentration[barcode cardinality]
+    uint8_t code[barcode cardinality * nucleotide cardinality]
+
+    Barcodes are stored as concatenated BAM nucleotide codes sorted lexicographically,
+    so the code table doubles as the exact match index and is searched with a binary search.
+    Concentrations are normalized against the noise prior when the index is compiled.
+*/
+class CodecIndexHeader {
+    public:
+        char magic[8];
+        uint32_t version;
+        uint32_t segment_cardinality;
+        uint32_t nucleotide_cardinality;
+        uint32_t reserved;
+        uint64_t barcode_cardinality;
+        double noise;
+};
+static_assert(sizeof(CodecIndexHeader) == 40, "unexpected codec index header size");
+
+/*  Read only memory mapped view of a precompiled codec index.
+    The mapping is shared so concurrent processes decoding against the same index
+    share the physical pages.
+*/
+class CodecIndex {
+    CodecIndex(CodecIndex const &) = delete;
+    void operator=(CodecIndex const &) = delete;
+
+    public:
+        const URL url;
+        CodecIndex(const URL& url);
+        ~CodecIndex();
+        static void write(const URL& url, const Value& ontology);
+        inline int32_t segment_cardinality() const {
+            return static_cast< int32_t >(header->segment_cardinality);
+        };
+        inline int32_t nucleotide_cardinality() const {
+            return static_cast< int32_t >(header->nucleotide_cardinality);
+        };
+        inline int64_t cardinality() const {
+            return static_cast< int64_t >(header->barcode_cardinality);
+        };
+        inline double noise() const {
+            return header->noise;
+        };
+        inline int32_t barcode_length(const int32_t& segment) const {
+            return _barcode_length[segment];
+        };
+        inline int32_t shannon_bound(const int32_t& segment) const {
+            return _shannon_bound[segment];
+        };
+        inline double concentration(const int64_t& index) const {
+            return _concentration[index];
+        };
+        inline const uint8_t* code(const int64_t& index) const {
+            return _code + index * header->nucleotide_cardinality;
+        };
+        inline int64_t find(const Observation& observation) const {
+            int64_t low(0);
+            int64_t high(cardinality() - 1);
+            while(low <= high) {
+                int64_t middle(low + ((high - low) >> 1));
+                int comparison(compare(middle, observation));
+                if(comparison < 0) {
+                    low = middle + 1;
+                } else if(comparison > 0) {
+                    high = middle - 1;
+                } else {
+                    return middle;
+                }
+            }
+            return -1;
+        };
+        inline void accurate_decoding_probability(const int64_t& index, const Observation& observation, double& probability, int32_t& distance) const {
+            double q(0);
+            int32_t d(0);
+            const uint8_t* reference(code(index));
+            for(size_t i(0); i < observation.segment_cardinality(); ++i) {
+                const ObservedSequence& observed = observation[i];
+                for(int32_t j(0); j < _barcode_length[i]; ++j) {
+                    if(observed.code[j] == reference[j]) {
+                        q += quality_to_inverse_quality(observed.quality[j]);
+                    } else {
+                        d += 1;
+                        if(observed.code[j] != ANY_NUCLEOTIDE) {
+                            q += double(observed.quality[j]);
+                        } else {
+                            q += UNIFORM_BASE_PHRED;
+                        }
+                    }
+                }
+                reference += _barcode_length[i];
+            }
+            distance = d;
+            probability = pow(10.0, q * -0.1);
+        };
+        inline int32_t distance(const int64_t& index, const int32_t& segment, const ObservedSequence& observed, const int32_t& offset, const uint8_t& quality_masking_threshold) const {
+            int32_t result(0);
+            const uint8_t* reference(code(index) + offset);
+            if(quality_masking_threshold > 0) {
+                for(int32_t i(0); i < _barcode_length[segment]; ++i) {
+                    if(observed.quality[i] < quality_masking_threshold || observed.code[i] != reference[i]) {
+                        ++result;
+                    }
+                }
+            } else {
+                for(int32_t i(0); i < _barcode_length[segment]; ++i) {
+                    if(observed.code[i] != reference[i]) {
+                        ++result;
+                    }
+                }
+            }
+            return result;
+        };
+        void compile_decoder(Value& value, Document& document) const;
+
+    private:
+        int descriptor;
+        size_t size;
+        void* mapped;
+        const CodecIndexHeader* header;
+        const int32_t* _barcode_length;
+        const int32_t* _shannon_bound;
+        const double* _concentration;
+        const uint8_t* _code;
+        void load();
+        void release();
+        inline int compare(const int64_t& index, const Observation& observation) const {
+            const uint8_t* reference(code(index));
+            for(size_t i(0); i < observation.segment_cardinality(); ++i) {
+                int comparison(memcmp(reference, observation[i].code, _barcode_length[i]));
+                if(comparison != 0) {
+                    return comparison;
+                }
+                reference += _barcode_length[i];
+            }
+            return 0;
+        };
+};
+
+#endif /* PHENIQS_CODEC_H */
@@ -0,0 +1,35 @@
+/*
+    Pheniqs : PHilology ENcoder wIth Quality Statistics
+    Copyright (C) 2018  Lior Galanti
+    NYU Center for Genetics and System Biology
+
+    Author: Lior Galanti <lior.galanti@nyu.edu>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    This file is auto generated from configuration.json
+
+    Generated on: Mon Oct 19 08:48:41 UTC 2026
+*/
+
+#ifndef PHENIQS_CONFIGURATION_H
+#define PHENIQS_CONFIGURATION_H
+
+size_t configuration_json_len = 0;
+
+const char configuration_json[] = {
+    
+};
+
+#endif /* PHENIQS_CONFIGURATION_H */
@@ -190,6 +190,51 @@ void MultiplexPAMLDecoder::decode(const Read& input, Read& output) {
     output.update_multiplex_decoding_confidence(this->decoding_probability);
 };
 
+MolecularMDDecoder::MolecularMDDecoder(const Value& ontology) try :
+    MDDecoder< Barcode >(ontology) {
+
+    } catch(ConfigurationError& error) {
+        throw ConfigurationError("MolecularMDDecoder :: " + error.message);
+
+    } catch(exception& error) {
+        throw InternalError("MolecularMDDecoder :: " + string(error.what()));
+};
+void MolecularMDDecoder::decode(const Read& input, Read& output) {
+    MDDecoder< Barcode >::decode(input, output);
+    output.update_raw_molecular_barcode(this->observation);
+    if(this->decoded != &this->unclassified) {
+        /* RX carries the corrected barcode and QX the observed quality */
+        output.update_molecular_barcode(*this->decoded);
+        output.update_molecular_quality(this->observation);
+        output.update_molecular_distance(this->decoding_distance);
+    } else {
+        output.update_molecular_barcode(this->observation);
+    }
+};
+
+MolecularPAMLDecoder::MolecularPAMLDecoder(const Value& ontology) try :
+    PAMLDecoder< Barcode >(ontology) {
+
+    } catch(ConfigurationError& error) {
+        throw ConfigurationError("MolecularPAMLDecoder :: " + error.message);
+
+    } catch(exception& error) {
+        throw InternalError("MolecularPAMLDecoder :: " + string(error.what()));
+};
+void MolecularPAMLDecoder::decode(const Read& input, Read& output) {
+    PAMLDecoder< Barcode >::decode(input, output);
+    output.update_raw_molecular_barcode(this->observation);
+    if(this->decoded != &this->unclassified) {
+        output.update_molecular_barcode(*this->decoded);
+        output.update_molecular_quality(this->observation);
+        output.update_molecular_decoding_confidence(this->decoding_probability);
+        output.update_molecular_distance(this->decoding_distance);
+    } else {
+        output.update_molecular_barcode(this->observation);
+        output.set_molecular_decoding_confidence(0);
+    }
+};
+
 CellularMDDecoder::CellularMDDecoder(const Value& ontology) try :
     MDDecoder< Barcode >(ontology) {
 
@@ -232,6 +277,138 @@ void CellularPAMLDecoder::decode(const Read& input, Read& output) {
     }
 };
 
+CodecIndexDecoder::CodecIndexDecoder(const Value& ontology, const CodecIndex& index) try :
+    Decoder(ontology),
+    index(index),
+    rule(decode_value_by_key< Rule >("transform", ontology)),
+    observation(decode_value_by_key< int32_t >("segment cardinality", ontology)),
+    undetermined(index.nucleotide_cardinality(), 0),
+    decoded(-1),
+    decoding_distance(0) {
+
+    } catch(ConfigurationError& error) {
+        throw ConfigurationError("CodecIndexDecoder :: " + error.message);
+
+    } catch(exception& error) {
+        throw InternalError("CodecIndexDecoder :: " + string(error.what()));
+};
+
+CellularIndexMDDecoder::CellularIndexMDDecoder(const Value& ontology, const CodecIndex& index) try :
+    CodecIndexDecoder(ontology, index),
+    quality_masking_threshold(decode_value_by_key< uint8_t >("quality masking threshold", ontology)),
+    distance_tolerance(decode_value_by_key< vector< int32_t > >("distance tolerance", ontology)) {
+
+    } catch(ConfigurationError& error) {
+        throw ConfigurationError("CellularIndexMDDecoder :: " + error.message);
+
+    } catch(exception& error) {
+        throw InternalError("CellularIndexMDDecoder :: " + string(error.what()));
+};
+bool CellularIndexMDDecoder::match(const int64_t& candidate) {
+    int32_t hamming_distance(0);
+    int32_t offset(0);
+    for(size_t i(0); i < observation.segment_cardinality(); ++i) {
+        int32_t error(index.distance(candidate, i, observation[i], offset, quality_masking_threshold));
+        if(error > distance_tolerance[i]) {
+            return false;
+        }
+        hamming_distance += error;
+        offset += index.barcode_length(i);
+    }
+    decoding_distance = hamming_distance;
+    decoded = candidate;
+    return true;
+};
+void CellularIndexMDDecoder::decode(const Read& input, Read& output) {
+    observation.clear();
+    decoded = -1;
+    decoding_distance = 0;
+    rule.apply(input, observation);
+
+    /* First try a perfect match with a binary search of the sorted code table */
+    decoded = index.find(observation);
+    if(decoded < 0) {
+        /* If no exact match was not found try error correction */
+        for(int64_t candidate(0); candidate < index.cardinality(); ++candidate) {
+            if(match(candidate)) {
+                break;
+            }
+        }
+    }
+
+    output.update_cellular_barcode(decoded_code(), index.nucleotide_cardinality());
+    output.update_raw_cellular_barcode(observation);
+    if(decoded >= 0) {
+        output.update_cellular_distance(decoding_distance);
+    } else {
+        output.set_cellular_distance(0);
+    }
+};
+
+CellularIndexPAMLDecoder::CellularIndexPAMLDecoder(const Value& ontology, const CodecIndex& index) try :
+    CodecIndexDecoder(ontology, index),
+    confidence_threshold(decode_value_by_key< double >("confidence threshold", ontology)),
+    random_barcode_probability(1.0 / double(pow(4, (index.nucleotide_cardinality())))),
+    adjusted_noise_probability(index.noise() * random_barcode_probability),
+    conditioned_decoding_probability(0),
+    decoding_probability(0) {
+
+    } catch(ConfigurationError& error) {
+        throw ConfigurationError("CellularIndexPAMLDecoder :: " + error.message);
+
+    } catch(exception& error) {
+        throw InternalError("CellularIndexPAMLDecoder :: " + string(error.what()));
+};
+void CellularIndexPAMLDecoder::decode(const Read& input, Read& output) {
+    observation.clear();
+    decoded = -1;
+    decoding_distance = 0;
+    decoding_probability = 0;
+    conditioned_decoding_probability = 0;
+    rule.apply(input, observation);
+
+    /* Same computation as PAMLDecoder< T >::decode over the memory mapped code table */
+    double adjusted(0);
+    double compensation(0);
+    double sigma(0);
+    double y(0);
+    double t(0);
+    double c(0);
+    double p(0);
+    int32_t d(0);
+    for(int64_t candidate(0); candidate < index.cardinality(); ++candidate) {
+        index.accurate_decoding_probability(candidate, observation, c, d);
+        p = c * index.concentration(candidate);
+        y = p - compensation;
+        t = sigma + y;
+        compensation = (t - sigma) - y;
+        sigma = t;
+        if(p > adjusted) {
+            decoded = candidate;
+            conditioned_decoding_probability = c;
+            decoding_distance = d;
+            adjusted = p;
+        }
+    }
+    decoding_probability = adjusted / (sigma + adjusted_noise_probability);
+
+    if(!(conditioned_decoding_probability > random_barcode_probability && decoding_probability > confidence_threshold)) {
+        decoding_distance = 0;
+        decoding_probability = 0;
+        decoded = -1;
+    }
+
+    output.update_raw_cellular_barcode(observation);
+    output.update_cellular_barcode(decoded_code(), index.nucleotide_cardinality());
+    if(decoded >= 0) {
+        output.update_cellular_decoding_confidence(decoding_probability);
+        output.update_cellular_distance(decoding_distance);
+    } else {
+        output.set_cellular_decoding_confidence(0);
+        output.set_cellular_distance(0);
+    }
+};
+
 MolecularNaiveDecoder::MolecularNaiveDecoder(const Value& ontology) try :
     Decoder(ontology),
     nucleotide_cardinality(decode_value_by_key< int32_t >("nucleotide cardinality", ontology)),
@@ -249,3 +426,56 @@ void MolecularNaiveDecoder::decode(const Read& input, Read& output) {
     rule.apply(input, observation);
     output.update_molecular_barcode(observation);
 };
+
+MolecularDirectionalDecoder::MolecularDirectionalDecoder(const Value& ontology, DirectionalClusterTable& table) try :
+    Decoder(ontology),
+    nucleotide_cardinality(decode_value_by_key< int32_t >("nucleotide cardinality", ontology)),
+    rule(decode_value_by_key< Rule >("transform", ontology)),
+    observation(decode_value_by_key< int32_t >("segment cardinality", ontology)),
+    table(table) {
+
+    umi.reserve(nucleotide_cardinality);
+    representative.reserve(nucleotide_cardinality);
+    candidate.reserve(nucleotide_cardinality);
+    parent.reserve(nucleotide_cardinality);
+
+    } catch(ConfigurationError& error) {
+        throw ConfigurationError("MolecularDirectionalDecoder :: " + error.message);
+
+    } catch(exception& error) {
+        throw InternalError("MolecularDirectionalDecoder :: " + string(error.what()));
+};
+void MolecularDirectionalDecoder::decode(const Read& input, Read& output) {
+    observation.clear();
+    rule.apply(input, observation);
+    output.update_molecular_barcode(observation);
+
+    /* molecules are clustered within the multiplex read group and the cellular barcode */
+    group.clear();
+    if(output.RG().l > 0) {
+        group.append(output.RG().s, output.RG().l);
+    }
+    group.push_back('\t');
+    if(output.auxiliary().CB.l > 0) {
+        group.append(output.auxiliary().CB.s, output.auxiliary().CB.l);
+    }
+
+    umi.clear();
+    observation.encode_bam(umi);
+
+    /* the first pass over the input only counts, the second assigns against the frozen counts */
+    if(!table.frozen()) {
+        table.count(group, umi);
+        return;
+    }
+
+    uint64_t group_identifier(0);
+    table.assign(group, umi, representative, candidate, parent, group_identifier);
+
+    identifier.assign(to_string(group_identifier));
+    identifier.push_back(':');
+    for(const auto& code : representative) {
+        identifier.push_back(BamToAmbiguousAscii[static_cast< uint8_t >(code)]);
+    }
+    output.update_molecular_identifier(identifier);
+};
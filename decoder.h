@@ -25,6 +25,8 @@
 #include "include.h"
 #include "transform.h"
 #include "channel.h"
+#include "codec.h"
+#include "cluster.h"
 
 class Decoder {
     public:
@@ -184,6 +186,18 @@ class MultiplexPAMLDecoder : public PAMLDecoder< Channel > {
         inline void decode(const Read& input, Read& output) override;
 };
 
+class MolecularMDDecoder : public MDDecoder< Barcode > {
+    public:
+        MolecularMDDecoder(const Value& ontology);
+        inline void decode(const Read& input, Read& output) override;
+};
+
+class MolecularPAMLDecoder : public PAMLDecoder< Barcode > {
+    public:
+        MolecularPAMLDecoder(const Value& ontology);
+        inline void decode(const Read& input, Read& output) override;
+};
+
 class CellularMDDecoder : public MDDecoder< Barcode > {
     public:
         CellularMDDecoder(const Value& ontology);
@@ -196,6 +210,48 @@ class CellularPAMLDecoder : public PAMLDecoder< Barcode > {
         inline void decode(const Read& input, Read& output) override;
 };
 
+/*  Decoders backed by a memory mapped precompiled codec index instead of Barcode objects */
+class CodecIndexDecoder : public Decoder {
+    protected:
+        const CodecIndex& index;
+        const Rule rule;
+        Observation observation;
+        const vector< uint8_t > undetermined;
+        int64_t decoded;
+        int32_t decoding_distance;
+        inline const uint8_t* decoded_code() const {
+            return decoded < 0 ? undetermined.data() : index.code(decoded);
+        };
+
+    public:
+        CodecIndexDecoder(const Value& ontology, const CodecIndex& index);
+};
+
+class CellularIndexMDDecoder : public CodecIndexDecoder {
+    protected:
+        const uint8_t quality_masking_threshold;
+        const vector< int32_t > distance_tolerance;
+
+    public:
+        CellularIndexMDDecoder(const Value& ontology, const CodecIndex& index);
+        inline void decode(const Read& input, Read& output) override;
+
+    private:
+        inline bool match(const int64_t& candidate);
+};
+
+class CellularIndexPAMLDecoder : public CodecIndexDecoder {
+    protected:
+        const double confidence_threshold;
+        const double random_barcode_probability;
+        const double adjusted_noise_probability;
+        double conditioned_decoding_probability;
+        double decoding_probability;
+
+    public:
+        CellularIndexPAMLDecoder(const Value& ontology, const CodecIndex& index);
+        inline void decode(const Read& input, Read& output) override;
+};
 
 class MolecularNaiveDecoder : public Decoder {
     protected:
@@ -208,4 +264,24 @@ class MolecularNaiveDecoder : public Decoder {
         inline void decode(const Read& input, Read& output) override;
 };
 
+class MolecularDirectionalDecoder : public Decoder {
+    protected:
+        const int32_t nucleotide_cardinality;
+        const Rule rule;
+        Observation observation;
+        DirectionalClusterTable& table;
+
+    public:
+        MolecularDirectionalDecoder(const Value& ontology, DirectionalClusterTable& table);
+        inline void decode(const Read& input, Read& output) override;
+
+    private:
+        string group;
+        string umi;
+        string representative;
+        string candidate;
+        string parent;
+        string identifier;
+};
+
 #endif /* PHENIQS_DECODER_H */
@@ -62,6 +62,10 @@ void Environment::print_version(ostream& o) const {
     o << "libdeflate " << PHENIQS_LIBDEFLATE_VERSION << endl;
     #endif
 
+    #ifdef PHENIQS_ZSTD_VERSION
+    o << "zstd " << PHENIQS_ZSTD_VERSION << endl;
+    #endif
+
     #ifdef PHENIQS_RAPIDJSON_VERSION
     o << "rapidjson " << PHENIQS_RAPIDJSON_VERSION << endl;
     #endif
@@ -78,11 +82,36 @@ Job* Environment::pop_from_queue() {
     } else { return NULL;}
 };
 void Environment::push_to_queue(Document& operation) {
+    if(operation.IsObject()) {
+        /*  every instruction file provided on the command line is queued as a separate job */
+        Value::MemberIterator reference = operation.FindMember("interactive");
+        if(reference != operation.MemberEnd() && reference->value.IsObject()) {
+            Value& interactive(reference->value);
+            reference = interactive.FindMember("configuration url");
+            if(reference != interactive.MemberEnd() && reference->value.IsArray()) {
+                if(reference->value.Size() > 0) {
+                    for(const auto& element : reference->value.GetArray()) {
+                        Document job_operation;
+                        job_operation.CopyFrom(operation, job_operation.GetAllocator());
+                        job_operation["interactive"]["configuration url"].CopyFrom(element, job_operation.GetAllocator());
+                        enqueue(job_operation);
+                    }
+                    return;
+                } else {
+                    interactive.RemoveMember("configuration url");
+                }
+            }
+        }
+        enqueue(operation);
+    } else { throw ConfigurationError("Job operation element is not a dictionary"); }
+};
+void Environment::enqueue(Document& operation) {
     if(operation.IsObject()) {
         Job* job(NULL);
         string implementation(decode_value_by_key< string >("implementation", operation));
 
         if(implementation == "multiplex") { job = new MultiplexJob(operation); }
+        else if(implementation == "merge") { job = new MergeJob(operation); }
         else { job = new Job(operation); }
 
         job->assemble();
@@ -91,7 +120,6 @@ void Environment::push_to_queue(Document& operation) {
 };
 void Environment::execute_job(Job* job) {
     if(job != NULL) {
-        job->compile();
         if(job->is_validate_only()) {
             job->describe(cerr);
 
@@ -101,13 +129,72 @@ void Environment::execute_job(Job* job) {
         } else if(job->is_compile_only()) {
             job->print_compiled(cout);
 
+        } else if(job->is_compile_codec_only()) {
+            job->compile_codec_index();
+
         } else {
             job->execute();
-            job->print_report(cerr);
+            job->print_report(job->report_stream());
 
         }
     }
 };
+void Environment::execute_concurrently(const list< Job* >& job_array) {
+    /*  The budget is the largest thread count requested by any of the jobs.
+        At most one job per thread runs at a time and every running job starts with an equal share */
+    int32_t capacity(1);
+    for(const auto job : job_array) {
+        int32_t threads(0);
+        if(decode_value_by_key< int32_t >("threads", threads, job->ontology)) {
+            capacity = max(capacity, threads);
+        }
+    }
+    ThreadBudget budget(capacity);
+    const int32_t runner_count(min(budget.capacity, static_cast< int32_t >(job_array.size())));
+    const int32_t share(max(1, budget.capacity / runner_count));
+
+    mutex queue_mutex;
+    list< Job* > pending(job_array);
+    map< const Job*, exception_ptr > error_by_job;
+    auto run = [&]() {
+        while(true) {
+            Job* job(NULL);
+            {
+                lock_guard< mutex > queue_lock(queue_mutex);
+                if(pending.empty()) {
+                    break;
+                }
+                job = pending.front();
+                pending.pop_front();
+            }
+            job->lease_threads(&budget, budget.acquire(share));
+            try {
+                job->execute();
+            } catch(...) {
+                lock_guard< mutex > queue_lock(queue_mutex);
+                error_by_job.emplace(make_pair(job, current_exception()));
+            }
+            job->return_threads();
+        }
+    };
+    vector< thread > runner_array;
+    runner_array.reserve(runner_count);
+    for(int32_t i(0); i < runner_count; ++i) {
+        runner_array.emplace_back(run);
+    }
+    for(auto& runner : runner_array) {
+        runner.join();
+    }
+
+    /* reports are printed in queue order and the first failure is raised once every job is done */
+    for(const auto job : job_array) {
+        auto record(error_by_job.find(job));
+        if(record != error_by_job.end()) {
+            rethrow_exception(record->second);
+        }
+        job->print_report(job->report_stream());
+    }
+};
 void Environment::execute() {
     if(is_help_only()) {
         print_help(cerr);
@@ -119,10 +206,32 @@ void Environment::execute() {
         Document operation(interface.operation());
         push_to_queue(operation);
 
-        Job* job(NULL);
-        while((job = pop_from_queue()) != NULL) {
-            execute_job(job);
-            delete job;
+        if(job_queue.size() > 1) {
+            /*  compile every job before executing any so configuration errors surface early,
+                then execute the jobs that process reads concurrently */
+            list< Job* > job_array;
+            for(auto job : job_queue) {
+                job->compile();
+                if(job->is_executable()) {
+                    job_array.push_back(job);
+                } else {
+                    execute_job(job);
+                }
+            }
+            if(job_array.size() > 1) {
+                execute_concurrently(job_array);
+            } else if(!job_array.empty()) {
+                job_array.front()->execute();
+                job_array.front()->print_report(job_array.front()->report_stream());
+            }
+
+        } else {
+            Job* job(NULL);
+            while((job = pop_from_queue()) != NULL) {
+                job->compile();
+                execute_job(job);
+                delete job;
+            }
         }
     }
 };
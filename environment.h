@@ -24,6 +24,7 @@
 #include "include.h"
 #include "interface.h"
 #include "multiplex.h"
+#include "merge.h"
 
 /* Those are possible return values when pheniqs terminates */
 enum class ProgramState : int8_t {
@@ -60,7 +61,9 @@ class Environment {
         list< Job* > job_queue;
         const bool _help_only;
         const bool _version_only;
+        void enqueue(Document& operation);
         void execute_job(Job* job);
+        void execute_concurrently(const list< Job* >& job_array);
 };
 
 #endif /* PHENIQS_ENVIRONMENT_H */
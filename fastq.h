@@ -24,9 +24,21 @@
 
 #include "include.h"
 #include "feed.h"
+#include "zstandard.h"
 
 KSEQ_INIT(BGZF*, bgzf_read)
 
+inline const uint8_t* find_line_end(const uint8_t* position, const uint8_t* end) {
+    const uint8_t* line_end(static_cast< const uint8_t* >(memchr(position, LINE_BREAK, end - position)));
+    return line_end != NULL ? line_end : end;
+};
+inline const uint8_t* trim_line_end(const uint8_t* begin, const uint8_t* line_end) {
+    return (line_end > begin && *(line_end - 1) == '\r') ? line_end - 1 : line_end;
+};
+inline const uint8_t* next_line(const uint8_t* line_end, const uint8_t* end) {
+    return line_end < end ? line_end + 1 : end;
+};
+
 class FastqRecord {
     FastqRecord(FastqRecord const &) = delete;
     void operator=(FastqRecord const &) = delete;
@@ -36,15 +48,18 @@ class FastqRecord {
         kstring_t quality;
         kstring_t name;
         kstring_t comment;
+        kstring_t raw;
         FastqRecord() :
             sequence({ 0, 0, NULL }),
             quality({ 0, 0, NULL }),
             name({ 0, 0, NULL }),
-            comment({ 0, 0, NULL }) {
+            comment({ 0, 0, NULL }),
+            raw({ 0, 0, NULL }) {
             ks_terminate(sequence);
             ks_terminate(quality);
             ks_terminate(name);
             ks_terminate(comment);
+            ks_terminate(raw);
             clear();
         };
         ~FastqRecord() {
@@ -52,6 +67,7 @@ class FastqRecord {
             ks_free(quality);
             ks_free(name);
             ks_free(comment);
+            ks_free(raw);
         };
         inline void decode(const kseq_t* kseq, const uint8_t phred_offset) {
             // read a kseq record and populate the FastqRecord
@@ -77,6 +93,192 @@ class FastqRecord {
             quality.l = kseq->qual.l;
             quality.s[quality.l] = '\0';
         };
+        /*  parse the record at position in an uncompressed FASTQ buffer and advance position past it.
+            Record boundaries follow kseq: the record starts at the next @, the name ends at the first white space,
+            sequence lines continue to a line starting with +, @ or > and quality lines are consumed
+            until the quality is as long as the sequence. Carriage returns at the end of a line are ignored.
+            returns false at the end of the buffer or if the quality is truncated */
+        inline bool decode(const uint8_t*& position, const uint8_t* end, const uint8_t phred_offset) {
+            clear();
+
+            const uint8_t* cursor(static_cast< const uint8_t* >(memchr(position, '@', end - position)));
+            if(cursor == NULL) {
+                position = end;
+                return false;
+            }
+            ++cursor;
+
+            // name and comment
+            const uint8_t* line_end(find_line_end(cursor, end));
+            const uint8_t* name_end(cursor);
+            while(name_end < line_end && !isspace(*name_end)) {
+                ++name_end;
+            }
+            ks_put_string(reinterpret_cast< const char* >(cursor), name_end - cursor, name);
+            if(name_end < line_end) {
+                cursor = name_end + 1;
+                ks_put_string(reinterpret_cast< const char* >(cursor), trim_line_end(cursor, line_end) - cursor, comment);
+            }
+            cursor = next_line(line_end, end);
+
+            // decode sequence
+            while(cursor < end && *cursor != '+' && *cursor != '@' && *cursor != '>') {
+                line_end = find_line_end(cursor, end);
+                const uint8_t* trimmed(trim_line_end(cursor, line_end));
+                ks_increase_by_size(sequence, (trimmed - cursor) + 2);
+                for(; cursor < trimmed; ++cursor) {
+                    sequence.s[sequence.l] = AsciiToAmbiguousBam[*cursor];
+                    ++sequence.l;
+                }
+                cursor = next_line(line_end, end);
+            }
+            sequence.s[sequence.l] = '\0';
+
+            // decode quality
+            if(cursor < end && *cursor == '+') {
+                cursor = next_line(find_line_end(cursor, end), end);
+                while(quality.l < sequence.l && cursor < end) {
+                    line_end = find_line_end(cursor, end);
+                    const uint8_t* trimmed(trim_line_end(cursor, line_end));
+                    ks_increase_by_size(quality, (trimmed - cursor) + 2);
+                    for(; cursor < trimmed; ++cursor) {
+                        quality.s[quality.l] = *cursor - phred_offset;
+                        ++quality.l;
+                    }
+                    cursor = next_line(line_end, end);
+                }
+                quality.s[quality.l] = '\0';
+                position = cursor;
+                return quality.l == sequence.l;
+            }
+            position = cursor;
+            return true;
+        };
+        /*  read the next record from the kseq stream into raw without decoding it.
+            Record boundaries follow kseq_read and the text is kept as read,
+            only the separator line is written as a single +.
+            returns the sequence length, -1 at the end of the stream, -2 if the quality is truncated,
+            -3 on a stream error and -4 if the record has no quality, which is the case for FASTA */
+        inline int read_raw(kstream_t* ks) {
+            clear();
+
+            int c;
+            while((c = ks_getc(ks)) >= 0 && c != '@' && c != '>');
+            if(c < 0) {
+                return c;
+            } else if(c == '>') {
+                return -4;
+            }
+
+            // identifier line
+            ks_put_character('@', raw);
+            if(ks_getuntil2(ks, KS_SEP_LINE, &raw, NULL, 1) < 0) {
+                return -1;
+            }
+            ks_put_character(LINE_BREAK, raw);
+
+            // sequence lines, empty lines are skipped like kseq does
+            size_t sequence_length(0);
+            while((c = ks_getc(ks)) >= 0 && c != '+' && c != '@' && c != '>') {
+                if(c != LINE_BREAK) {
+                    const size_t begin(raw.l);
+                    ks_put_character(static_cast< char >(c), raw);
+                    ks_getuntil2(ks, KS_SEP_LINE, &raw, NULL, 1);
+                    sequence_length += raw.l - begin;
+                    ks_put_character(LINE_BREAK, raw);
+                }
+            }
+            if(c != '+') {
+                return c < -1 ? c : -4;
+            }
+
+            // separator line
+            while((c = ks_getc(ks)) >= 0 && c != LINE_BREAK);
+            if(c < 0) {
+                return -2;
+            }
+            ks_put_character('+', raw);
+            ks_put_character(LINE_BREAK, raw);
+
+            // quality lines are consumed until the quality is as long as the sequence
+            size_t quality_length(0);
+            while(quality_length < sequence_length) {
+                const size_t begin(raw.l);
+                if(ks_getuntil2(ks, KS_SEP_LINE, &raw, NULL, 1) < 0) {
+                    break;
+                }
+                quality_length += raw.l - begin;
+                ks_put_character(LINE_BREAK, raw);
+            }
+            return quality_length == sequence_length ? static_cast< int >(sequence_length) : -2;
+        };
+        /*  find the boundaries of the record at position in an uncompressed FASTQ buffer the same way decode does,
+            copy the record text to raw without decoding it and advance position past it.
+            returns the same codes as reading from a kseq stream */
+        inline int read_raw(const uint8_t*& position, const uint8_t* end) {
+            clear();
+
+            const uint8_t* begin(static_cast< const uint8_t* >(memchr(position, '@', end - position)));
+            if(begin == NULL) {
+                position = end;
+                return -1;
+            }
+            const uint8_t* cursor(next_line(find_line_end(begin, end), end));
+            const uint8_t* line_end;
+
+            size_t sequence_length(0);
+            while(cursor < end && *cursor != '+' && *cursor != '@' && *cursor != '>') {
+                line_end = find_line_end(cursor, end);
+                sequence_length += trim_line_end(cursor, line_end) - cursor;
+                cursor = next_line(line_end, end);
+            }
+            if(cursor == end || *cursor != '+') {
+                position = cursor;
+                return -4;
+            }
+            cursor = next_line(find_line_end(cursor, end), end);
+
+            size_t quality_length(0);
+            while(quality_length < sequence_length && cursor < end) {
+                line_end = find_line_end(cursor, end);
+                quality_length += trim_line_end(cursor, line_end) - cursor;
+                cursor = next_line(line_end, end);
+            }
+            position = cursor;
+
+            ks_put_string(reinterpret_cast< const char* >(begin), cursor - begin, raw);
+            if(raw.s[raw.l - 1] != LINE_BREAK) {
+                ks_put_character(LINE_BREAK, raw);
+            }
+            return quality_length == sequence_length ? static_cast< int >(sequence_length) : -2;
+        };
+        /*  move the record text to the segment without decoding it.
+            Only the identifier is copied, and on Illumina the filtered flag parsed from the comment */
+        inline void detach(Segment& segment) {
+            swap(raw, segment.raw);
+            segment.forwarded = true;
+            segment.set_qcfail(false);
+
+            const char* cursor(segment.raw.s + 1);
+            const char* line_end(static_cast< const char* >(memchr(cursor, LINE_BREAK, segment.raw.l - 1)));
+            const char* name_end(cursor);
+            while(name_end < line_end && !isspace(*name_end)) {
+                ++name_end;
+            }
+            ks_put_string(cursor, name_end - cursor, segment.name);
+
+            if(segment.platform == Platform::ILLUMINA && name_end < line_end) {
+                ks_put_string(name_end + 1, line_end - name_end - 1, segment.auxiliary.CO);
+                size_t offset(0);
+                parse_illumina_segment_index(segment, offset);
+                parse_illumina_filtered(segment, offset);
+            }
+        };
+        /*  take over the record text forwarded with the segment */
+        inline void attach(const Segment& segment) {
+            clear();
+            swap(raw, segment.raw);
+        };
         inline void decode(const Segment& segment) {
             clear();
 
@@ -137,6 +339,11 @@ class FastqRecord {
             };
         };
         inline void encode(kstring_t& buffer, const uint8_t phred_offset) const {
+            if(!ks_empty(raw)) {
+                ks_put_string(raw, buffer);
+                return;
+            }
+
             // encode identifier
             ks_put_character('@', buffer);
             ks_put_string(name, buffer);
@@ -171,6 +378,7 @@ class FastqRecord {
             ks_clear(quality);
             ks_clear(name);
             ks_clear(comment);
+            ks_clear(raw);
         };
         inline void decode_comment(const Segment& segment) {
             switch (segment.platform) {
@@ -325,14 +533,57 @@ class FastqFeed : public BufferedFeed< FastqRecord > {
     public:
         FastqFeed(const FeedProxy& proxy) :
             BufferedFeed< FastqRecord >(proxy),
-            bgzf_file(NULL) {
+            compression_workers(proxy.compression_workers),
+            bgzf_file(NULL),
+            shard_origin(0),
+            seekable(false),
+            anchor_offset(-1),
+            anchor_address(0),
+            mapped(NULL),
+            mapped_position(NULL) {
         };
         void open() override {
             if(!opened()) {
                 switch(direction) {
                     case IoDirection::IN: {
-                        bgzf_file = bgzf_hopen(hfile, "r");
+                        /*  uncompressed FASTQ in a memory mapped file is parsed directly out of the mapping,
+                            compressed input is decompressed from the mapping by bgzf */
+                        if(!sharded && resume_position.offset < 0 && (mapped = mapped_file(hfile)) != NULL) {
+                            if(*(mapped->begin) == '@') {
+                                mapped_position = mapped->begin;
+                                if(resume_position.offset == -1) {
+                                    if(resume_position.skip > mapped->end - mapped->begin) {
+                                        throw IOError("input " + string(url) + " ended before the checkpoint position");
+                                    }
+                                    mapped_position += resume_position.skip;
+                                }
+                                break;
+                            }
+                            mapped = NULL;
+                        }
+                        bgzf_file = bgzf_hopen(is_zstd(hfile) ? hopen_zstd_reader(hfile) : hfile, "r");
                         if(bgzf_file != NULL) {
+                            /* only BGZF can be sought, other input is read from the beginning and discarded up to the position */
+                            seekable = bgzf_compression(bgzf_file) == bgzf;
+                            anchor_address = bgzf_file->uncompressed_address;
+                            if(resume_position.offset > -2) {
+                                if(resume_position.offset >= 0) {
+                                    if(!seekable || bgzf_seek(bgzf_file, resume_position.offset, SEEK_SET) < 0) {
+                                        throw IOError("failed to seek to checkpoint position in " + string(url));
+                                    }
+                                    anchor_offset = resume_position.offset;
+                                    anchor_address = bgzf_file->uncompressed_address;
+                                }
+                                discard(resume_position.skip);
+                                shard_origin = bgzf_file->uncompressed_address - resume_position.consumed;
+                            } else {
+                                if(sharded && shard_begin > 0) {
+                                    if(bgzf_seek(bgzf_file, shard_begin, SEEK_SET) < 0) {
+                                        throw IOError("failed to seek to shard in " + string(url));
+                                    }
+                                }
+                                shard_origin = bgzf_file->uncompressed_address;
+                            }
                             kseq = kseq_init(bgzf_file);
                             // bgzf_thread_pool(bgzf_file, thread_pool->pool, thread_pool->qsize);
                         } else {
@@ -342,7 +593,11 @@ class FastqFeed : public BufferedFeed< FastqRecord > {
                     };
                     case IoDirection::OUT: {
                         if(url.compression() == "gz") {
-                            bgzf_file = bgzf_hopen(hfile, "wg");
+                            bgzf_file = bgzf_hopen(hfile, output_mode("wg").c_str());
+                        } else if(url.compression() == "zst") {
+                            /* zstd compresses with its own worker threads, this output's share of the compression pool */
+                            const int32_t level(compression_level < 0 ? DEFAULT_ZSTD_LEVEL : compression_level);
+                            bgzf_file = bgzf_hopen(hopen_zstd_writer(hfile, level, compression_workers), "wu");
                         } else {
                             bgzf_file = bgzf_hopen(hfile, "wu");
                         }
@@ -362,32 +617,116 @@ class FastqFeed : public BufferedFeed< FastqRecord > {
         };
         void close() override {
             if(opened()) {
-                bgzf_close(bgzf_file);
-                bgzf_file = NULL;
+                if(mapped != NULL) {
+                    hclose(hfile);
+                    mapped = NULL;
+                    mapped_position = NULL;
+                } else {
+                    bgzf_close(bgzf_file);
+                    bgzf_file = NULL;
 
-                kseq_destroy(kseq);
-                kseq = NULL;
+                    kseq_destroy(kseq);
+                    kseq = NULL;
+                }
             }
         };
         inline bool opened() override {
-            return bgzf_file != NULL;
+            return bgzf_file != NULL || mapped != NULL;
         };
 
     protected:
+        const int32_t compression_workers;
         BGZF* bgzf_file;
         kseq_t* kseq;
+        int64_t shard_origin;
+        bool seekable;
+        int64_t anchor_offset;
+        int64_t anchor_address;
+        MappedFile* mapped;
+        const uint8_t* mapped_position;
         inline void encode(FastqRecord* record, const Segment& segment) const override {
             record->decode(segment);
         };
         inline void decode(const FastqRecord* record, Segment& segment) override {
             record->encode(segment);
         };
+        inline void detach(FastqRecord* record, Segment& segment) override {
+            record->detach(segment);
+        };
+        inline void attach(FastqRecord* record, const Segment& segment) const override {
+            record->attach(segment);
+        };
+        /*  kseq reads ahead into its own buffer, so the uncompressed position of the next record
+            is what bgzf delivered less what kseq has not parsed yet and, for FASTA, the
+            header character of the next record that was already consumed */
+        inline bool is_shard_exhausted() const {
+            if(shard_begin < 0) {
+                return true;
+            } else if(shard_length < 0) {
+                return false;
+            } else {
+                const int64_t position(
+                    (bgzf_file->uncompressed_address - shard_origin) -
+                    (kseq->f->end - kseq->f->begin) -
+                    (kseq->last_char > 0 ? 1 : 0));
+                return position >= shard_length;
+            }
+        };
+        /*  Positions are kept relative to an anchor, the start of the most recent BGZF block known to begin
+            before the record, or the beginning of the data when the input can not be sought. */
+        inline void locate(FeedPosition& position) {
+            const int64_t address(
+                bgzf_file->uncompressed_address -
+                (kseq->f->end - kseq->f->begin) -
+                (kseq->last_char > 0 ? 1 : 0));
+            if(seekable) {
+                const int64_t block_address(bgzf_file->uncompressed_address - bgzf_file->block_offset);
+                if(block_address <= address) {
+                    anchor_offset = bgzf_file->block_address << 16;
+                    anchor_address = block_address;
+                }
+            }
+            position.offset = anchor_offset;
+            position.skip = address - anchor_address;
+            position.consumed = address - shard_origin;
+        };
+        inline void discard(int64_t remaining) {
+            vector< char > scratch(static_cast< size_t >(min(remaining, static_cast< int64_t >(BGZF_MAX_BLOCK_SIZE))));
+            while(remaining > 0) {
+                const ssize_t consumed(bgzf_read(bgzf_file, scratch.data(), static_cast< size_t >(min(remaining, static_cast< int64_t >(scratch.size())))));
+                if(consumed <= 0) {
+                    throw IOError("input " + string(url) + " ended before the checkpoint position");
+                }
+                remaining -= consumed;
+            }
+        };
         inline void replenish_buffer() override {
+            if(mapped != NULL) {
+                replenish_mapped_buffer();
+                return;
+            }
             while(opened() && buffer->is_not_full()) {
+                if(sharded && is_shard_exhausted()) {
+                    close();
+                    break;
+                }
+                if(position_tracking) {
+                    locate(buffer->vacant_position());
+                }
              /* >=0  length of the sequence (normal)
                 -1   end-of-file
                 -2   truncated quality string */
-                if(kseq_read(kseq) < 0) {
+                if(forwarding) {
+                    const int status(buffer->vacant()->read_raw(kseq->f));
+                    if(status < 0) {
+                        if(status == -4) {
+                            throw IOError("FASTA record in " + string(url) + " can not be forwarded");
+                        }
+                        close();
+                        break;
+                    }
+                    buffer->increment();
+                } else if(kseq_read(kseq) < 0) {
                     close();
                     break;
                 } else {
@@ -396,6 +735,37 @@ class FastqFeed : public BufferedFeed< FastqRecord > {
                 }
             }
         };
+        inline void replenish_mapped_buffer() {
+            while(opened() && buffer->is_not_full()) {
+                const uint8_t* begin(mapped_position);
+                if(position_tracking) {
+                    FeedPosition& position(buffer->vacant_position());
+                    position.offset = -1;
+                    position.skip = begin - mapped->begin;
+                    position.consumed = position.skip;
+                }
+                if(forwarding) {
+                    const int status(buffer->vacant()->read_raw(mapped_position, mapped->end));
+                    if(status < 0) {
+                        if(status == -4) {
+                            throw IOError("FASTA record in " + string(url) + " can not be forwarded");
+                        }
+                        close();
+                        break;
+                    }
+                    buffer->increment();
+                } else if(buffer->vacant()->decode(mapped_position, mapped->end, phred_offset)) {
+                    buffer->increment();
+                } else {
+                    close();
+                    break;
+                }
+            }
+            /* pages behind the parsed records are not needed again */
+            if(mapped != NULL) {
+                mapped->release(mapped_position);
+            }
+        };
         inline void flush_buffer() override {
             /*  encode all fastq records in the buffer to
                 a string buffer and write them together to the stream */
@@ -411,5 +781,20 @@ class FastqFeed : public BufferedFeed< FastqRecord > {
                 }
             }
         };
+        inline int64_t synchronize() override {
+            /*  bgzf_flush closes the current block and waits for the compression threads
+                so the file ends on a BGZF block boundary. For zstd output bgzf writes to the zstd hfile,
+                flushing it ends the zstd frame and flushes the file under it */
+            if(bgzf_flush(bgzf_file) < 0 || hflush(bgzf_file->fp) < 0) {
+                throw IOError("error flushing " + string(url));
+            }
+            if(url.is_standard_stream()) {
+                return -1;
+            }
+            sync_url(url);
+
+            /* an hFILE opened for append counts from where it was opened */
+            return resume_offset + htell(hfile);
+        };
 };
 #endif /* PHENIQS_FASTQ_H */
@@ -25,6 +25,8 @@
 #include "include.h"
 #include "proxy.h"
 #include "read.h"
+#include "profile.h"
+#include "numa.h"
 
 inline int cyclic_modulo(const int x, const int y) {
     return x < 0 ? y - (-x % y) : x % y;
@@ -36,6 +38,28 @@ inline int align_to_resolution(const int& capacity, const int& resolution) {
     }
     return aligned;
 };
+/*  hFILE does not expose its file descriptor so the file is synchronized through a second descriptor,
+    fsync writes every dirty page of the file regardless of which descriptor it is called on */
+inline void sync_url(const URL& url) {
+    int descriptor(::open(url.c_str(), O_RDONLY));
+    if(descriptor < 0 || fsync(descriptor) != 0) {
+        if(descriptor >= 0) {
+            ::close(descriptor);
+        }
+        throw IOError("failed to synchronize " + string(url));
+    }
+    ::close(descriptor);
+};
+
+/*  Where an input record starts, so a resumed run can seek to the first record it has not processed.
+    offset is a BGZF virtual offset, -1 for the beginning of the data or -2 when the record can not be sought to.
+    skip is the number of uncompressed bytes to discard after seeking to offset
+    and consumed the number of uncompressed bytes read from the beginning of the shard */
+struct FeedPosition {
+    int64_t offset;
+    int64_t skip;
+    int64_t consumed;
+};
 
 /* IO feed */
 class Feed {
@@ -45,17 +69,30 @@ class Feed {
         const IoDirection direction;
         const uint8_t phred_offset;
         const Platform platform;
+        const int64_t resume_offset;
+        const int32_t compression_level;
         Feed(const FeedProxy& proxy) :
             index(proxy.index),
             url(proxy.url),
             direction(proxy.direction),
             phred_offset(proxy.phred_offset),
             platform(proxy.platform),
+            resume_offset(max(proxy.resume_offset, static_cast< int64_t >(0))),
+            compression_level(proxy.compression_level),
             _capacity(proxy.capacity),
             _resolution(proxy.resolution),
             exhausted(false),
             hfile(proxy.hfile),
-            thread_pool(NULL) {
+            thread_pool(NULL),
+            _record_count(0),
+            sharded(false),
+            shard_begin(-1),
+            shard_end(-1),
+            shard_length(-1),
+            forwarding(false),
+            tag_augmentation(false),
+            position_tracking(false),
+            resume_position({ -2, 0, 0 }) {
         };
         virtual ~Feed() {
         };
@@ -65,6 +102,15 @@ class Feed {
         const inline int& resolution() const {
             return _resolution;
         };
+        /*  number of records that passed through the feed so far.
+            updated with a relaxed atomic so it can be sampled by the progress reporter */
+        inline uint64_t record_count() const {
+            return _record_count.load(memory_order_relaxed);
+        };
+        /*  number of records currently waiting in the feed queue */
+        virtual int occupancy() {
+            return 0;
+        };
         virtual void join() = 0;
         virtual void start() = 0;
         virtual void stop() = 0;
@@ -78,13 +124,66 @@ class Feed {
         virtual inline bool is_dev_null() {
             return url.is_dev_null();
         };
+        /*  htslib open mode with the compression level appended when one was requested.
+            level 0 writes uncompressed BGZF blocks that any BGZF reader still accepts */
+        inline string output_mode(const char* mode) const {
+            string result(mode);
+            if(compression_level >= 0) {
+                result.append(to_string(compression_level));
+            }
+            return result;
+        };
         virtual void calibrate_resolution(const int& resolution) = 0;
         virtual unique_lock< mutex > acquire_pull_lock() = 0;
         virtual unique_lock< mutex > acquire_push_lock() = 0;
         virtual inline bool opened() = 0;
+        /*  write every record pushed so far to stable storage and return the size of the output file.
+            must only be called while no records are being pushed. -1 if the feed can not be checkpointed */
+        virtual int64_t checkpoint() {
+            return -1;
+        };
+        /*  position of the next record an input feed will deliver.
+            must only be called while no records are being pulled. false if the position is not known */
+        virtual bool tell(FeedPosition& position) {
+            return false;
+        };
         virtual void set_thread_pool(htsThreadPool* pool) {
             thread_pool = pool;
         };
+        /*  cores the feed thread is bound to when it starts, empty for no binding */
+        void set_cpu_affinity(const vector< int32_t >& cpu_array) {
+            cpu_affinity = cpu_array;
+        };
+        /*  move the original record of every input segment into the segment without decoding it.
+            An output feed of the same format writes a forwarded segment as the record it carries */
+        void set_forwarding(const bool& value) {
+            forwarding = value;
+        };
+        /*  an input feed also decodes the length and auxiliary tags of a forwarded record so decoders can read it
+            and an output feed writes a forwarded record with the auxiliary tags assigned during decoding appended */
+        void set_tag_augmentation(const bool& value) {
+            tag_augmentation = value;
+        };
+        /*  restrict an input feed to the records between two BGZF virtual offsets.
+            begin is -1 for an empty shard, end and length are -1 when the shard extends to the end of the file */
+        void set_shard(const int64_t& begin, const int64_t& end, const int64_t& length) {
+            sharded = true;
+            shard_begin = begin;
+            shard_end = end;
+            shard_length = length;
+        };
+        /*  record where every input record starts so tell can report it */
+        void set_position_tracking(const bool& value) {
+            position_tracking = value;
+        };
+        /*  start an input feed at a position previously reported by tell instead of the beginning of the file */
+        void set_resume_position(const FeedPosition& position) {
+            resume_position = position;
+        };
+
+        #if defined(PHENIQS_PROFILE)
+        FeedProfile profile;
+        #endif
 
     protected:
         int _capacity;
@@ -92,6 +191,16 @@ class Feed {
         bool exhausted;
         hFILE* hfile;
         htsThreadPool* thread_pool;
+        atomic< uint64_t > _record_count;
+        vector< int32_t > cpu_affinity;
+        bool sharded;
+        int64_t shard_begin;
+        int64_t shard_end;
+        int64_t shard_length;
+        bool forwarding;
+        bool tag_augmentation;
+        bool position_tracking;
+        FeedPosition resume_position;
 };
 
 class NullFeed : public Feed {
@@ -139,6 +248,9 @@ class NullFeed : public Feed {
         inline bool opened() override {
             return true;
         };
+        int64_t checkpoint() override {
+            return 0;
+        };
         void set_thread_pool(htsThreadPool* pool) override {
 
         };
@@ -155,6 +267,7 @@ template < class T > class CyclicBuffer {
             _next(-1),
             _vacant(0) {
             increase_capacity(align_to_resolution(capacity, resolution));
+            position_array.resize(_capacity);
         };
         virtual ~CyclicBuffer() {
         };
@@ -199,6 +312,12 @@ template < class T > class CyclicBuffer {
         inline T* next() const {
             return cache[_next];
         };
+        inline FeedPosition& vacant_position() {
+            return position_array[_vacant];
+        };
+        inline const FeedPosition& next_position() const {
+            return position_array[_next];
+        };
         inline T* at(const int& position) const {
             if(position < size()) {
                 return cache[(_next + position) % _capacity];
@@ -243,6 +362,7 @@ template < class T > class CyclicBuffer {
                 T* migrated = other->cache[other->_next];
                 other->cache[other->_next] = cache[_vacant];
                 cache[_vacant] = migrated;
+                swap(position_array[_vacant], other->position_array[other->_next]);
                 other->decrement();
                 increment();
             }
@@ -252,6 +372,7 @@ template < class T > class CyclicBuffer {
                 int aligned_capacity(align_to_resolution(_capacity, resolution));
                 if(aligned_capacity > _capacity) {
                     increase_capacity(aligned_capacity);
+                    position_array.resize(_capacity);
                 }
                 _resolution = resolution;
             }
@@ -265,6 +386,7 @@ template < class T > class CyclicBuffer {
         int _next;
         int _vacant;
         vector< T* > cache;
+        vector< FeedPosition > position_array;
         int index;
         virtual int increase_capacity(const int& capacity);
 };
@@ -278,7 +400,7 @@ template < class T > class BufferedFeed : public Feed {
             queue = tmp;
         };
         inline bool is_ready_to_flush() {
-            return queue->is_full() || exhausted;
+            return queue->is_full() || exhausted || draining;
         };
 
     public:
@@ -287,7 +409,9 @@ template < class T > class BufferedFeed : public Feed {
             kbuffer({ 0, 0, NULL }),
             buffer(new CyclicBuffer< T >(direction, proxy.capacity, proxy.resolution)),
             queue(new CyclicBuffer< T >(direction, proxy.capacity, proxy.resolution)),
-            started(false) {
+            started(false),
+            draining(false),
+            checkpoint_offset(-1) {
             ks_terminate(kbuffer);
         };
         virtual ~BufferedFeed() {
@@ -312,8 +436,13 @@ template < class T > class BufferedFeed : public Feed {
         bool pull(Segment& segment) override {
             /*  called in a safe context after acquire_pull_lock */
             if(queue->is_not_empty()) {
-                decode(queue->next(), segment);
+                if(forwarding) {
+                    detach(queue->next(), segment);
+                } else {
+                    decode(queue->next(), segment);
+                }
                 queue->decrement();
+                _record_count.fetch_add(1, memory_order_relaxed);
 
                 if(queue->is_empty()) {
                     /* wake up the replenishing thread */
@@ -324,8 +453,13 @@ template < class T > class BufferedFeed : public Feed {
             return false;
         };
         void push(const Segment& segment) override {
-            encode(queue->vacant(), segment);
+            if(segment.forwarded) {
+                attach(queue->vacant(), segment);
+            } else {
+                encode(queue->vacant(), segment);
+            }
             queue->increment();
+            _record_count.fetch_add(1, memory_order_relaxed);
 
             if(is_ready_to_flush()) {
                 flushable.notify_one();
@@ -346,25 +480,71 @@ template < class T > class BufferedFeed : public Feed {
             flush_buffer();
 
             unique_lock< mutex > queue_lock(queue_mutex);
+
+            #if defined(PHENIQS_PROFILE)
+            steady_clock::time_point checkpoint(steady_clock::now());
+            #endif
+
             flushable.wait(queue_lock, [this](){ return is_ready_to_flush(); });
 
+            #if defined(PHENIQS_PROFILE)
+            profile.increment_flushable(checkpoint);
+            #endif
+
             if(queue->is_not_empty()) {
                 switch_buffer_and_queue();
                 queue_not_full.notify_all();
                 return true;
+            } else if(draining) {
+                /*  the buffer was written when this flush started and the queue is empty
+                    so everything pushed before the checkpoint is in the file */
+                checkpoint_offset = synchronize();
+                draining = false;
+                drained.notify_all();
+                return true;
             } else {
                 close();
                 return false;
             }
         };
+        int64_t checkpoint() override {
+            /*  the feed thread writes the queue and synchronizes the file when it sees the drain request */
+            unique_lock< mutex > queue_lock(queue_mutex);
+            draining = true;
+            flushable.notify_one();
+            drained.wait(queue_lock, [this]() { return !draining; });
+            return checkpoint_offset;
+        };
+        bool tell(FeedPosition& position) override {
+            /*  pivots pull from the queue and the buffer is only swapped in once the queue is empty,
+                so the next record is at the front of the queue once the feed thread has refilled it */
+            if(position_tracking) {
+                unique_lock< mutex > queue_lock(queue_mutex);
+                queue_not_empty.wait(queue_lock, [this]() { return queue->is_not_empty() || exhausted; });
+                if(queue->is_not_empty()) {
+                    position = queue->next_position();
+                    return position.offset > -2;
+                }
+            }
+            return false;
+        };
         inline bool replenish() override {
             /*  used by the producer to fill the buffer from the input */
             unique_lock< mutex > buffer_lock(buffer_mutex);
             replenish_buffer();
 
             unique_lock< mutex > queue_lock(queue_mutex);
+
+            #if defined(PHENIQS_PROFILE)
+            steady_clock::time_point checkpoint(steady_clock::now());
+            #endif
+
             replenishable.wait(queue_lock, [this](){ return queue->is_empty(); });
 
+            #if defined(PHENIQS_PROFILE)
+            profile.increment_replenishable(checkpoint);
+            #endif
+
             if(buffer->is_not_empty()) {
                 switch_buffer_and_queue();
             } else {
@@ -398,14 +578,36 @@ template < class T > class BufferedFeed : public Feed {
                 } else { _resolution = resolution; }
             }
         };
+        int occupancy() override {
+            lock_guard< mutex > queue_lock(queue_mutex);
+            return queue->size();
+        };
         unique_lock< mutex > acquire_pull_lock() override {
+            #if defined(PHENIQS_PROFILE)
+            steady_clock::time_point checkpoint(steady_clock::now());
+            #endif
+
             unique_lock< mutex > queue_lock(queue_mutex);
             queue_not_empty.wait(queue_lock, [this]() { return queue->is_not_empty() || exhausted; });
+
+            #if defined(PHENIQS_PROFILE)
+            profile.increment_pull_lock(checkpoint);
+            #endif
+
             return queue_lock;
         };
         unique_lock< mutex > acquire_push_lock() override {
+            #if defined(PHENIQS_PROFILE)
+            steady_clock::time_point checkpoint(steady_clock::now());
+            #endif
+
             unique_lock< mutex > queue_lock(queue_mutex);
             queue_not_full.wait(queue_lock, [this]() { return queue->is_not_full(); });
+
+            #if defined(PHENIQS_PROFILE)
+            profile.increment_push_lock(checkpoint);
+            #endif
+
             return queue_lock;
         };
 
@@ -415,11 +617,24 @@ template < class T > class BufferedFeed : public Feed {
         CyclicBuffer< T >* queue;
         virtual void encode(T* record, const Segment& segment) const = 0;
         virtual void decode(const T* record, Segment& segment) = 0;
+        /*  move a record from the buffer into a segment without decoding it
+            and move a forwarded record from a segment into the buffer */
+        virtual void detach(T* record, Segment& segment) {
+            throw InternalError(string(url) + " can not forward records");
+        };
+        virtual void attach(T* record, const Segment& segment) const {
+            throw InternalError(string(url) + " can not forward records");
+        };
         virtual void replenish_buffer() = 0;
         virtual void flush_buffer() = 0;
+        virtual int64_t synchronize() {
+            return -1;
+        };
 
     private:
         bool started;
+        bool draining;
+        int64_t checkpoint_offset;
         thread feed_thread;
         mutex buffer_mutex;
         mutex queue_mutex;
@@ -427,7 +642,13 @@ template < class T > class BufferedFeed : public Feed {
         condition_variable replenishable;
         condition_variable queue_not_full;
         condition_variable flushable;
+        condition_variable drained;
         void run() {
+            /*  the feed was constructed on the node it is bound to and
+                records grown by the feed thread are placed on the same node */
+            if(!cpu_affinity.empty()) {
+                bind_current_thread(cpu_affinity);
+            }
             switch(direction) {
                 case IoDirection::IN: {
                     while(replenish());
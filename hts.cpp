@@ -166,6 +166,333 @@ ostream& operator<<(ostream& o, const HtsHeader& header) {
     }
     return o;
 };
+hts_opt* decode_cram_option(const list< string >& value) {
+    hts_opt* result(NULL);
+    for(const auto& option : value) {
+        if(hts_opt_add(&result, option.c_str()) < 0) {
+            hts_opt_free(result);
+            throw ConfigurationError("invalid CRAM option " + option);
+        }
+    }
+    for(hts_opt* option(result); option != NULL; option = option->next) {
+        if(option->opt == HTS_OPT_NTHREADS || option->opt == HTS_OPT_THREAD_POOL) {
+            const string name(option->arg);
+            hts_opt_free(result);
+            throw ConfigurationError("CRAM option " + name + " conflicts with the shared compression thread pool");
+        }
+    }
+    return result;
+};
+
+static inline void append_string_tag(const bam1_t* record, const char* tag, string& key) {
+    uint8_t* value(bam_aux_get(record, tag));
+    if(value != NULL) {
+        char* decoded(bam_aux2Z(value));
+        if(decoded != NULL) {
+            key.append(decoded);
+        }
+    }
+};
+
+HtsRecordGrouper::HtsRecordGrouper(const URL& url, const RecordGrouping& grouping, const int32_t& memory, bam_hdr_t* hdr, htsThreadPool* thread_pool) :
+    url(url),
+    grouping(grouping),
+    capacity(static_cast< size_t >(max(memory, 1)) << 10),
+    hdr(hdr),
+    thread_pool(thread_pool),
+    occupied(0),
+    ordinal(0) {
+};
+HtsRecordGrouper::~HtsRecordGrouper() {
+    for(auto& grouped : run) {
+        bam_destroy1(grouped.record);
+    }
+    for(auto record : vacant) {
+        bam_destroy1(record);
+    }
+    for(const auto& path : run_path_array) {
+        unlink(path.c_str());
+    }
+};
+void HtsRecordGrouper::encode_key(const bam1_t* record, string& key) const {
+    key.clear();
+    append_string_tag(record, "CB", key);
+    if(grouping == RecordGrouping::MOLECULAR) {
+        key.push_back('\t');
+        if(bam_aux_get(record, "MI") != NULL) {
+            append_string_tag(record, "MI", key);
+        } else {
+            append_string_tag(record, "RX", key);
+        }
+    }
+};
+void HtsRecordGrouper::add(const bam1_t* record) {
+    bam1_t* copy(NULL);
+    if(!vacant.empty()) {
+        copy = vacant.back();
+        vacant.pop_back();
+    } else if((copy = bam_init1()) == NULL) {
+        throw OutOfMemoryError();
+    }
+    if(bam_copy1(copy, record) == NULL) {
+        bam_destroy1(copy);
+        throw OutOfMemoryError();
+    }
+    run.emplace_back();
+    GroupedRecord& grouped(run.back());
+    grouped.record = copy;
+    grouped.ordinal = ordinal;
+    encode_key(copy, grouped.key);
+    ++ordinal;
+
+    occupied += sizeof(GroupedRecord) + sizeof(bam1_t) + copy->m_data + grouped.key.capacity();
+    if(occupied > capacity) {
+        spill();
+    }
+};
+void HtsRecordGrouper::sort_run() {
+    sort(run.begin(), run.end(), [](const GroupedRecord& left, const GroupedRecord& right) {
+        int comparison(left.key.compare(right.key));
+        return comparison < 0 || (comparison == 0 && left.ordinal < right.ordinal);
+    });
+};
+string HtsRecordGrouper::temporary_path() const {
+    string path;
+    if(url.is_standard_stream()) {
+        const char* directory(getenv("TMPDIR"));
+        path.assign(directory != NULL && *directory != '\0' ? directory : "/tmp");
+        path.append("/pheniqs");
+    } else {
+        path.assign(url.path());
+    }
+    path.append(".XXXXXX");
+
+    vector< char > buffer(path.begin(), path.end());
+    buffer.push_back('\0');
+    int descriptor(mkstemp(buffer.data()));
+    if(descriptor < 0) {
+        throw IOError("failed to create temporary file " + path);
+    }
+    ::close(descriptor);
+    return string(buffer.data());
+};
+void HtsRecordGrouper::spill() {
+    if(!run.empty()) {
+        sort_run();
+
+        /* register the path before writing so it is removed even if writing fails */
+        run_path_array.emplace_back(temporary_path());
+        const string& path(run_path_array.back());
+
+        htsFile* run_file(hts_open(path.c_str(), "wb1"));
+        if(run_file == NULL) {
+            throw IOError("failed to open " + path + " for writing");
+        }
+        if(thread_pool != NULL) {
+            hts_set_thread_pool(run_file, thread_pool);
+        }
+        bool failed(sam_hdr_write(run_file, hdr) < 0);
+        for(auto grouped = run.begin(); !failed && grouped != run.end(); ++grouped) {
+            failed = sam_write1(run_file, hdr, grouped->record) < 0;
+        }
+        if(hts_close(run_file) < 0 || failed) {
+            throw IOError("error writing to " + path);
+        }
+
+        /* keep the records allocated for the next run */
+        for(auto& grouped : run) {
+            vacant.push_back(grouped.record);
+        }
+        run.clear();
+        occupied = 0;
+    }
+};
+bool HtsRecordGrouper::advance(RunCursor& cursor) const {
+    if(cursor.hts_file != NULL) {
+        int status(sam_read1(cursor.hts_file, hdr, cursor.record));
+        if(status >= 0) {
+            encode_key(cursor.record, cursor.key);
+            return true;
+        } else if(status < -1) {
+            throw IOError("error reading temporary run for " + string(url));
+        }
+        return false;
+    } else {
+        ++cursor.position;
+        return cursor.position < run.size();
+    }
+};
+void HtsRecordGrouper::merge_runs(const vector< string >& path_array, const bool& include_run, htsFile* hts_file) const {
+    /*  k way merge of spilled runs, optionally followed by the in memory run.
+        Cursors are ordered by key and then by run so that records with an identical
+        key are written in the order they were added. Decompressing the runs and
+        compressing the output are both offloaded to the shared thread pool. */
+    vector< RunCursor > cursor_array(path_array.size() + (include_run ? 1 : 0), RunCursor({ NULL, NULL, string(), 0 }));
+    auto release = [&cursor_array]() {
+        for(auto& cursor : cursor_array) {
+            if(cursor.hts_file != NULL) {
+                hts_close(cursor.hts_file);
+                cursor.hts_file = NULL;
+            }
+            if(cursor.record != NULL) {
+                bam_destroy1(cursor.record);
+                cursor.record = NULL;
+            }
+        }
+    };
+    try {
+        vector< size_t > heap;
+        heap.reserve(cursor_array.size());
+        for(size_t i(0); i < path_array.size(); ++i) {
+            RunCursor& cursor(cursor_array[i]);
+            if((cursor.hts_file = hts_open(path_array[i].c_str(), "r")) == NULL) {
+                throw IOError("failed to open " + path_array[i] + " for reading");
+            }
+            if(thread_pool != NULL) {
+                hts_set_thread_pool(cursor.hts_file, thread_pool);
+            }
+            bam_hdr_t* run_hdr(sam_hdr_read(cursor.hts_file));
+            if(run_hdr == NULL) {
+                throw IOError("failed to read header from " + path_array[i]);
+            }
+            bam_hdr_destroy(run_hdr);
+            if((cursor.record = bam_init1()) == NULL) {
+                throw OutOfMemoryError();
+            }
+            if(advance(cursor)) {
+                heap.push_back(i);
+            }
+        }
+        if(include_run && !run.empty()) {
+            heap.push_back(cursor_array.size() - 1);
+        }
+
+        /* std heap functions build a max heap so the comparison is reversed */
+        auto after = [this, &cursor_array](const size_t& left, const size_t& right) {
+            int comparison(cursor_key(cursor_array[left]).compare(cursor_key(cursor_array[right])));
+            return comparison > 0 || (comparison == 0 && left > right);
+        };
+        make_heap(heap.begin(), heap.end(), after);
+        while(!heap.empty()) {
+            pop_heap(heap.begin(), heap.end(), after);
+            RunCursor& cursor(cursor_array[heap.back()]);
+            if(sam_write1(hts_file, hdr, cursor_record(cursor)) < 0) {
+                throw IOError("error writing to " + string(url));
+            }
+            if(advance(cursor)) {
+                push_heap(heap.begin(), heap.end(), after);
+            } else {
+                heap.pop_back();
+            }
+        }
+        release();
+
+    } catch(...) {
+        release();
+        throw;
+    }
+};
+void HtsRecordGrouper::consolidate() {
+    /*  merge consecutive batches of spilled runs concurrently into larger runs.
+        Batches are consecutive so records with an identical key keep the order they were added */
+    const vector< string > source_array(run_path_array);
+    vector< string > batch_path_array;
+    vector< htsFile* > batch_file_array;
+    auto release = [&batch_file_array]() {
+        for(auto& run_file : batch_file_array) {
+            if(run_file != NULL) {
+                hts_close(run_file);
+                run_file = NULL;
+            }
+        }
+    };
+
+    /*  the header is written on the calling thread since writing it may update the shared header */
+    try {
+        for(size_t start(0); start < source_array.size(); start += GROUPING_MERGE_FAN_IN) {
+            /* register the path before writing so it is removed even if merging fails */
+            run_path_array.emplace_back(temporary_path());
+            batch_path_array.push_back(run_path_array.back());
+            const string& path(batch_path_array.back());
+
+            htsFile* run_file(hts_open(path.c_str(), "wb1"));
+            if(run_file == NULL) {
+                throw IOError("failed to open " + path + " for writing");
+            }
+            batch_file_array.push_back(run_file);
+            if(thread_pool != NULL) {
+                hts_set_thread_pool(run_file, thread_pool);
+            }
+            if(sam_hdr_write(run_file, hdr) < 0) {
+                throw IOError("error writing to " + path);
+            }
+        }
+    } catch(...) {
+        release();
+        throw;
+    }
+
+    vector< exception_ptr > error_array(batch_file_array.size());
+    vector< thread > thread_array;
+    thread_array.reserve(batch_file_array.size());
+    for(size_t i(0); i < batch_file_array.size(); ++i) {
+        thread_array.emplace_back([&, i]() {
+            try {
+                const size_t start(i * GROUPING_MERGE_FAN_IN);
+                const size_t end(min(start + GROUPING_MERGE_FAN_IN, source_array.size()));
+                const vector< string > batch(source_array.begin() + start, source_array.begin() + end);
+                merge_runs(batch, false, batch_file_array[i]);
+                htsFile* run_file(batch_file_array[i]);
+                batch_file_array[i] = NULL;
+                if(hts_close(run_file) < 0) {
+                    throw IOError("error writing to " + batch_path_array[i]);
+                }
+            } catch(...) {
+                error_array[i] = current_exception();
+            }
+        });
+    }
+    for(auto& worker : thread_array) {
+        worker.join();
+    }
+    release();
+    for(auto& error : error_array) {
+        if(error) {
+            rethrow_exception(error);
+        }
+    }
+
+    for(const auto& path : source_array) {
+        unlink(path.c_str());
+    }
+    run_path_array.swap(batch_path_array);
+};
+void HtsRecordGrouper::merge(htsFile* hts_file) {
+    sort_run();
+    if(run_path_array.empty()) {
+        /* everything fit in memory */
+        for(auto& grouped : run) {
+            if(sam_write1(hts_file, hdr, grouped.record) < 0) {
+                throw IOError("error writing to " + string(url));
+            }
+        }
+
+    } else {
+        while(run_path_array.size() > GROUPING_MERGE_FAN_IN) {
+            consolidate();
+        }
+        merge_runs(run_path_array, true, hts_file);
+        for(const auto& path : run_path_array) {
+            unlink(path.c_str());
+        }
+        run_path_array.clear();
+    }
+    for(auto& grouped : run) {
+        vacant.push_back(grouped.record);
+    }
+    run.clear();
+    occupied = 0;
+};
 
 template<> int CyclicBuffer< bam1_t >::increase_capacity(const int& capacity) {
     if(capacity > _capacity) {
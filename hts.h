@@ -76,16 +76,96 @@ class HtsHeader {
 };
 ostream& operator<<(ostream& o, const HtsHeader& header);
 
+/*  Parse CRAM encoding options in the key=value syntax of samtools --output-fmt-option,
+    i.e. seqs_per_slice=100000, slices_per_container=4, use_lzma=1, version=3.1 or no_ref=1.
+    The caller owns the returned list and releases it with hts_opt_free */
+hts_opt* decode_cram_option(const list< string >& value);
+
+/*  Maximum number of runs merged by a single heap when a grouped output is closed */
+const size_t GROUPING_MERGE_FAN_IN(16);
+
+/*  Groups output records by cellular barcode, and optionally by molecular barcode, in bounded memory.
+    Records are collected into an in memory run that is sorted and spilled to a temporary BAM file
+    whenever it grows beyond the memory budget, given in kilobytes. When the feed is closed
+    consecutive batches of spilled runs are merged concurrently, each on its own thread, until no more
+    than GROUPING_MERGE_FAN_IN runs remain, and those are merged with the last in memory run into the output.
+    Records with an identical key keep the order they were written in, so segments of the same read remain adjacent.
+*/
+class HtsRecordGrouper {
+    HtsRecordGrouper(HtsRecordGrouper const &) = delete;
+    void operator=(HtsRecordGrouper const &) = delete;
+
+    public:
+        HtsRecordGrouper(const URL& url, const RecordGrouping& grouping, const int32_t& memory, bam_hdr_t* hdr, htsThreadPool* thread_pool);
+        ~HtsRecordGrouper();
+        void add(const bam1_t* record);
+        void merge(htsFile* hts_file);
+
+    private:
+        struct GroupedRecord {
+            string key;
+            uint64_t ordinal;
+            bam1_t* record;
+        };
+        struct RunCursor {
+            htsFile* hts_file;
+            bam1_t* record;
+            string key;
+            size_t position;
+        };
+        const URL url;
+        const RecordGrouping grouping;
+        const size_t capacity;
+        bam_hdr_t* hdr;
+        htsThreadPool* thread_pool;
+        size_t occupied;
+        uint64_t ordinal;
+        vector< GroupedRecord > run;
+        vector< bam1_t* > vacant;
+        vector< string > run_path_array;
+        void encode_key(const bam1_t* record, string& key) const;
+        void sort_run();
+        void spill();
+        string temporary_path() const;
+        bool advance(RunCursor& cursor) const;
+        void merge_runs(const vector< string >& path_array, const bool& include_run, htsFile* hts_file) const;
+        void consolidate();
+        inline const string& cursor_key(const RunCursor& cursor) const {
+            return cursor.hts_file != NULL ? cursor.key : run[cursor.position].key;
+        };
+        inline const bam1_t* cursor_record(const RunCursor& cursor) const {
+            return cursor.hts_file != NULL ? cursor.record : run[cursor.position].record;
+        };
+};
+
 class HtsFeed : public BufferedFeed< bam1_t > {
     friend class Channel;
 
     public:
         HtsFeed(const FeedProxy& proxy) :
             BufferedFeed< bam1_t >(proxy),
-            hts_file(NULL) {
+            hts_file(NULL),
+            grouping(proxy.grouping),
+            grouping_capacity(proxy.grouping_capacity),
+            cram_option(proxy.cram_option),
+            grouper(NULL) {
 
             header.hd.set_alignment_sort_order(HtsSortOrder::UNKNOWN);
             header.hd.set_alignment_grouping(HtsGrouping::QUERY);
+            if(direction == IoDirection::OUT) {
+                switch(grouping) {
+                    case RecordGrouping::CELLULAR:
+                        header.hd.set_alignment_sort_order(HtsSortOrder::UNSORTED);
+                        header.hd.set_alignment_subsort("unsorted:CB");
+                        break;
+                    case RecordGrouping::MOLECULAR:
+                        header.hd.set_alignment_sort_order(HtsSortOrder::UNSORTED);
+                        header.hd.set_alignment_subsort("unsorted:CB:MI");
+                        break;
+                    default:
+                        break;
+                }
+            }
             for(const auto& record : proxy.program_by_id) {
                 header.add_program(record.second);
             }
@@ -101,6 +181,15 @@ class HtsFeed : public BufferedFeed< bam1_t > {
                         if(hts_file != NULL) {
                             hts_set_thread_pool(hts_file, thread_pool);
                             header.decode(hts_file);
+                            if(resume_position.offset > -2) {
+                                if(!hts_file->is_bgzf || resume_position.offset < 0 || bgzf_seek(hts_file->fp.bgzf, resume_position.offset, SEEK_SET) < 0) {
+                                    throw IOError("failed to seek to checkpoint position in " + string(url));
+                                }
+                            } else if(sharded && shard_begin >= 0) {
+                                if(bgzf_seek(hts_file->fp.bgzf, shard_begin, SEEK_SET) < 0) {
+                                    throw IOError("failed to seek to shard in " + string(url));
+                                }
+                            }
                         } else {
                             throw IOError("failed to open " + string(url) + " for reading");
                         }
@@ -116,17 +205,26 @@ class HtsFeed : public BufferedFeed< bam1_t > {
                                 }
                                 break;
                             case FormatType::BAM:
-                                hts_file = hts_hopen(hfile, url.c_str(), "wb");
+                                hts_file = hts_hopen(hfile, url.c_str(), output_mode("wb").c_str());
                                 if(hts_file) {
                                     hts_file->format.version.major = 1;
                                     hts_file->format.version.minor = 0;
                                 }
                                 break;
                             case FormatType::CRAM:
-                                hts_file = hts_hopen(hfile, url.c_str(), "wc");
+                                hts_file = hts_hopen(hfile, url.c_str(), output_mode("wc").c_str());
                                 if(hts_file) {
-                                    hts_file->format.version.major = 3;
-                                    hts_file->format.version.minor = 0;
+                                    /* encoding options must be applied before the header is written */
+                                    if(!cram_option.empty()) {
+                                        hts_opt* option(decode_cram_option(cram_option));
+                                        int status(hts_opt_apply(hts_file, option));
+                                        hts_opt_free(option);
+                                        if(status < 0) {
+                                            throw IOError("failed to apply CRAM options to " + string(url));
+                                        }
+                                    }
+                                    hts_file->format.version.major = cram_major_vers(hts_file->fp.cram);
+                                    hts_file->format.version.minor = cram_minor_vers(hts_file->fp.cram);
                                 }
                                 break;
                             default:
@@ -136,7 +234,14 @@ class HtsFeed : public BufferedFeed< bam1_t > {
                             hts_set_thread_pool(hts_file, thread_pool);
                             header.hd.set_version(&(hts_file->format));
                             header.assemble();
-                            header.encode(hts_file);
+
+                            /* a resumed file already has the header */
+                            if(resume_offset == 0) {
+                                header.encode(hts_file);
+                            }
+                            if(grouping == RecordGrouping::CELLULAR || grouping == RecordGrouping::MOLECULAR) {
+                                grouper = new HtsRecordGrouper(url, grouping, grouping_capacity, header.hdr, thread_pool);
+                            }
                         } else {
                             throw IOError("failed to open " + string(url) + " for writing");
                         }
@@ -147,8 +252,16 @@ class HtsFeed : public BufferedFeed< bam1_t > {
                 }
             }
         };
+        ~HtsFeed() override {
+            delete grouper;
+        };
         void close() override {
             if(opened()) {
+                if(grouper != NULL) {
+                    grouper->merge(hts_file);
+                    delete grouper;
+                    grouper = NULL;
+                }
                 hts_close(hts_file);
                 hts_file = NULL;
             }
@@ -163,6 +276,10 @@ class HtsFeed : public BufferedFeed< bam1_t > {
     protected:
         HtsHeader header;
         htsFile* hts_file;
+        const RecordGrouping grouping;
+        const int32_t grouping_capacity;
+        const list< string > cram_option;
+        HtsRecordGrouper* grouper;
         inline void encode(bam1_t* record, const Segment& segment) const override {
             /*
                 The total size of a bam1_t record is an int32_t
@@ -173,6 +290,7 @@ class HtsFeed : public BufferedFeed< bam1_t > {
                 (bam1_t.core.n_cigar << 2) +        // 32 bit per cigar operation
                 bam1_t.l_aux                        // auxiliary tags added later
             */
+
             int32_t i;
             uint32_t l_data;
             int32_t qname_nuls(4 - segment.name.l % 4);
@@ -269,8 +387,67 @@ class HtsFeed : public BufferedFeed< bam1_t > {
             segment.flag = record->core.flag;
             segment.auxiliary.decode(record);
         };
+        /*  move the record to the segment without decoding it, only the identifier and the flags are copied.
+            With tag augmentation decoders read the packed sequence from the record so the length
+            and the auxiliary tags are decoded as well */
+        inline void detach(bam1_t* record, Segment& segment) override {
+            if(segment.record == NULL && (segment.record = bam_init1()) == NULL) {
+                throw OutOfMemoryError();
+            }
+            swap(*record, *segment.record);
+            segment.forwarded = true;
+            ks_put_string(bam_get_qname(segment.record), segment.record->core.l_qname - segment.record->core.l_extranul - 1, segment.name);
+            segment.flag = segment.record->core.flag;
+            if(tag_augmentation) {
+                segment.length = segment.record->core.l_qseq;
+                segment.auxiliary.decode(segment.record);
+            }
+        };
+        /*  write the record forwarded with the segment in the shape encode gives a record.
+            It is unaligned and has the flags of the output segment. Forwarded records only carry the
+            auxiliary tags assigned to the output segment, so input tags like a read group the output
+            header does not declare are not carried over. With tag augmentation the tags of an unmapped
+            input record are kept and the assigned tags replace or are appended to them, the tags of a
+            mapped record describe the alignment that is removed and are dropped */
+        inline void attach(bam1_t* record, const Segment& segment) const override {
+            swap(*record, *segment.record);
+            const bool augment(tag_augmentation && (record->core.flag & BAM_FUNMAP));
+            if(!augment) {
+                record->l_data = static_cast< int32_t >(bam_get_aux(record) - record->data);
+            }
+            if(record->core.n_cigar > 0) {
+                uint8_t* cigar(reinterpret_cast< uint8_t* >(bam_get_cigar(record)));
+                const int32_t cigar_length(static_cast< int32_t >(record->core.n_cigar << 2));
+                memmove(cigar, cigar + cigar_length, record->l_data - record->core.l_qname - cigar_length);
+                record->l_data -= cigar_length;
+                record->core.n_cigar = 0;
+            }
+            record->core.tid = -1;
+            record->core.pos = -1;
+            record->core.mtid = -1;
+            record->core.mpos = -1;
+            record->core.bin = 0;
+            record->core.qual = 0;
+            record->core.isize = 0;
+            record->core.flag = segment.flag;
+            if(augment) {
+                segment.auxiliary.augment(record);
+            } else {
+                segment.auxiliary.encode(record);
+            }
+        };
         inline void replenish_buffer() override {
             while(opened() && buffer->is_not_full()) {
+                if(sharded && (shard_begin < 0 || (shard_end >= 0 && bgzf_tell(hts_file->fp.bgzf) >= shard_end))) {
+                    close();
+                    break;
+                }
+                if(position_tracking) {
+                    FeedPosition& position(buffer->vacant_position());
+                    position.offset = hts_file->is_bgzf ? bgzf_tell(hts_file->fp.bgzf) : -2;
+                    position.skip = 0;
+                    position.consumed = 0;
+                }
                 if(sam_read1(hts_file, header.hdr, buffer->vacant()) < 0) {
                     close();
                     break;
@@ -281,11 +458,26 @@ class HtsFeed : public BufferedFeed< bam1_t > {
         };
         inline void flush_buffer() override {
             while(buffer->is_not_empty()) {
-                if(sam_write1(hts_file, header.hdr, buffer->next()) < 0) {
+                if(grouper != NULL) {
+                    grouper->add(buffer->next());
+                } else if(sam_write1(hts_file, header.hdr, buffer->next()) < 0) {
                     throw IOError("error writing to " + string(url));
                 }
                 buffer->decrement();
             }
         };
+        inline int64_t synchronize() override {
+            /*  CRAM containers and grouped output are only complete when the file is closed */
+            if(grouper != NULL || url.type() == FormatType::CRAM || url.is_standard_stream()) {
+                return -1;
+            }
+            if((hts_file->is_bgzf && bgzf_flush(hts_file->fp.bgzf) < 0) || hflush(hfile) < 0) {
+                throw IOError("error flushing " + string(url));
+            }
+            sync_url(url);
+
+            /* an hFILE opened for append counts from where it was opened */
+            return resume_offset + htell(hfile);
+        };
 };
 #endif /* PHENIQS_HTS_H */
@@ -32,8 +32,17 @@
     #define PHENIQS_EXTENDED_SAM_TAG
 */
 
+/*  Instrument the hot path with wait time measurements.
+    Time pivot threads spend in each processing stage and time feeds spend blocked
+    on locks and condition variables are reported in the "profile" section of the report.
+    Compiled out entirely by default, build with `make with-profile=1` to enable
+    #define PHENIQS_PROFILE
+*/
+
 /* STL dependencies */
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cmath>
 #include <condition_variable>
 #include <cstddef>
@@ -41,6 +50,7 @@
 #include <cstdlib>
 #include <errno.h>
 #include <exception>
+#include <fcntl.h>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
@@ -49,6 +59,7 @@
 #include <map>
 #include <math.h>
 #include <mutex>
+#include <random>
 #include <set>
 #include <stdio.h>
 #include <stdlib.h>
@@ -58,11 +69,14 @@
 #include <unordered_map>
 #include <vector>
 
+using std::atomic;
 using std::cerr;
 using std::condition_variable;
 using std::cout;
+using std::current_exception;
 using std::endl;
 using std::exception;
+using std::exception_ptr;
 using std::fixed;
 using std::hash;
 using std::ifstream;
@@ -76,31 +90,45 @@ using std::istreambuf_iterator;
 using std::list;
 using std::lock_guard;
 using std::log10;
+using std::make_exception_ptr;
 using std::make_pair;
 using std::map;
+using std::memory_order_relaxed;
 using std::max;
 using std::min;
 using std::move;
+using std::mt19937_64;
 using std::mutex;
 using std::numeric_limits;
 using std::ostream;
 using std::out_of_range;
 using std::pair;
 using std::recursive_mutex;
+using std::rethrow_exception;
 using std::set;
 using std::setprecision;
 using std::setw;
 using std::size_t;
 using std::string;
+using std::swap;
 using std::thread;
 using std::to_string;
 using std::uint16_t;
 using std::uint32_t;
 using std::uint64_t;
 using std::uint8_t;
+using std::uniform_int_distribution;
+using std::uniform_real_distribution;
 using std::unique_lock;
 using std::unordered_map;
 using std::vector;
+using std::chrono::duration;
+using std::chrono::duration_cast;
+using std::chrono::milliseconds;
+using std::chrono::nanoseconds;
+using std::chrono::seconds;
+using std::chrono::steady_clock;
+using std::this_thread::sleep_for;
 
 /*  zlib dependencies
     Used for probing gzip compressed files */
@@ -115,6 +143,7 @@ namespace rapidjson { typedef ::std::size_t SizeType; }
 #include <rapidjson/pointer.h>
 #include <rapidjson/prettywriter.h>
 #include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
 
 using rapidjson::Document;
 using rapidjson::Pointer;
@@ -124,6 +153,7 @@ using rapidjson::StringBuffer;
 using rapidjson::StringRef;
 using rapidjson::Type;
 using rapidjson::Value;
+using rapidjson::Writer;
 using rapidjson::kArrayType;
 using rapidjson::kNullType;
 using rapidjson::kObjectType;
@@ -136,6 +166,7 @@ using rapidjson::kStringType;
 #endif
 
 #include <htslib/bgzf.h>
+#include <htslib/cram.h>
 #include <htslib/hfile.h>
 #include <htslib/hts.h>
 #include <htslib/kseq.h>
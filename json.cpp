@@ -27,6 +27,12 @@ void print_json(const Value& node, ostream& o) {
     node.Accept(writer);
     o << buffer.GetString() << endl;
 };
+void print_json_line(const Value& node, ostream& o) {
+    StringBuffer buffer;
+    Writer< StringBuffer > writer(buffer);
+    node.Accept(writer);
+    o << buffer.GetString() << endl;
+};
 Document* load_json(const string& path) {
     Document* document(NULL);
     if(access(path.c_str(), R_OK) != -1) {
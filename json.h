@@ -27,6 +27,7 @@
 #include "kstring.h"
 
 void print_json(const Value& node, ostream& o=cout);
+void print_json_line(const Value& node, ostream& o=cout);
 Document* load_json(const string& path);
 
 /*  Recursively merge two JSON documents.
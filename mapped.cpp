@@ -0,0 +1,139 @@
+/*
+    Pheniqs : PHilology ENcoder wIth Quality Statistics
+    Copyright (C) 2018  Lior Galanti
+    NYU Center for Genetics and System Biology
+
+    Author: Lior Galanti <lior.galanti@nyu.edu>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "mapped.h"
+#include "backend.h"
+
+MappedFile::MappedFile(void* address, const size_t& size) :
+    begin(static_cast< const uint8_t* >(address)),
+    end(static_cast< const uint8_t* >(address) + size),
+    cursor(static_cast< const uint8_t* >(address)),
+    released(0) {
+
+    #if defined(MADV_SEQUENTIAL)
+    madvise(address, size, MADV_SEQUENTIAL);
+    #endif
+};
+MappedFile::~MappedFile() {
+    munmap(const_cast< uint8_t* >(begin), size());
+};
+void MappedFile::release(const uint8_t* position) {
+    /*  the mapping starts on a page boundary and the window is a multiple of the page size */
+    const size_t boundary((static_cast< size_t >(position - begin) / MAPPED_RELEASE_WINDOW) * MAPPED_RELEASE_WINDOW);
+    if(boundary > released) {
+        #if defined(MADV_DONTNEED)
+        madvise(const_cast< uint8_t* >(begin) + released, boundary - released, MADV_DONTNEED);
+        #endif
+        released = boundary;
+    }
+};
+ssize_t MappedFile::read(void* buffer, const size_t& size) {
+    const size_t consumed(min(size, static_cast< size_t >(end - cursor)));
+    memcpy(buffer, cursor, consumed);
+    cursor += consumed;
+    release(cursor);
+    return consumed;
+};
+off_t MappedFile::seek(const off_t& offset, const int& whence) {
+    off_t position(offset);
+    switch(whence) {
+        case SEEK_SET:
+            break;
+        case SEEK_CUR:
+            position += cursor - begin;
+            break;
+        case SEEK_END:
+            position += size();
+            break;
+        default:
+            errno = EINVAL;
+            return -1;
+    }
+    if(position < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    cursor = begin + min(static_cast< size_t >(position), size());
+    return position;
+};
+
+typedef struct {
+    hFILE base;
+    MappedFile* mapped;
+} hFILE_mapped;
+static ssize_t mapped_read(hFILE* fp, void* buffer, size_t nbytes) {
+    return reinterpret_cast< hFILE_mapped* >(fp)->mapped->read(buffer, nbytes);
+};
+static ssize_t mapped_write(hFILE*, const void*, size_t) {
+    errno = EBADF;
+    return -1;
+};
+static off_t mapped_seek(hFILE* fp, off_t offset, int whence) {
+    return reinterpret_cast< hFILE_mapped* >(fp)->mapped->seek(offset, whence);
+};
+static int mapped_close(hFILE* fp) {
+    delete reinterpret_cast< hFILE_mapped* >(fp)->mapped;
+    return 0;
+};
+static const struct hFILE_backend mapped_backend = {
+    mapped_read,
+    mapped_write,
+    mapped_seek,
+    NULL,
+    mapped_close
+};
+hFILE* hopen_mapped(const string& path) {
+    hFILE* hfile(NULL);
+    int descriptor(::open(path.c_str(), O_RDONLY));
+    if(descriptor >= 0) {
+        struct stat status;
+        if(fstat(descriptor, &status) == 0 && S_ISREG(status.st_mode) && status.st_size > 0) {
+            /* the mapping holds its own reference to the file so the descriptor is not needed */
+            const size_t size(static_cast< size_t >(status.st_size));
+            void* address(mmap(NULL, size, PROT_READ, MAP_PRIVATE, descriptor, 0));
+            if(address != MAP_FAILED) {
+                hFILE_mapped* fp(reinterpret_cast< hFILE_mapped* >(hfile_init(sizeof(hFILE_mapped), "r", 0)));
+                if(fp != NULL) {
+                    try {
+                        fp->mapped = new MappedFile(address, size);
+                    } catch(...) {
+                        hfile_destroy(&fp->base);
+                        munmap(address, size);
+                        ::close(descriptor);
+                        throw;
+                    }
+                    fp->base.backend = &mapped_backend;
+                    hfile = &fp->base;
+                } else {
+                    munmap(address, size);
+                }
+            }
+        }
+        ::close(descriptor);
+    }
+    return hfile;
+};
+MappedFile* mapped_file(hFILE* hfile) {
+    if(hfile != NULL && hfile->backend == &mapped_backend) {
+        return reinterpret_cast< hFILE_mapped* >(hfile)->mapped;
+    }
+    return NULL;
+};
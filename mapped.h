@@ -0,0 +1,70 @@
+/*
+    Pheniqs : PHilology ENcoder wIth Quality Statistics
+    Copyright (C) 2018  Lior Galanti
+    NYU Center for Genetics and System Biology
+
+    Author: Lior Galanti <lior.galanti@nyu.edu>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PHENIQS_MAPPED_H
+#define PHENIQS_MAPPED_H
+
+#include "include.h"
+#include "error.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*  Pages of a mapped file behind the consumer are released in windows of this size */
+const size_t MAPPED_RELEASE_WINDOW(64 * 1024 * 1024);
+
+/*  Read only memory mapping of an entire input file
+
+    Input is parsed directly out of the mapping, so reading costs no system calls and
+    no copy into an intermediate buffer. The kernel is advised that the mapping is read sequentially
+    and the consumer releases the pages it has moved past, so the resident size stays bounded
+    by the release window no matter how large the file is. Released pages remain in the page cache.
+*/
+class MappedFile {
+    MappedFile(MappedFile const &) = delete;
+    void operator=(MappedFile const &) = delete;
+
+    public:
+        const uint8_t* const begin;
+        const uint8_t* const end;
+        MappedFile(void* address, const size_t& size);
+        ~MappedFile();
+        inline size_t size() const {
+            return static_cast< size_t >(end - begin);
+        };
+        /*  release every complete window before position */
+        void release(const uint8_t* position);
+        ssize_t read(void* buffer, const size_t& size);
+        off_t seek(const off_t& offset, const int& whence);
+
+    private:
+        const uint8_t* cursor;
+        size_t released;
+};
+
+/*  hFILE reading a regular file through a MappedFile.
+    Returns NULL if the path is not a non empty regular file or can not be mapped so the caller can fall back to hopen */
+hFILE* hopen_mapped(const string& path);
+
+/*  The mapping behind an hFILE opened with hopen_mapped, NULL for any other hFILE */
+MappedFile* mapped_file(hFILE* hfile);
+
+#endif /* PHENIQS_MAPPED_H */
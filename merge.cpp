@@ -0,0 +1,167 @@
+/*
+    Pheniqs : PHilology ENcoder wIth Quality Statistics
+    Copyright (C) 2018  Lior Galanti
+    NYU Center for Genetics and System Biology
+
+    Author: Lior Galanti <lior.galanti@nyu.edu>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "merge.h"
+
+MergeJob::MergeJob(Document& operation) try :
+    Job(operation) {
+
+    } catch(ConfigurationError& error) {
+        throw ConfigurationError("MergeJob :: " + error.message);
+
+    } catch(exception& error) {
+        throw InternalError("MergeJob :: " + string(error.what()));
+};
+void MergeJob::manipulate() {
+    list< URL > url_array;
+    if(decode_value_by_key< list< URL > >("report url", url_array, ontology)) {
+        for(auto& url : url_array) {
+            url.normalize(IoDirection::IN);
+        }
+        ontology.RemoveMember("report url");
+        encode_key_value("report url", url_array, ontology, ontology);
+    }
+};
+void MergeJob::validate() {
+    Job::validate();
+
+    list< URL > url_array;
+    if(!decode_value_by_key< list< URL > >("report url", url_array, ontology) || url_array.empty()) {
+        throw ConfigurationError("at least one report to merge must be specified");
+    }
+    set< URL > unique;
+    for(const auto& url : url_array) {
+        if(!unique.emplace(url).second) {
+            throw ConfigurationError("report " + string(url) + " is specified more than once");
+        }
+    }
+};
+void MergeJob::describe(ostream& o) const {
+    list< URL > url_array(decode_value_by_key< list< URL > >("report url", ontology));
+    o << "Environment " << endl << endl;
+    o << "    Reports merged                              " << url_array.size() << endl;
+    o << endl;
+    int32_t index(0);
+    for(const auto& url : url_array) {
+        o << "    Report No." + to_string(index) + "  : " << url << endl;
+        ++index;
+    }
+    o << endl;
+};
+void MergeJob::load() {
+    report_url_array = decode_value_by_key< list< URL > >("report url", ontology);
+    for(const auto& url : report_url_array) {
+        load_report(url);
+    }
+    validate_shard_coverage();
+};
+void MergeJob::execute() {
+    load();
+    finalize();
+};
+void MergeJob::load_report(const URL& url) {
+    if(url.is_readable()) {
+        ifstream file(url.path());
+        const string content((istreambuf_iterator< char >(file)), istreambuf_iterator< char >());
+        file.close();
+
+        report_array.emplace_back();
+        Document& document(report_array.back());
+        if(!document.Parse(content.c_str()).HasParseError()) {
+            if(!document.IsObject() || !document.HasMember("job")) {
+                throw ConfigurationError(string(url) + " is not a pheniqs report");
+            }
+            if(!document.HasMember("mergeable report")) {
+                throw ConfigurationError(string(url) + " has no mergeable report section, run with --mergeable");
+            }
+        } else {
+            string message(GetParseError_En(document.GetParseError()));
+            message += " at position ";
+            message += to_string(document.GetErrorOffset());
+            throw ConfigurationError(string(url) + " " + message);
+        }
+    } else { throw ConfigurationError("unable to read report from " + string(url)); }
+};
+void MergeJob::validate_shard_coverage() const {
+    /*  Reports written by sharded runs must together cover every shard exactly once,
+        reports from unsharded runs are summed as they are */
+    int32_t expected(0);
+    set< int32_t > covered;
+    for(const auto& document : report_array) {
+        Value::ConstMemberIterator reference = document.FindMember("shard");
+        if(reference != document.MemberEnd()) {
+            int32_t index(0);
+            int32_t count(0);
+            decode_value_by_key< int32_t >("index", index, reference->value);
+            decode_value_by_key< int32_t >("count", count, reference->value);
+            if(expected == 0) {
+                expected = count;
+            } else if(count != expected) {
+                throw ConfigurationError("reports from runs split into " + to_string(expected) + " and " + to_string(count) + " shards can not be merged");
+            }
+            if(!covered.emplace(index).second) {
+                throw ConfigurationError("shard " + to_string(index) + "/" + to_string(count) + " is merged more than once");
+            }
+        } else if(expected > 0) {
+            throw ConfigurationError("sharded and unsharded reports can not be merged");
+        }
+    }
+    if(expected > 0 && static_cast< int32_t >(covered.size()) != expected) {
+        throw ConfigurationError("only " + to_string(covered.size()) + " of " + to_string(expected) + " shards provided");
+    }
+};
+void MergeJob::finalize() {
+    /* accumulators are constructed from the compiled job of the first report */
+    const Value& reference(find_value_by_key("job", report_array.front()));
+    Value value;
+    value.CopyFrom(reference, report.GetAllocator());
+    value.RemoveMember("shard");
+    report.AddMember(Value("job", report.GetAllocator()).Move(), value.Move(), report.GetAllocator());
+
+    InputAccumulator input_accumulator(reference);
+    OutputAccumulator output_accumulator(find_value_by_key("multiplex", reference));
+    for(const auto& document : report_array) {
+        const Value& mergeable(find_value_by_key("mergeable report", document));
+        input_accumulator.merge_raw(find_value_by_key("input", mergeable));
+        output_accumulator.merge_raw(find_value_by_key("output", mergeable));
+    }
+
+    Value mergeable(kObjectType);
+    Value element;
+    input_accumulator.encode_raw(element, report);
+    mergeable.AddMember(Value("input", report.GetAllocator()).Move(), element.Move(), report.GetAllocator());
+    output_accumulator.encode_raw(element, report);
+    mergeable.AddMember(Value("output", report.GetAllocator()).Move(), element.Move(), report.GetAllocator());
+    report.AddMember(Value("mergeable report", report.GetAllocator()).Move(), mergeable.Move(), report.GetAllocator());
+
+    input_accumulator.finalize();
+    output_accumulator.finalize();
+    encode_key_value("demultiplex output report", output_accumulator, report, report);
+    encode_key_value("demultiplex input report", input_accumulator, report, report);
+
+    Value merge_report(kObjectType);
+    encode_key_value("count", static_cast< int32_t >(report_array.size()), merge_report, report);
+    encode_key_value("report", report_url_array, merge_report, report);
+    report.AddMember(Value("merge", report.GetAllocator()).Move(), merge_report.Move(), report.GetAllocator());
+
+    clean_json_value(report, report);
+    sort_json_value(report, report);
+};
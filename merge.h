@@ -0,0 +1,60 @@
+/*
+    Pheniqs : PHilology ENcoder wIth Quality Statistics
+    Copyright (C) 2018  Lior Galanti
+    NYU Center for Genetics and System Biology
+
+    Author: Lior Galanti <lior.galanti@nyu.edu>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PHENIQS_MERGE_H
+#define PHENIQS_MERGE_H
+
+#include "include.h"
+#include "pipeline.h"
+#include "accumulate.h"
+
+/*  Combines the reports of several runs, usually the shards of a single input,
+    into the report a single run over the concatenated input would have produced.
+    Every report must carry a "mergeable report" section with the raw accumulator state,
+    written by a demux run with --mergeable or by any sharded run.
+*/
+class MergeJob : public Job {
+    MergeJob(MergeJob const &) = delete;
+    void operator=(MergeJob const &) = delete;
+
+    public:
+        MergeJob(Document& operation);
+        void load() override;
+        void execute() override;
+        void describe(ostream& o) const override;
+        /*  the merged report is the output of a merge */
+        ostream& report_stream() const override {
+            return cout;
+        };
+
+    protected:
+        void manipulate() override;
+        void validate() override;
+
+    private:
+        list< URL > report_url_array;
+        list< Document > report_array;
+        void load_report(const URL& url);
+        void validate_shard_coverage() const;
+        void finalize();
+};
+
+#endif /* PHENIQS_MERGE_H */
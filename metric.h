@@ -24,70 +24,81 @@
 #include "include.h"
 #include "barcode.h"
 
+/*  Codecs up to this many words display the full pairwise distance matrix,
+    larger codecs display the nearest neighbor distance distribution */
+#define METRIC_MATRIX_DISPLAY_LIMIT 128
+
+/*  Minimum number of words each thread handles when searching the neighborhood in parallel */
+#define METRIC_WORDS_PER_THREAD 1024
+
+/*  Pairwise Hamming distance properties of a set of equal length words.
+    The minimum distance is found with a pigeonhole search: two words within distance k
+    of each other must share at least one of k + 1 disjoint blocks verbatim, so only words
+    sharing a block bucket are compared. The tolerance doubles until a pair is found,
+    which keeps the search close to linear for the sparse codecs used in practice.
+    The dense matrix is only ever materialized for display of small codecs.
+*/
 class WordMetric {
     friend class CodecMetric;
     public:
         const size_t barcode_length;
         WordMetric(const size_t barcode_length) :
             barcode_length(barcode_length),
-            _min_word_length(0),
-            _max_word_length(0),
             _min_distance(0),
-            _max_distance(0),
             _shannon_bound(0),
-            _padding(0),
             _spacing(1) {
         };
         inline bool empty() const {
             return word_array.empty();
         };
         inline int32_t nucleotide_cardinality() const {
-            return _max_word_length;
+            return static_cast< int32_t >(barcode_length);
         };
         inline int32_t cardinality() const {
             return static_cast< int32_t >(word_array.size());
         };
-        inline int32_t value(int32_t i, int32_t j) const {
-            return _matrix[i][j];
-        };
         inline const string& word(size_t i) const {
             return word_array[i];
         };
-        inline int32_t cumulative(size_t i) const {
-            return _cumulative[i];
-        };
         inline int32_t minimum_distance() const {
             return _min_distance;
         };
         inline int32_t shannon_bound() const {
             return _shannon_bound;
         };
+        vector< int32_t > nearest_neighbor_distance() const {
+            vector< int32_t > nearest(cardinality(), numeric_limits< int32_t >::max());
+            if(cardinality() > 1) {
+                /* a word is resolved once its nearest known neighbor is within the tolerance searched */
+                int32_t settled(0);
+                int32_t tolerance(1);
+                while(true) {
+                    search_neighborhood(settled, tolerance, nearest);
+                    if(!resolved(tolerance, nearest) && tolerance < nucleotide_cardinality()) {
+                        settled = tolerance;
+                        tolerance = min(tolerance * 2, nucleotide_cardinality());
+                    } else { break; }
+                }
+            }
+            return nearest;
+        };
         void describe(ostream& o) const {
             o << std::left;
             if(!empty()) {
-                for(int32_t i(0); i < cardinality(); ++i) {
-                    o << "    ";
-                    for(int32_t j(0); j < cardinality(); ++j) {
-                        o << setw(_padding)<< value(i, j);
-                    }
-                    o << word(i) << ' ' << setw(_padding) << cumulative(i) << endl;
+                if(cardinality() <= METRIC_MATRIX_DISPLAY_LIMIT) {
+                    describe_matrix(o);
+                } else {
+                    describe_distribution(o);
                 }
-                o << endl;
             }
         };
 
     private:
-        int32_t _min_word_length;
-        int32_t _max_word_length;
         int32_t _min_distance;
-        int32_t _max_distance;
         int32_t _shannon_bound;
-        int32_t _padding;
         int32_t _spacing;
         set< string > _index;
         vector < string > word_array;
-        vector < int32_t > _cumulative;
-        vector< vector< int32_t > > _matrix;
         void add(const string& word) {
             if(word.size() == barcode_length) {
                 _index.insert(word);
@@ -95,70 +106,148 @@ class WordMetric {
         };
         void load() {
             word_array.clear();
-            _cumulative.clear();
             if(!_index.empty()) {
-
-                _max_word_length = 0;
-                _min_word_length = numeric_limits< int32_t >::max();
+                word_array.reserve(_index.size());
                 for(const auto& word : _index) {
-                    _min_word_length = min(_min_word_length, static_cast< int32_t >(word.size()));
-                    _max_word_length = max(_max_word_length, static_cast< int32_t >(word.size()));
                     word_array.push_back(word);
                 }
+                _index.clear();
+                _min_distance = search_minimum_distance();
+                _shannon_bound = ((_min_distance - 1) / 2);
+            }
+        };
+        int32_t search_minimum_distance() const {
+            int32_t distance(numeric_limits< int32_t >::max());
+            if(cardinality() > 1) {
+                vector< int32_t > nearest(cardinality(), numeric_limits< int32_t >::max());
+                int32_t settled(0);
+                int32_t tolerance(1);
+                while(true) {
+                    search_neighborhood(settled, tolerance, nearest);
+                    distance = *min_element(nearest.begin(), nearest.end());
 
-                _max_distance = 0;
-                _min_distance = numeric_limits< int32_t >::max();
-                _matrix.resize(cardinality());
-                _cumulative.resize(cardinality());
-                for(int32_t i(0); i < cardinality(); ++i) {
-                    const string& row = word(i);
-                    _matrix[i].resize(cardinality());
-                    for(int32_t j(0); j < cardinality(); ++j) {
-                        const string& column = word(j);
-                        if(i == j) {
-                            _matrix[i][j] = 0;
+                    /* every pair within tolerance was compared so a distance within tolerance is the minimum */
+                    if(distance <= tolerance || tolerance >= nucleotide_cardinality()) {
+                        break;
+                    }
+                    settled = tolerance;
+                    tolerance = min(tolerance * 2, nucleotide_cardinality());
+                }
+            }
+            return distance;
+        };
+        inline bool resolved(const int32_t& tolerance, const vector< int32_t >& nearest) const {
+            for(const auto& distance : nearest) {
+                if(distance > tolerance) {
+                    return false;
+                }
+            }
+            return true;
+        };
+
+        /*  Lower the nearest neighbor distance of every word not settled by a previous search
+            to the distance of any word within tolerance */
+        void search_neighborhood(const int32_t& settled, const int32_t& tolerance, vector< int32_t >& nearest) const {
+            /* once tolerance reaches the word length the pigeonhole no longer holds and every pair is compared */
+            const bool exhaustive(tolerance >= nucleotide_cardinality());
+            const int32_t block_cardinality(exhaustive ? 1 : tolerance + 1);
+            vector< size_t > block_offset(block_cardinality + 1);
+            for(int32_t i(0); i <= block_cardinality; ++i) {
+                block_offset[i] = exhaustive ? 0 : (i * barcode_length) / block_cardinality;
+            }
 
-                        } else if(i < j) {
-                            int32_t distance(hamming_distance(row, column));
-                            _min_distance = min(_min_distance, distance);
-                            _max_distance = max(_max_distance, distance);
-                            _matrix[i][j] = distance;
-                            _cumulative[i] += distance;
-                            _cumulative[j] += distance;
+            vector< unordered_map< string, vector< int32_t > > > bucket_by_block(block_cardinality);
+            for(int32_t i(0); i < cardinality(); ++i) {
+                for(int32_t j(0); j < block_cardinality; ++j) {
+                    bucket_by_block[j][word(i).substr(block_offset[j], block_offset[j + 1] - block_offset[j])].push_back(i);
+                }
+            }
 
-                        } else {
-                            _matrix[i][j] = shannon_bound(row, column);
+            auto search = [&](const int32_t begin, const int32_t end) {
+                for(int32_t i(begin); i < end; ++i) {
+                    if(nearest[i] > settled) {
+                        for(int32_t j(0); j < block_cardinality; ++j) {
+                            const auto& bucket = bucket_by_block[j].find(word(i).substr(block_offset[j], block_offset[j + 1] - block_offset[j]))->second;
+                            for(const auto& k : bucket) {
+                                if(k != i) {
+                                    nearest[i] = min(nearest[i], hamming_distance(word(i), word(k), nearest[i]));
+                                }
+                            }
                         }
                     }
                 }
-                _shannon_bound = ((_min_distance - 1) / 2);
+            };
+
+            const int32_t threads(max(1, min(static_cast< int32_t >(thread::hardware_concurrency()), cardinality() / METRIC_WORDS_PER_THREAD)));
+            if(threads > 1) {
+                vector< thread > pool;
+                pool.reserve(threads);
+                const int32_t stride((cardinality() + threads - 1) / threads);
+                for(int32_t begin(0); begin < cardinality(); begin += stride) {
+                    pool.emplace_back(search, begin, min(begin + stride, cardinality()));
+                }
+                for(auto& worker : pool) {
+                    worker.join();
+                }
+            } else { search(0, cardinality()); }
+        };
+        void describe_matrix(ostream& o) const {
+            vector< vector< int32_t > > matrix(cardinality(), vector< int32_t >(cardinality(), 0));
+            vector< int32_t > cumulative(cardinality(), 0);
+            int32_t max_distance(0);
+            for(int32_t i(0); i < cardinality(); ++i) {
+                for(int32_t j(i + 1); j < cardinality(); ++j) {
+                    int32_t distance(hamming_distance(word(i), word(j)));
+                    max_distance = max(max_distance, distance);
+                    matrix[i][j] = distance;
+                    matrix[j][i] = ((distance - 1) / 2);
+                    cumulative[i] += distance;
+                    cumulative[j] += distance;
+                }
+            }
+            for(auto& value : cumulative) {
+                value /= (cardinality() * 2);
+            }
+
+            // We want to know how many digits are in the biggest value to be able to align the matrix
+            int32_t padding(_spacing);
+            int32_t digit(max_distance);
+            do {
+                digit /= 10;
+                ++padding;
+            } while (digit != 0);
 
-                for(size_t i(0); i < _cumulative.size(); ++i) {
-                    _cumulative[i] /= (cardinality() * 2);
+            for(int32_t i(0); i < cardinality(); ++i) {
+                o << "    ";
+                for(int32_t j(0); j < cardinality(); ++j) {
+                    o << setw(padding) << matrix[i][j];
                 }
-                // We want to know how many digits are in the biggest value to be able to align the matrix
-                _padding = _spacing;
-                int32_t digit(_max_distance);
-                do {
-                    digit /= 10;
-                    ++_padding;
-                } while (digit != 0);
+                o << word(i) << ' ' << setw(padding) << cumulative[i] << endl;
             }
+            o << endl;
         };
-        inline int32_t hamming_distance(const string& left, const string& right) const {
+        void describe_distribution(ostream& o) const {
+            map< int32_t, int32_t > distribution;
+            for(const auto& distance : nearest_neighbor_distance()) {
+                ++(distribution[distance]);
+            }
+            o << "    Minimum distance    " << _min_distance << endl;
+            o << "    Shannon bound       " << _shannon_bound << endl;
+            o << "    Nearest neighbor distance distribution" << endl;
+            for(const auto& record : distribution) {
+                o << "        " << setw(6) << record.first << record.second << endl;
+            }
+            o << endl;
+        };
+        inline int32_t hamming_distance(const string& left, const string& right, const int32_t& bound=numeric_limits< int32_t >::max()) const {
             int32_t result(0);
-            for(size_t i(0); i < left.length(); ++i) {
+            for(size_t i(0); i < left.length() && result < bound; ++i) {
                 if(left[i] != right[i]) {
                     ++result;
                 }
             }
             return result;
         };
-        inline int32_t shannon_bound(const string& left, const string& right) const {
-            int32_t result(hamming_distance(left, right));
-            result = ((result - 1) / 2);
-            return result;
-        };
 };
 
 class CodecMetric {
@@ -203,7 +292,7 @@ class CodecMetric {
                 throw InternalError("CodecMetric :: " + string(error.what()));
         };
         inline bool empty() const {
-            return concatenated_metric.empty();
+            return concatenated().empty();
         };
         void compile_barcode_tolerance(Value& value, Document& document) {
             vector< int32_t > shannon_bound_array(segment_cardinality);
@@ -232,9 +321,9 @@ class CodecMetric {
             } else { encode_key_value("distance tolerance", shannon_bound_array, value, document); }
         };
         void describe(ostream& o) const {
-            if(!concatenated_metric.empty()) {
+            if(!concatenated().empty()) {
                 o << "    Hamming distance distribution" << endl << endl;
-                concatenated_metric.describe(o);
+                concatenated().describe(o);
 
                 if(segment_cardinality > 1) {
                     int32_t index(0);
@@ -250,6 +339,11 @@ class CodecMetric {
     private:
         WordMetric concatenated_metric;
         vector< WordMetric > segment_metric;
+
+        /* a single segment codec is its own concatenation so the neighborhood is only searched once */
+        inline const WordMetric& concatenated() const {
+            return segment_cardinality > 1 || segment_metric.empty() ? concatenated_metric : segment_metric.front();
+        };
         void add(const Barcode& barcode) {
             if(segment_cardinality == barcode.segment_cardinality()) {
                 for(size_t i(0); i < barcode.segment_cardinality(); ++i) {
@@ -259,10 +353,12 @@ class CodecMetric {
                         throw ConfigurationError("segment " + to_string(i) + " is " + error.message);
                     }
                 }
-                try {
-                    concatenated_metric.add(barcode.iupac_ambiguity());
-                } catch(ConfigurationError& error) {
-                    throw ConfigurationError("concatenated is " + error.message);
+                if(segment_cardinality > 1) {
+                    try {
+                        concatenated_metric.add(barcode.iupac_ambiguity());
+                    } catch(ConfigurationError& error) {
+                        throw ConfigurationError("concatenated is " + error.message);
+                    }
                 }
             } else {
                 throw ConfigurationError("barcode must have " + to_string(segment_cardinality) + " segments");
@@ -85,12 +85,81 @@ static void apply_inheritence_by_key(const Value::Ch* key, Value& container, Doc
         }
     }
 };
+static int32_t decode_compression_level(const Value& container, const int32_t& inherited, bool& declared) {
+    int32_t level(inherited);
+    declared = decode_value_by_key< int32_t >("compression level", level, container);
+    if(declared && level < 0) {
+        throw ConfigurationError("compression level must be a non negative number");
+    }
+    return level;
+};
+static void resolve_compression_level(const URL& url, const int32_t& level, const bool& declared, unordered_map< URL, int32_t >& level_by_url) {
+    /*  the global level applies only to the compressed output files
+        while a level declared on a barcode for a file that is not compressed is an error */
+    if(level != DEFAULT_COMPRESSION_LEVEL && !url.is_dev_null()) {
+        if(url.compression() == "zst") {
+            if(level < 1 || level > 22) {
+                throw ConfigurationError("zstd compression level for " + string(url) + " must be between 1 and 22");
+            }
+        } else if(url.compression() == "gz" || url.type() == FormatType::BAM || url.type() == FormatType::CRAM) {
+            if(level > 9) {
+                throw ConfigurationError("compression level for " + string(url) + " must be between 0 and 9");
+            }
+        } else if(declared) {
+            throw ConfigurationError("compression level declared for uncompressed output " + string(url));
+        }
+    }
+    auto record = level_by_url.find(url);
+    if(record == level_by_url.end()) {
+        level_by_url.emplace(make_pair(url, level));
+    } else if(record->second != level) {
+        throw ConfigurationError("inconsistent compression level for " + string(url));
+    }
+};
+static void resolve_cram_option(const URL& url, const list< string >& option, unordered_map< URL, list< string > >& option_by_url) {
+    if(url.type() == FormatType::CRAM && !option.empty()) {
+        hts_opt_free(decode_cram_option(option));
+    }
+    auto record = option_by_url.find(url);
+    if(record == option_by_url.end()) {
+        option_by_url.emplace(make_pair(url, option));
+    } else if(record->second != option) {
+        throw ConfigurationError("inconsistent CRAM options for " + string(url));
+    }
+};
+static bool is_hts_format(const URL& url) {
+    return url.type() == FormatType::SAM || url.type() == FormatType::BAM || url.type() == FormatType::CRAM;
+};
 
 MultiplexJob::MultiplexJob(Document& operation) try :
     Job(operation),
     decoder_repository_query("/decoder"),
     end_of_input(false),
-    thread_pool({NULL, 0}) {
+    input_ordinal(0),
+    thread_pool({NULL, 0}),
+    input_thread_pool({NULL, 0}),
+    thread_balancing(false),
+    maximum_pivot_count(0),
+    numa(NULL),
+    decoding_time(0),
+    running_pivot_count(0),
+    shard_index(0),
+    shard_count(1),
+    progress_interval(0),
+    progress_complete(false),
+    trace(NULL),
+    writer(NULL),
+    pass_through(false),
+    tag_augmentation(false),
+    census(false),
+    checkpoint_interval(0),
+    checkpoint_complete(false),
+    checkpoint_pending(false),
+    paused_pivot_count(0),
+    checkpoint_count(0),
+    checkpoint_time(0),
+    resume_ordinal(0),
+    resume_by_seek(false) {
 
     } catch(ConfigurationError& error) {
         throw ConfigurationError("MultiplexJob :: " + error.message);
@@ -99,9 +168,32 @@ MultiplexJob::MultiplexJob(Document& operation) try :
         throw InternalError("MultiplexJob :: " + string(error.what()));
 };
 MultiplexJob::~MultiplexJob() {
-    if(thread_pool.pool != NULL) {
+    if(progress_thread.joinable()) {
+        stop_progress();
+    }
+    /* a pool borrowed from a thread budget is destroyed by the budget */
+    if(thread_pool.pool != NULL && thread_budget == NULL) {
         hts_tpool_destroy(thread_pool.pool);
     }
+    if(input_thread_pool.pool != NULL) {
+        hts_tpool_destroy(input_thread_pool.pool);
+    }
+    if(trace != NULL) {
+        delete trace;
+        trace = NULL;
+    }
+    if(numa != NULL) {
+        delete numa;
+        numa = NULL;
+    }
+    for(auto& record : codec_index_by_url) {
+        delete record.second;
+    }
+    codec_index_by_url.clear();
+    for(auto& record : cluster_table_by_index) {
+        delete record.second;
+    }
+    cluster_table_by_index.clear();
     for(auto feed : input_feed_by_index) {
         delete feed;
     }
@@ -111,13 +203,29 @@ MultiplexJob::~MultiplexJob() {
     input_feed_by_segment.clear();
     input_feed_by_index.clear();
     output_feed_by_index.clear();
+
+    /* output files hold a reference to the writer until they are closed */
+    if(writer != NULL) {
+        delete writer;
+        writer = NULL;
+    }
 };
 
 void MultiplexJob::load() {
     validate_url_accessibility();
     load_thread_pool();
+    load_numa();
     load_input();
+    load_shard();
+    load_cluster_table();
+    load_checkpoint();
     load_output();
+    load_pass_through();
+    load_tag_augmentation();
+    load_census();
+    load_progress();
+    load_trace();
+    load_codec_index();
     load_pivot();
 };
 void MultiplexJob::manipulate() {
@@ -128,8 +236,60 @@ void MultiplexJob::manipulate() {
     compile_decoder_group("molecular");
     compile_decoder_group("cellular");
     compile_output();
+    compile_progress();
+    compile_trace();
+    compile_checkpoint();
     ontology.RemoveMember("decoder");
 };
+static void fingerprint_file(const URL& url, string& fingerprint) {
+    fingerprint.append(url.path());
+    struct stat status;
+    if(!url.is_standard_stream() && stat(url.path().c_str(), &status) == 0) {
+        fingerprint.push_back(' ');
+        fingerprint.append(to_string(status.st_dev));
+        fingerprint.push_back(':');
+        fingerprint.append(to_string(status.st_ino));
+        fingerprint.push_back(' ');
+        fingerprint.append(to_string(status.st_size));
+        fingerprint.push_back(' ');
+        fingerprint.append(to_string(status.st_mtime));
+    }
+    fingerprint.push_back('\n');
+};
+static void fingerprint_codec_index(const Value& value, string& fingerprint) {
+    if(value.IsObject()) {
+        for(auto& element : value.GetObject()) {
+            if(element.value.IsString() && element.name == "codec index url") {
+                URL url(string(element.value.GetString(), element.value.GetStringLength()));
+                url.expand();
+                fingerprint_file(url, fingerprint);
+            } else {
+                fingerprint_codec_index(element.value, fingerprint);
+            }
+        }
+    } else if(value.IsArray()) {
+        for(auto& element : value.GetArray()) {
+            fingerprint_codec_index(element, fingerprint);
+        }
+    }
+};
+void MultiplexJob::fingerprint_input(string& fingerprint) const {
+    /*  compile_input probes the input files and compile_decoder copies the codec index
+        bound, noise and tolerance into the ontology so the identity of both is part of the compile cache key */
+    URL base;
+    decode_value_by_key< URL >("base input url", base, ontology);
+    base.expand();
+
+    list< URL > feed_url_array;
+    if(decode_value_by_key< list< URL > >("input", feed_url_array, ontology)) {
+        for(auto& url : feed_url_array) {
+            url.expand();
+            url.relocate_child(base);
+            fingerprint_file(url, fingerprint);
+        }
+    }
+    fingerprint_codec_index(ontology, fingerprint);
+};
 void MultiplexJob::validate() {
     Job::validate();
 
@@ -147,6 +307,54 @@ void MultiplexJob::validate() {
         }
     }
 
+    int32_t progress_interval;
+    if(decode_value_by_key< int32_t >("progress interval", progress_interval, ontology)) {
+        if(progress_interval < 0) {
+            throw ConfigurationError("progress interval must be a non negative number of seconds");
+        }
+    }
+
+    int32_t checkpoint_interval;
+    if(decode_value_by_key< int32_t >("checkpoint interval", checkpoint_interval, ontology) && checkpoint_interval < 1) {
+        throw ConfigurationError("checkpoint interval must be a positive number of seconds");
+    }
+    if(decode_value_by_key< bool >("resume", ontology) && !ontology.HasMember("checkpoint url")) {
+        throw ConfigurationError("resume requires a checkpoint url");
+    }
+
+    int32_t read_ahead;
+    if(decode_value_by_key< int32_t >("read ahead", read_ahead, ontology) && read_ahead < 0) {
+        throw ConfigurationError("read ahead must be a non negative number of megabytes");
+    }
+
+    WriterBackend output_writer(WriterBackend::STANDARD);
+    decode_value_by_key< WriterBackend >("output writer", output_writer, ontology);
+    if(output_writer == WriterBackend::UNKNOWN) {
+        throw ConfigurationError("output writer must be standard, batched or pwrite");
+    }
+    int32_t writer_threads;
+    if(decode_value_by_key< int32_t >("writer threads", writer_threads, ontology) && writer_threads < 1) {
+        throw ConfigurationError("writer threads must be a positive number");
+    }
+
+    int32_t compression_level;
+    if(decode_value_by_key< int32_t >("compression level", compression_level, ontology) && compression_level < 0) {
+        throw ConfigurationError("compression level must be a non negative number");
+    }
+
+    int32_t decoding_threads;
+    if(decode_value_by_key< int32_t >("decoding threads", decoding_threads, ontology) && decoding_threads < 1) {
+        throw ConfigurationError("decoding threads must be a positive number");
+    }
+    int32_t compression_threads;
+    if(decode_value_by_key< int32_t >("compression threads", compression_threads, ontology) && compression_threads < 1) {
+        throw ConfigurationError("compression threads must be a positive number");
+    }
+    int32_t io_threads;
+    if(decode_value_by_key< int32_t >("io threads", io_threads, ontology) && io_threads < 0) {
+        throw ConfigurationError("io threads must be a non negative number");
+    }
+
     validate_decoder_group("multiplex");
     validate_decoder_group("molecular");
     validate_decoder_group("cellular");
@@ -160,6 +368,10 @@ void MultiplexJob::describe(ostream& o) const {
     print_cellular_instruction(o);
 };
 void MultiplexJob::execute() {
+    load_cluster_table();
+    if(!cluster_table_by_index.empty()) {
+        count_molecules();
+    }
     load();
     start();
     stop();
@@ -178,12 +390,133 @@ void MultiplexJob::start() {
     for(auto feed : output_feed_by_index) {
         feed->start();
     }
+    if(resume_state.IsObject()) {
+        resume();
+    }
+    start_progress();
+    const steady_clock::time_point begin(steady_clock::now());
     for(auto& pivot : pivot_array) {
-        pivot.start();
+        start_pivot(pivot);
+    }
+    start_checkpoint();
+
+    /*  when sharing a thread budget with other jobs keep adding pivots
+        from threads returned to the budget until the input is exhausted */
+    while(lease_additional_thread()) {
+        lock_guard< mutex > pivot_lock(pivot_mutex);
+        start_pivot(emplace_pivot());
+    }
+    if(thread_balancing) {
+        balance_pivots();
     }
     for(auto& pivot : pivot_array) {
         pivot.join();
     }
+    decoding_time = duration< double >(steady_clock::now() - begin).count();
+    stop_checkpoint();
+};
+MultiplexPivot& MultiplexJob::emplace_pivot() {
+    /*  In NUMA mode the pivot is constructed while the calling thread is bound to the node
+        the pivot will run on, so its decoders and buffers are allocated on that node,
+        and the pivot thread is pinned to a core of that node when it starts.
+        Jobs sharing a thread budget take the placement ordinal from the budget
+        so their pivots are not pinned to the same cores */
+    const int32_t index(static_cast< int32_t >(pivot_array.size()));
+    if(numa != NULL) {
+        const int32_t placement(thread_budget != NULL ? thread_budget->next_placement() : index);
+        numa->bind_to_node(placement);
+        try {
+            pivot_array.emplace_back(*this, index);
+        } catch(...) {
+            numa->restore();
+            throw;
+        }
+        numa->restore();
+        pivot_array.back().placement = placement;
+        pivot_array.back().set_cpu_affinity(vector< int32_t >(1, numa->cpu_of(placement)));
+    } else {
+        pivot_array.emplace_back(*this, index);
+    }
+    return pivot_array.back();
+};
+void MultiplexJob::start_pivot(MultiplexPivot& pivot) {
+    running_pivot_count.fetch_add(1);
+    pivot.start();
+};
+void MultiplexJob::complete_pivot() {
+    {
+        lock_guard< mutex > checkpoint_lock(checkpoint_mutex);
+        running_pivot_count.fetch_sub(1);
+    }
+    checkpoint_paused.notify_all();
+    release_thread();
+};
+void MultiplexJob::balance_pivots() {
+    /*  Sample the pipeline once a second during the first seconds of decoding.
+        Pivots waiting on input, or output queues that stay full, mean decoding threads are
+        taking cores from reading and compression so a pivot is retired. When pivots never wait
+        and output queues drain quickly another pivot is started, up to the thread count.
+        The compression thread pool only occupies a core when it has blocks to compress,
+        so moving pivots in and out moves cores between decoding and compression */
+    Value history(kArrayType);
+    const steady_clock::time_point begin(steady_clock::now());
+    steady_clock::time_point last(begin);
+    uint64_t last_wait_time(0);
+    int32_t active(static_cast< int32_t >(pivot_array.size()));
+    for(int32_t sample(0); sample < THREAD_BALANCING_PERIOD && is_accepting_threads(); ++sample) {
+        for(int32_t i(0); i < 10 && is_accepting_threads(); ++i) {
+            sleep_for(milliseconds(100));
+        }
+        if(!is_accepting_threads()) {
+            break;
+        }
+        const steady_clock::time_point now(steady_clock::now());
+        const double interval(duration< double >(now - last).count());
+
+        uint64_t wait_time(0);
+        for(const auto& pivot : pivot_array) {
+            wait_time += pivot.wait_time();
+        }
+        const double input_wait_ratio(static_cast< double >(wait_time - last_wait_time) / 1e9 / (interval * active));
+
+        double output_occupancy(0);
+        int32_t measured(0);
+        for(const auto feed : output_feed_by_index) {
+            if(!feed->is_dev_null() && feed->capacity() > 0) {
+                output_occupancy += static_cast< double >(feed->occupancy()) / static_cast< double >(feed->capacity());
+                ++measured;
+            }
+        }
+        if(measured > 0) {
+            output_occupancy /= measured;
+        }
+
+        if((input_wait_ratio > 0.5 || output_occupancy > 0.75) && active > 1) {
+            for(auto pivot = pivot_array.rbegin(); pivot != pivot_array.rend(); ++pivot) {
+                if(!pivot->retired()) {
+                    pivot->retire();
+                    --active;
+                    break;
+                }
+            }
+        } else if(input_wait_ratio < 0.1 && output_occupancy < 0.5 && active < maximum_pivot_count) {
+            lock_guard< mutex > pivot_lock(pivot_mutex);
+            start_pivot(emplace_pivot());
+            ++active;
+        }
+
+        Value element(kObjectType);
+        encode_key_value("elapsed", duration< double >(now - begin).count(), element, report);
+        encode_key_value("input wait ratio", input_wait_ratio, element, report);
+        encode_key_value("output occupancy", output_occupancy, element, report);
+        encode_key_value("decoding threads", active, element, report);
+        history.PushBack(element.Move(), report.GetAllocator());
+
+        last = now;
+        last_wait_time = wait_time;
+    }
+    report.RemoveMember("thread balancing");
+    report.AddMember(Value("thread balancing", report.GetAllocator()).Move(), history.Move(), report.GetAllocator());
 };
 void MultiplexJob::stop() {
     /*
@@ -200,6 +533,23 @@ void MultiplexJob::stop() {
     for(auto feed : output_feed_by_index) {
         feed->join();
     }
+    if(trace != NULL) {
+        trace->close();
+    }
+    stop_progress();
+
+    /* the last checkpoint written successfully is kept so the run can be resumed from it */
+    if(checkpoint_error) {
+        rethrow_exception(checkpoint_error);
+    }
+    if(writer != NULL) {
+        writer->rethrow();
+    }
+
+    /* the run completed so there is nothing to resume from */
+    if(checkpoint_interval > 0) {
+        remove(checkpoint_url.c_str());
+    }
 };
 void MultiplexJob::finalize() {
     Value value;
@@ -212,15 +562,434 @@ void MultiplexJob::finalize() {
         input_accumulator += pivot.input_accumulator;
         output_accumulator += pivot.output_accumulator;
     }
+
+    /*  finalizing folds the per nucleotide cycle distributions together
+        so the raw state must be encoded before the accumulators are finalized */
+    if(shard_count > 1 || decode_value_by_key< bool >("mergeable report", ontology)) {
+        Value mergeable(kObjectType);
+        Value element;
+        input_accumulator.encode_raw(element, report);
+        mergeable.AddMember(Value("input", report.GetAllocator()).Move(), element.Move(), report.GetAllocator());
+        output_accumulator.encode_raw(element, report);
+        mergeable.AddMember(Value("output", report.GetAllocator()).Move(), element.Move(), report.GetAllocator());
+        report.AddMember(Value("mergeable report", report.GetAllocator()).Move(), mergeable.Move(), report.GetAllocator());
+    }
+
     input_accumulator.finalize();
     output_accumulator.finalize();
     encode_key_value("demultiplex output report", output_accumulator, report, report);
     encode_key_value("demultiplex input report", input_accumulator, report, report);
 
+    if(!cluster_table_by_index.empty()) {
+        Value clustering(kArrayType);
+        for(const auto& record : cluster_table_by_index) {
+            Value element(kObjectType);
+            encode_key_value("index", record.first, element, report);
+            record.second->encode(element, report);
+            clustering.PushBack(element.Move(), report.GetAllocator());
+        }
+        report.AddMember(Value("molecular clustering", report.GetAllocator()).Move(), clustering.Move(), report.GetAllocator());
+    }
+
+    if(!shard_file_array.empty()) {
+        Value shard_report(kObjectType);
+        encode_key_value("index", shard_index + 1, shard_report, report);
+        encode_key_value("count", shard_count, shard_report, report);
+        Value input(kArrayType);
+        for(const auto& file : shard_file_array) {
+            Value element;
+            encode_value(file, element, report);
+            input.PushBack(element.Move(), report.GetAllocator());
+        }
+        shard_report.AddMember(Value("input", report.GetAllocator()).Move(), input.Move(), report.GetAllocator());
+        report.AddMember(Value("shard", report.GetAllocator()).Move(), shard_report.Move(), report.GetAllocator());
+    }
+
+    if(checkpoint_interval > 0) {
+        Value checkpoint_report(kObjectType);
+        encode_key_value("interval", checkpoint_interval, checkpoint_report, report);
+        encode_key_value("count", checkpoint_count, checkpoint_report, report);
+        encode_key_value("time", checkpoint_time, checkpoint_report, report);
+        encode_key_value("resume ordinal", resume_ordinal, checkpoint_report, report);
+        if(decoding_time > 0) {
+            encode_key_value("overhead", checkpoint_time / decoding_time, checkpoint_report, report);
+        }
+        report.AddMember(Value("checkpoint", report.GetAllocator()).Move(), checkpoint_report.Move(), report.GetAllocator());
+    }
+
+    if(pass_through) {
+        uint64_t count(0);
+        for(auto& pivot : pivot_array) {
+            count += pivot.forwarded_count();
+        }
+        Value pass_through_report(kObjectType);
+        encode_key_value("count", count, pass_through_report, report);
+        report.AddMember(Value("pass through", report.GetAllocator()).Move(), pass_through_report.Move(), report.GetAllocator());
+    }
+
+    if(writer != NULL) {
+        Value writer_report(kObjectType);
+        writer->encode(writer_report, report);
+        report.AddMember(Value("output writer", report.GetAllocator()).Move(), writer_report.Move(), report.GetAllocator());
+    }
+
+    if(numa != NULL) {
+        Value node_report(kArrayType);
+        for(int32_t position(0); position < numa->size(); ++position) {
+            const NumaNode& node(numa->node_array[position]);
+            int32_t pivot_count(0);
+            uint64_t count(0);
+            for(const auto& pivot : pivot_array) {
+                if(pivot.placement % numa->size() == position) {
+                    ++pivot_count;
+                    count += pivot.count();
+                }
+            }
+            Value element(kObjectType);
+            encode_key_value("node", node.index, element, report);
+            encode_key_value("cores", static_cast< int32_t >(node.cpu_array.size()), element, report);
+            encode_key_value("decoding threads", pivot_count, element, report);
+            encode_key_value("count", count, element, report);
+            if(decoding_time > 0) {
+                encode_key_value("rate", static_cast< double >(count) / decoding_time, element, report);
+            }
+            node_report.PushBack(element.Move(), report.GetAllocator());
+        }
+        report.AddMember(Value("numa", report.GetAllocator()).Move(), node_report.Move(), report.GetAllocator());
+    }
+
+    #if defined(PHENIQS_PROFILE)
+    Value profile(kObjectType);
+    encode_profile(profile, report);
+    report.AddMember(Value("profile", report.GetAllocator()).Move(), profile.Move(), report.GetAllocator());
+    #endif
+
     clean_json_value(report, report);
     sort_json_value(report, report);
 };
-bool MultiplexJob::pull(Read& read) {
+void MultiplexJob::start_progress() {
+    if(progress_interval > 0) {
+        progress_complete = false;
+        progress_thread = thread(&MultiplexJob::run_progress, this);
+    }
+};
+void MultiplexJob::stop_progress() {
+    if(progress_thread.joinable()) {
+        {
+            lock_guard< mutex > progress_lock(progress_mutex);
+            progress_complete = true;
+        }
+        progress_interrupt.notify_all();
+        progress_thread.join();
+    }
+    if(progress_file.is_open()) {
+        progress_file.close();
+    }
+};
+void MultiplexJob::run_progress() {
+    /*  Emit a single line JSON progress record every progress interval seconds
+        and one final record when the job completes.
+        The counters sampled here are relaxed atomics updated by the pivots and feeds
+        so sampling them does not interfere with the hot path */
+    ostream& o(progress_file.is_open() ? static_cast< ostream& >(progress_file) : cerr);
+    const steady_clock::time_point begin(steady_clock::now());
+    steady_clock::time_point last(begin);
+    uint64_t last_input_count(0);
+    uint64_t last_output_count(0);
+    bool complete(false);
+    while(!complete) {
+        {
+            unique_lock< mutex > progress_lock(progress_mutex);
+            progress_interrupt.wait_for(progress_lock, seconds(progress_interval), [this]() { return progress_complete; });
+            complete = progress_complete;
+        }
+        steady_clock::time_point now(steady_clock::now());
+        Document progress(kObjectType);
+        encode_progress (
+            duration< double >(now - begin).count(),
+            duration< double >(now - last).count(),
+            last_input_count,
+            last_output_count,
+            progress,
+            progress
+        );
+        print_json_line(progress, o);
+        last = now;
+    }
+};
+void MultiplexJob::start_checkpoint() {
+    if(checkpoint_interval > 0) {
+        checkpoint_complete = false;
+        checkpoint_thread = thread(&MultiplexJob::run_checkpoint, this);
+    }
+};
+void MultiplexJob::stop_checkpoint() {
+    if(checkpoint_thread.joinable()) {
+        {
+            lock_guard< mutex > checkpoint_lock(checkpoint_mutex);
+            checkpoint_complete = true;
+        }
+        checkpoint_interrupt.notify_all();
+        checkpoint_thread.join();
+    }
+};
+void MultiplexJob::run_checkpoint() {
+    bool complete(false);
+    while(!complete) {
+        {
+            unique_lock< mutex > checkpoint_lock(checkpoint_mutex);
+            complete = checkpoint_interrupt.wait_for(checkpoint_lock, seconds(checkpoint_interval), [this]() { return checkpoint_complete; });
+        }
+        if(!complete) {
+            try {
+                write_checkpoint();
+            } catch(...) {
+                /*  the pivots were released so decoding continues without further checkpoints
+                    and the error is raised on the calling thread when the job stops */
+                checkpoint_error = current_exception();
+                complete = true;
+            }
+        }
+    }
+};
+void MultiplexJob::pause_pivot() {
+    unique_lock< mutex > checkpoint_lock(checkpoint_mutex);
+    ++paused_pivot_count;
+    checkpoint_paused.notify_all();
+    checkpoint_released.wait(checkpoint_lock, [this]() { return !checkpoint_pending.load(); });
+    --paused_pivot_count;
+};
+void MultiplexJob::write_checkpoint() {
+    /*  Pivots pause when they next pull a read. Once every running pivot is paused
+        all records pulled so far are pushed to the output feeds and counted in the accumulators.
+        Output feeds are then drained and synchronized so the files end on a BGZF block boundary.
+        The pause only lasts as long as it takes to write the output buffers */
+    const steady_clock::time_point begin(steady_clock::now());
+    bool paused(false);
+    {
+        unique_lock< mutex > checkpoint_lock(checkpoint_mutex);
+        checkpoint_pending.store(true, memory_order_release);
+        checkpoint_paused.wait(checkpoint_lock, [this]() { return end_of_input || paused_pivot_count >= running_pivot_count.load(); });
+        paused = !end_of_input;
+    }
+
+    /*  an error is reported only once the pivots are released */
+    exception_ptr error;
+    if(paused) {
+        try {
+            Document checkpoint(kObjectType);
+            encode_key_value("ordinal", input_ordinal, checkpoint, checkpoint);
+
+            list< URL > input;
+            for(const auto feed : input_feed_by_index) {
+                input.emplace_back(feed->url);
+            }
+            encode_key_value("input", input, checkpoint, checkpoint);
+
+            Value output(kArrayType);
+            for(auto feed : output_feed_by_index) {
+                const int64_t offset(feed->checkpoint());
+                if(offset < 0) {
+                    throw IOError("failed to checkpoint " + string(feed->url));
+                }
+                Value element(kObjectType);
+                encode_key_value("url", feed->url, element, checkpoint);
+                encode_key_value("offset", offset, element, checkpoint);
+                output.PushBack(element.Move(), checkpoint.GetAllocator());
+            }
+            checkpoint.AddMember(Value("output", checkpoint.GetAllocator()).Move(), output.Move(), checkpoint.GetAllocator());
+
+            /* the position is only useful if every input can be sought to the same read */
+            Value position_array(kArrayType);
+            for(auto feed : input_feed_by_index) {
+                FeedPosition position;
+                if(!feed->tell(position)) {
+                    position_array.Clear();
+                    break;
+                }
+                Value element(kObjectType);
+                encode_key_value("offset", position.offset, element, checkpoint);
+                encode_key_value("skip", position.skip, element, checkpoint);
+                encode_key_value("consumed", position.consumed, element, checkpoint);
+                position_array.PushBack(element.Move(), checkpoint.GetAllocator());
+            }
+            if(!position_array.Empty()) {
+                checkpoint.AddMember(Value("input position", checkpoint.GetAllocator()).Move(), position_array.Move(), checkpoint.GetAllocator());
+            }
+
+            InputAccumulator input_accumulator(ontology);
+            OutputAccumulator output_accumulator(find_value_by_key("multiplex", ontology));
+            {
+                lock_guard< mutex > pivot_lock(pivot_mutex);
+                for(auto& pivot : pivot_array) {
+                    input_accumulator += pivot.input_accumulator;
+                    output_accumulator += pivot.output_accumulator;
+                }
+            }
+            Value mergeable(kObjectType);
+            Value element;
+            input_accumulator.encode_raw(element, checkpoint);
+            mergeable.AddMember(Value("input", checkpoint.GetAllocator()).Move(), element.Move(), checkpoint.GetAllocator());
+            output_accumulator.encode_raw(element, checkpoint);
+            mergeable.AddMember(Value("output", checkpoint.GetAllocator()).Move(), element.Move(), checkpoint.GetAllocator());
+            checkpoint.AddMember(Value("mergeable report", checkpoint.GetAllocator()).Move(), mergeable.Move(), checkpoint.GetAllocator());
+
+            /* write to a temporary file and rename so a preempted checkpoint never replaces the previous one */
+            const string path(checkpoint_url.path());
+            const string temporary(path + "." + to_string(getpid()) + ".tmp");
+            ofstream file(temporary, ios_base::out | ios_base::trunc);
+            if(file.is_open()) {
+                print_json_line(checkpoint, file);
+                file.close();
+            }
+            if(file.fail() || rename(temporary.c_str(), path.c_str()) != 0) {
+                remove(temporary.c_str());
+                throw IOError("failed to write checkpoint to " + path);
+            }
+        } catch(...) {
+            error = current_exception();
+        }
+    }
+
+    {
+        lock_guard< mutex > checkpoint_lock(checkpoint_mutex);
+        checkpoint_pending.store(false, memory_order_release);
+        if(paused && !error) {
+            ++checkpoint_count;
+            checkpoint_time += duration< double >(steady_clock::now() - begin).count();
+        }
+    }
+    checkpoint_released.notify_all();
+    if(error) {
+        rethrow_exception(error);
+    }
+};
+void MultiplexJob::resume() {
+    /*  Restore the accumulated statistics. When the checkpoint recorded the input positions the input feeds
+        were already opened at the next read, otherwise the reads that were processed before the checkpoint
+        are parsed again and discarded without being decoded */
+    MultiplexPivot& pivot(pivot_array.front());
+    const Value& mergeable(find_value_by_key("mergeable report", resume_state));
+    pivot.input_accumulator.merge_raw(find_value_by_key("input", mergeable));
+    pivot.output_accumulator.merge_raw(find_value_by_key("output", mergeable));
+
+    if(resume_by_seek) {
+        input_ordinal = resume_ordinal;
+        return;
+    }
+    uint64_t ordinal(0);
+    while(input_ordinal < resume_ordinal) {
+        if(!pull(pivot.input, ordinal)) {
+            throw IOError("input ended before read " + to_string(resume_ordinal) + " recorded in checkpoint " + string(checkpoint_url));
+        }
+        pivot.input.clear();
+    }
+};
+static Value encode_feed_progress(const list< Feed* >& feed_by_index, Document& document) {
+    Value array(kArrayType);
+    for(const auto feed : feed_by_index) {
+        Value element(kObjectType);
+        encode_key_value("index", feed->index, element, document);
+        encode_key_value("url", feed->url, element, document);
+        encode_key_value("count", feed->record_count(), element, document);
+        encode_key_value("occupancy", static_cast< int32_t >(feed->occupancy()), element, document);
+        encode_key_value("capacity", static_cast< int32_t >(feed->capacity()), element, document);
+        array.PushBack(element.Move(), document.GetAllocator());
+    }
+    return array;
+};
+void MultiplexJob::encode_progress(const double& elapsed, const double& interval, uint64_t& last_input_count, uint64_t& last_output_count, Value& container, Document& document) {
+    lock_guard< mutex > pivot_lock(pivot_mutex);
+    uint64_t input_count(0);
+    Value pivot_progress(kArrayType);
+    for(const auto& pivot : pivot_array) {
+        Value element(kObjectType);
+        const uint64_t count(pivot.count());
+        const double wait_time(static_cast< double >(pivot.wait_time()) / 1e9);
+        encode_key_value("index", pivot.index, element, document);
+        encode_key_value("count", count, element, document);
+        encode_key_value("wait time", wait_time, element, document);
+        if(elapsed > 0) {
+            encode_key_value("wait ratio", wait_time / elapsed, element, document);
+        }
+        pivot_progress.PushBack(element.Move(), document.GetAllocator());
+        input_count += count;
+    }
+
+    /*  every pivot holds its own copy of the channels, in the same order,
+        so counts are summed over the pivots by position */
+    uint64_t output_count(0);
+    Value channel_progress(kArrayType);
+    if(!pivot_array.empty()) {
+        const vector< Channel* >& reference(pivot_array.front().channel_by_index);
+        for(size_t i(0); i < reference.size(); ++i) {
+            uint64_t count(0);
+            uint64_t channel_output_count(0);
+            for(const auto& pivot : pivot_array) {
+                count += pivot.channel_by_index[i]->count.load(memory_order_relaxed);
+                channel_output_count += pivot.channel_by_index[i]->output_count.load(memory_order_relaxed);
+            }
+            Value element(kObjectType);
+            encode_key_value("index", reference[i]->index, element, document);
+            encode_key_value("RG", reference[i]->rg.ID, element, document);
+            encode_key_value("count", count, element, document);
+            encode_key_value("output count", channel_output_count, element, document);
+            channel_progress.PushBack(element.Move(), document.GetAllocator());
+            output_count += channel_output_count;
+        }
+    }
+
+    encode_key_value("elapsed", elapsed, container, document);
+    encode_key_value("input count", input_count, container, document);
+    encode_key_value("output count", output_count, container, document);
+    if(interval > 0) {
+        encode_key_value("input rate", static_cast< double >(input_count - last_input_count) / interval, container, document);
+        encode_key_value("output rate", static_cast< double >(output_count - last_output_count) / interval, container, document);
+    }
+    container.AddMember("input feed", encode_feed_progress(input_feed_by_index, document).Move(), document.GetAllocator());
+    container.AddMember("output feed", encode_feed_progress(output_feed_by_index, document).Move(), document.GetAllocator());
+    container.AddMember("pivot", pivot_progress.Move(), document.GetAllocator());
+    container.AddMember("channel", channel_progress.Move(), document.GetAllocator());
+
+    last_input_count = input_count;
+    last_output_count = output_count;
+};
+#if defined(PHENIQS_PROFILE)
+static Value encode_feed_profile(const list< Feed* >& feed_by_index, Document& document) {
+    Value array(kArrayType);
+    for(const auto feed : feed_by_index) {
+        Value element(kObjectType);
+        encode_key_value("index", feed->index, element, document);
+        encode_key_value("url", feed->url, element, document);
+        encode_key_value("wait", feed->profile, element, document);
+        array.PushBack(element.Move(), document.GetAllocator());
+    }
+    return array;
+};
+void MultiplexJob::encode_profile(Value& container, Document& document) const {
+    PivotProfile aggregated;
+    Value pivot_profile(kArrayType);
+    for(const auto& pivot : pivot_array) {
+        Value element(kObjectType);
+        encode_key_value("index", pivot.index, element, document);
+        encode_key_value("count", pivot.count(), element, document);
+        encode_key_value("time", pivot.profile, element, document);
+        pivot_profile.PushBack(element.Move(), document.GetAllocator());
+        aggregated += pivot.profile;
+    }
+    encode_key_value("time", aggregated, container, document);
+    container.AddMember("pivot", pivot_profile.Move(), document.GetAllocator());
+    container.AddMember("input feed", encode_feed_profile(input_feed_by_index, document).Move(), document.GetAllocator());
+    container.AddMember("output feed", encode_feed_profile(output_feed_by_index, document).Move(), document.GetAllocator());
+};
+#endif
+
+bool MultiplexJob::pull(Read& read, uint64_t& ordinal) {
+    /* between reads a pivot has pushed and accumulated everything it pulled so it can wait out a checkpoint */
+    if(checkpoint_pending.load(memory_order_acquire)) {
+        pause_pivot();
+    }
+
     vector< unique_lock< mutex > > feed_locks;
     feed_locks.reserve(input_feed_by_index.size());
 
@@ -235,6 +1004,8 @@ bool MultiplexJob::pull(Read& read) {
             end_of_input = true;
         }
     }
+    ordinal = input_ordinal;
+    ++input_ordinal;
 
     /* release the locks on the input feeds in reverse order */
     for(auto feed_lock(feed_locks.rbegin()); feed_lock != feed_locks.rend(); ++feed_lock) {
@@ -429,6 +1200,10 @@ void MultiplexJob::detect_input() {
                 throw ConfigurationError("can not use /dev/null for input");
                 break;
             };
+            case FormatKind::SYNTHETIC: {
+                throw ConfigurationError("can not detect the segment layout of synthetic input");
+                break;
+            };
             default: {
                 throw ConfigurationError("unknown input format " + string(proxy.url));
                 break;
@@ -486,6 +1261,7 @@ void MultiplexJob::compile_decoder(Value& value, int32_t& index, const Value& de
         value.RemoveMember("base");
         encode_key_value("index", index, value, ontology);
         clean_json_value(value, ontology);
+        expand_url_value_by_key("codec index url", value, ontology, IoDirection::IN);
 
         compile_codec(value, default_decoder, default_barcode);
         compile_decoder_transformation(value);
@@ -619,6 +1395,52 @@ void MultiplexJob::compile_decoder_group(const Value::Ch* key) {
         }
     }
 };
+void MultiplexJob::compile_progress() {
+    expand_url_value_by_key("progress url", ontology, ontology, IoDirection::OUT);
+
+    URL url;
+    if(decode_value_by_key< URL >("progress url", url, ontology)) {
+        URL base;
+        if(decode_value_by_key< URL >("base output url", base, ontology)) {
+            url.relocate_child(base);
+            encode_key_value("progress url", url, ontology, ontology);
+        }
+    }
+};
+void MultiplexJob::compile_trace() {
+    expand_url_value_by_key("trace url", ontology, ontology, IoDirection::OUT);
+
+    URL url;
+    if(decode_value_by_key< URL >("trace url", url, ontology)) {
+        URL base;
+        if(decode_value_by_key< URL >("base output url", base, ontology)) {
+            url.relocate_child(base);
+        }
+        int32_t index(0);
+        int32_t count(1);
+        if(decode_shard(index, count) && count > 1 && !url.is_standard_stream()) {
+            url.set_basename(url.basename() + shard_suffix(index, count));
+        }
+        encode_key_value("trace url", url, ontology, ontology);
+    }
+};
+void MultiplexJob::compile_checkpoint() {
+    expand_url_value_by_key("checkpoint url", ontology, ontology, IoDirection::OUT);
+
+    URL url;
+    if(decode_value_by_key< URL >("checkpoint url", url, ontology)) {
+        URL base;
+        if(decode_value_by_key< URL >("base output url", base, ontology)) {
+            url.relocate_child(base);
+        }
+        int32_t index(0);
+        int32_t count(1);
+        if(decode_shard(index, count) && count > 1) {
+            url.set_basename(url.basename() + shard_suffix(index, count));
+        }
+        encode_key_value("checkpoint url", url, ontology, ontology);
+    }
+};
 void MultiplexJob::compile_output_transformation() {
     const int32_t input_segment_cardinality(decode_value_by_key< int32_t >("input segment cardinality", ontology));
 
@@ -656,7 +1478,35 @@ void MultiplexJob::compile_output() {
     int32_t buffer_capacity(decode_value_by_key< int32_t >("buffer capacity", ontology));
     uint8_t phred_offset(decode_value_by_key< uint8_t >("output phred offset", ontology));
 
-    Value::MemberIterator reference = ontology.FindMember("multiplex");
+    RecordGrouping grouping(RecordGrouping::NONE);
+    Value::MemberIterator reference = ontology.FindMember("output grouping");
+    if(reference != ontology.MemberEnd() && !reference->value.IsNull()) {
+        if(!decode_value_by_key< RecordGrouping >("output grouping", grouping, ontology)) {
+            throw ConfigurationError("output grouping must be one of none, cellular or molecular");
+        }
+    }
+    int32_t grouping_memory(DEFAULT_GROUPING_MEMORY);
+    decode_value_by_key< int32_t >("grouping memory", grouping_memory, ontology);
+    if(grouping_memory < 1 || grouping_memory > (numeric_limits< int32_t >::max() >> 10)) {
+        throw ConfigurationError("grouping memory must be a positive number of megabytes");
+    }
+
+    /*  the global compression level and CRAM options apply to every output file
+        unless the channel writing to it declares its own */
+    int32_t compression_level(DEFAULT_COMPRESSION_LEVEL);
+    decode_value_by_key< int32_t >("compression level", compression_level, ontology);
+    list< string > cram_option;
+    decode_value_by_key< list< string > >("cram option", cram_option, ontology);
+
+    /* every shard writes its own output files */
+    string suffix;
+    int32_t shard_index(0);
+    int32_t shard_count(1);
+    if(decode_shard(shard_index, shard_count) && shard_count > 1) {
+        suffix.assign(shard_suffix(shard_index, shard_count));
+    }
+
+    reference = ontology.FindMember("multiplex");
     if(reference != ontology.MemberEnd()) {
         if(reference->value.IsObject()) {
             Value& value(reference->value);
@@ -664,6 +1514,8 @@ void MultiplexJob::compile_output() {
             URL base(decode_value_by_key< URL >("base output url", value));
 
             unordered_map< URL, unordered_map< int32_t, int > > feed_resolution;
+            unordered_map< URL, int32_t > compression_level_by_url;
+            unordered_map< URL, list< string > > cram_option_by_url;
             Value::MemberIterator reference = value.FindMember("undetermined");
             if(reference != value.MemberEnd()) {
                 if(!reference->value.IsNull()) {
@@ -672,11 +1524,21 @@ void MultiplexJob::compile_output() {
                     pad_url_array_by_key("output", reference->value, output_segment_cardinality);
                     expand_url_array_by_key("output", reference->value, ontology, IoDirection::OUT);
                     relocate_url_array_by_key("output", reference->value, ontology, base);
+                    if(!suffix.empty()) {
+                        suffix_url_array_by_key("output", reference->value, ontology, suffix);
+                    }
+
+                    bool declared(false);
+                    int32_t level(decode_compression_level(reference->value, compression_level, declared));
+                    list< string > option(cram_option);
+                    decode_value_by_key< list< string > >("cram option", option, reference->value);
 
                     list< URL > feed_url_array;
                     if(decode_value_by_key< list< URL > >("output", feed_url_array, reference->value)) {
                         for(auto& url : feed_url_array) {
                             ++(feed_resolution[url][index]);
+                            resolve_compression_level(url, level, declared, compression_level_by_url);
+                            resolve_cram_option(url, option, cram_option_by_url);
                         }
                     }
                 }
@@ -691,11 +1553,21 @@ void MultiplexJob::compile_output() {
                             pad_url_array_by_key("output", record.value, output_segment_cardinality);
                             expand_url_array_by_key("output", record.value, ontology, IoDirection::OUT);
                             relocate_url_array_by_key("output", record.value, ontology, base);
+                            if(!suffix.empty()) {
+                                suffix_url_array_by_key("output", record.value, ontology, suffix);
+                            }
+
+                            bool declared(false);
+                            int32_t level(decode_compression_level(record.value, compression_level, declared));
+                            list< string > option(cram_option);
+                            decode_value_by_key< list< string > >("cram option", option, record.value);
 
                             list< URL > feed_url_array;
                             if(decode_value_by_key< list< URL > >("output", feed_url_array, record.value)) {
                                 for(auto& url : feed_url_array) {
                                     ++(feed_resolution[url][index]);
+                                    resolve_compression_level(url, level, declared, compression_level_by_url);
+                                    resolve_cram_option(url, option, cram_option_by_url);
                                 }
                             }
                         }
@@ -704,6 +1576,19 @@ void MultiplexJob::compile_output() {
             }
 
             if(feed_resolution.size() > 0) {
+                /*  grouping memory is a budget for the whole job split evenly, in kilobytes, across the grouped output files */
+                int32_t grouping_capacity(grouping_memory << 10);
+                if(grouping != RecordGrouping::NONE) {
+                    int32_t grouped_count(0);
+                    for(const auto& url_record : feed_resolution) {
+                        if(!url_record.first.is_dev_null()) {
+                            ++grouped_count;
+                        }
+                    }
+                    if(grouped_count > 0) {
+                        grouping_capacity = max(grouping_capacity / grouped_count, 1);
+                    }
+                }
                 unordered_map< URL, Value > feed_ontology_by_url;
                 int32_t index(0);
                 for(const auto& url_record : feed_resolution) {
@@ -724,6 +1609,21 @@ void MultiplexJob::compile_output() {
                     encode_key_value("capacity", buffer_capacity * resolution, proxy, ontology);
                     encode_key_value("resolution", resolution, proxy, ontology);
                     encode_key_value("phred offset", phred_offset, proxy, ontology);
+                    if(grouping != RecordGrouping::NONE && !url.is_dev_null()) {
+                        if(url.type() != FormatType::SAM && url.type() != FormatType::BAM && url.type() != FormatType::CRAM) {
+                            throw ConfigurationError("output grouping requires SAM, BAM or CRAM output but " + string(url) + " is not");
+                        }
+                        encode_key_value("grouping", grouping, proxy, ontology);
+                        encode_key_value("grouping capacity", grouping_capacity, proxy, ontology);
+                    }
+                    const int32_t level(compression_level_by_url[url]);
+                    if(level != DEFAULT_COMPRESSION_LEVEL) {
+                        encode_key_value("compression level", level, proxy, ontology);
+                    }
+                    const list< string >& option(cram_option_by_url[url]);
+                    if(url.type() == FormatType::CRAM && !option.empty()) {
+                        encode_key_value("cram option", option, proxy, ontology);
+                    }
                     feed_ontology_by_url.emplace(make_pair(url, move(proxy)));
                     ++index;
                 }
@@ -864,9 +1764,15 @@ void MultiplexJob::compile_decoder_transformation(Value& value) {
             }
         }
 
-        CodecMetric metric(value);
-        metric.compile_barcode_tolerance(value, ontology);
-
+        URL url;
+        if(!value.HasMember("codec") && decode_value_by_key< URL >("codec index url", url, value)) {
+            /* a precompiled codec index carries its own shannon bound so the codec metric is not needed */
+            CodecIndex index(url);
+            index.compile_decoder(value, ontology);
+        } else {
+            CodecMetric metric(value);
+            metric.compile_barcode_tolerance(value, ontology);
+        }
     }
 };
 bool MultiplexJob::infer_PU(const Value::Ch* key, string& buffer, Value& container, const bool& undetermined) {
@@ -955,19 +1861,28 @@ void MultiplexJob::validate_decoder_group(const Value::Ch* key) {
     if(reference != ontology.MemberEnd()) {
         if(!reference->value.IsNull()) {
             if(reference->value.IsObject()) {
-                validate_decoder(reference->value);
+                validate_decoder(key, reference->value);
             } else if(reference->value.IsArray()) {
                 for(auto& decoder : reference->value.GetArray()) {
                     if(!decoder.IsNull()) {
-                        validate_decoder(decoder);
+                        validate_decoder(key, decoder);
                     }
                 }
             }
         }
     }
 };
-void MultiplexJob::validate_decoder(Value& value) {
+void MultiplexJob::validate_decoder(const Value::Ch* key, Value& value) {
     if(value.IsObject()) {
+        if(value.HasMember("codec index url")) {
+            if(strcmp(key, "cellular")) {
+                throw ConfigurationError("codec index url is only supported for cellular decoders");
+            }
+            Algorithm algorithm(decode_value_by_key< Algorithm >("algorithm", value));
+            if(algorithm != Algorithm::PAMLD && algorithm != Algorithm::MDD) {
+                throw ConfigurationError("codec index url requires the pamld or mdd algorithm");
+            }
+        }
         if(value.HasMember("codec")) {
             double confidence_threshold;
             if(decode_value_by_key< double >("confidence threshold", confidence_threshold, value)) {
@@ -1010,9 +1925,23 @@ void MultiplexJob::validate_url_accessibility() {
     }
 };
 void MultiplexJob::load_thread_pool() {
-    int32_t threads(decode_value_by_key< int32_t >("threads", ontology));
-    thread_pool.pool = hts_tpool_init(threads);
-    if(!thread_pool.pool) { throw InternalError("error creating thread pool"); }
+    if(thread_budget != NULL) {
+        thread_pool = thread_budget->thread_pool;
+    } else {
+        int32_t compression_threads(decode_value_by_key< int32_t >("threads", ontology));
+        decode_value_by_key< int32_t >("compression threads", compression_threads, ontology);
+        thread_pool.pool = hts_tpool_init(compression_threads);
+        if(!thread_pool.pool) { throw InternalError("error creating thread pool"); }
+
+        /* without dedicated io threads input decompression shares the compression pool */
+        int32_t io_threads(0);
+        decode_value_by_key< int32_t >("io threads", io_threads, ontology);
+        if(io_threads > 0) {
+            input_thread_pool.pool = hts_tpool_init(io_threads);
+            if(!input_thread_pool.pool) { throw InternalError("error creating input thread pool"); }
+        }
+        decode_value_by_key< bool >("thread balancing", thread_balancing, ontology);
+    }
 };
 void MultiplexJob::load_input() {
     if(input_feed_by_index.empty()) {
@@ -1022,8 +1951,15 @@ void MultiplexJob::load_input() {
         */
         list< FeedProxy > feed_proxy_array(decode_value_by_key< list< FeedProxy > >("input feed", ontology));
 
-        /*  Initialized the hfile reference and verify input format */
+        /*  Initialized the hfile reference and verify input format.
+            Regular files are memory mapped or read through an asynchronous read ahead hfile */
+        int32_t read_ahead(0);
+        decode_value_by_key< int32_t >("read ahead", read_ahead, ontology);
+        bool memory_map(false);
+        decode_value_by_key< bool >("memory map", memory_map, ontology);
         for(auto& proxy : feed_proxy_array) {
+            proxy.read_ahead = read_ahead;
+            proxy.memory_map = memory_map;
             proxy.probe();
         };
 
@@ -1031,26 +1967,8 @@ void MultiplexJob::load_input() {
             Populate input_feed_by_index used to enumerate threaded access to the input feeds */
         unordered_map< URL, Feed* > feed_by_url(feed_proxy_array.size());
         for(auto& proxy : feed_proxy_array) {
-            Feed* feed(NULL);
-            switch(proxy.kind()) {
-                case FormatKind::FASTQ: {
-                    feed = new FastqFeed(proxy);
-                    break;
-                };
-                case FormatKind::HTS: {
-                    feed = new HtsFeed(proxy);
-                    break;
-                };
-                case FormatKind::DEV_NULL: {
-                    feed = new NullFeed(proxy);
-                    break;
-                };
-                default: {
-                    throw InternalError("unknown input format " + string(proxy.url));
-                    break;
-                };
-            }
-            feed->set_thread_pool(&thread_pool);
+            Feed* feed(construct_feed(proxy, static_cast< int32_t >(input_feed_by_index.size())));
+            feed->set_thread_pool(input_thread_pool.pool != NULL ? &input_thread_pool : &thread_pool);
             input_feed_by_index.push_back(feed);
             feed_by_url.emplace(make_pair(proxy.url, feed));
         }
@@ -1075,6 +1993,17 @@ void MultiplexJob::load_output() {
         and contains only unique url references
     */
     list< FeedProxy > feed_proxy_array(decode_value_by_key< list< FeedProxy > >("output feed", ontology));
+
+    /*  A census job only counts and must not open, let alone truncate, the output files */
+    if(census) {
+        output_feed_by_url.reserve(feed_proxy_array.size());
+        for(auto& proxy : feed_proxy_array) {
+            Feed* feed(new NullFeed(proxy));
+            output_feed_by_index.push_back(feed);
+            output_feed_by_url.emplace(make_pair(proxy.url, feed));
+        }
+        return;
+    }
     HeadPGAtom program(decode_value_by_key< HeadPGAtom >("program", ontology));
 
     /*  Register the read group elements on the feed proxy so it can be added to SAM header
@@ -1115,6 +2044,62 @@ void MultiplexJob::load_output() {
         }
     }
 
+    /*  Output written after the last checkpoint is truncated when the hfile is initialized */
+    if(checkpoint_interval > 0) {
+        for(auto& proxy : feed_proxy_array) {
+            if(!proxy.is_dev_null()) {
+                if(proxy.is_stdout() || proxy.url.type() == FormatType::CRAM || proxy.grouping != RecordGrouping::NONE) {
+                    throw ConfigurationError("checkpoints require SAM, BAM or FASTQ output to a file without grouping but " + string(proxy.url) + " is not");
+                }
+            }
+        }
+        if(resume_state.IsObject()) {
+            const Value& output(find_value_by_key("output", resume_state));
+            for(auto& proxy : feed_proxy_array) {
+                for(const auto& element : output.GetArray()) {
+                    if(decode_value_by_key< URL >("url", element) == proxy.url) {
+                        decode_value_by_key< int64_t >("offset", proxy.resume_offset, element);
+                        break;
+                    }
+                }
+                if(proxy.resume_offset < 0) {
+                    throw ConfigurationError("checkpoint " + string(checkpoint_url) + " has no offset for " + string(proxy.url));
+                }
+            }
+        }
+    }
+
+    /*  Output files may be written through a writer shared by all output feeds
+        that batches the writes to many files into fewer system calls */
+    WriterBackend output_writer(WriterBackend::STANDARD);
+    decode_value_by_key< WriterBackend >("output writer", output_writer, ontology);
+    if(output_writer != WriterBackend::STANDARD) {
+        int32_t writer_threads(BATCH_WRITER_THREADS);
+        decode_value_by_key< int32_t >("writer threads", writer_threads, ontology);
+        writer = new BatchWriter(output_writer, writer_threads);
+        for(auto& proxy : feed_proxy_array) {
+            proxy.writer = writer;
+        }
+    }
+
+    /*  zstd output is compressed by worker threads of its own rather than by the compression pool,
+        the pool's threads are divided between the zstd outputs so they add no threads to the run.
+        With more zstd outputs than pool threads each output compresses on its own feed thread */
+    int32_t zstd_output_count(0);
+    for(const auto& proxy : feed_proxy_array) {
+        if(!proxy.is_dev_null() && proxy.url.compression() == "zst") {
+            ++zstd_output_count;
+        }
+    }
+    if(zstd_output_count > 0 && thread_pool.pool != NULL) {
+        const int32_t compression_workers(hts_tpool_size(thread_pool.pool) / zstd_output_count);
+        for(auto& proxy : feed_proxy_array) {
+            if(!proxy.is_dev_null() && proxy.url.compression() == "zst") {
+                proxy.compression_workers = compression_workers;
+            }
+        }
+    }
+
     /*  Initialized the hfile reference */
     for(auto& proxy : feed_proxy_array) {
         proxy.probe();
@@ -1124,36 +2109,409 @@ void MultiplexJob::load_output() {
         Populate output_feed_by_index used to enumerate threaded access to the output feeds */
     output_feed_by_url.reserve(feed_proxy_array.size());
     for(auto& proxy : feed_proxy_array) {
-            Feed* feed(NULL);
-            switch(proxy.kind()) {
-                case FormatKind::FASTQ: {
-                    feed = new FastqFeed(proxy);
-                    break;
-                };
-                case FormatKind::HTS: {
-                    feed = new HtsFeed(proxy);
-                    break;
-                };
-                case FormatKind::DEV_NULL: {
-                    feed = new NullFeed(proxy);
-                    break;
-                };
-                default: {
-                    throw InternalError("unknown output format " + string(proxy.url));
-                    break;
-                };
-            }
+            Feed* feed(construct_feed(proxy, static_cast< int32_t >(input_feed_by_index.size() + output_feed_by_index.size())));
             feed->set_thread_pool(&thread_pool);
             output_feed_by_index.push_back(feed);
             output_feed_by_url.emplace(make_pair(proxy.url, feed));
     }
 };
+void MultiplexJob::load_pass_through() {
+    /*  records are forwarded to the output without being decoded or encoded when the pipe decoder is the only decoder,
+        nothing reads the decoded segments because quality control is disabled and no trace is written,
+        every input segment is copied whole to the output segment at the same position
+        and every output file has the format and Phred offset of the input it mirrors */
+    pass_through = false;
+    Value::ConstMemberIterator multiplex = ontology.FindMember("multiplex");
+    if(multiplex == ontology.MemberEnd() || decode_value_by_key< Algorithm >("algorithm", multiplex->value) != Algorithm::PIPE) {
+        return;
+    }
+    if(!decode_value_by_key< bool >("disable quality control", ontology) ||
+       !decode_value_by_key< bool >("disable quality control", find_value_by_key("undetermined", multiplex->value)) ||
+       ontology.HasMember("trace url")) {
+        return;
+    }
+    for(const auto& key : { "molecular", "cellular" }) {
+        Value::ConstMemberIterator reference = ontology.FindMember(key);
+        if(reference != ontology.MemberEnd() && !reference->value.IsNull() && !(reference->value.IsArray() && reference->value.Empty())) {
+            return;
+        }
+    }
+    const TemplateRule template_rule(decode_value_by_key< Rule >("transform", ontology));
+    if(!template_rule.identity(static_cast< int32_t >(input_feed_by_segment.size()))) {
+        return;
+    }
+    list< URL > output(decode_value_by_key< list< URL > >("output", find_value_by_key("undetermined", multiplex->value)));
+    if(output.size() != input_feed_by_segment.size()) {
+        return;
+    }
+    int32_t index(0);
+    for(const auto& url : output) {
+        const Feed* input(input_feed_by_segment[index]);
+        const Feed* feed(output_feed_by_url.at(url));
+        if(input->url.is_synthetic()) {
+            return;
+        }
+        if(!feed->url.is_dev_null()) {
+            if((input->url.type() == FormatType::FASTQ) != (feed->url.type() == FormatType::FASTQ)) {
+                return;
+            }
+            if(feed->url.type() == FormatType::FASTQ && input->phred_offset != feed->phred_offset) {
+                return;
+            }
+        }
+        ++index;
+    }
+    pass_through = true;
+    for(auto feed : input_feed_by_index) {
+        feed->set_forwarding(true);
+    }
+};
+void MultiplexJob::load_tag_augmentation() {
+    /*  input records are forwarded to the output, decoders read their packed sequence,
+        and unmapped records are written with only the new auxiliary tags appended
+        when every input segment is copied whole to the output segment at the same position
+        and every input and output file is SAM, BAM or CRAM */
+    tag_augmentation = false;
+    if(pass_through || census) {
+        return;
+    }
+    const TemplateRule template_rule(decode_value_by_key< Rule >("transform", ontology));
+    if(!template_rule.identity(static_cast< int32_t >(input_feed_by_segment.size()))) {
+        return;
+    }
+    for(const auto feed : input_feed_by_index) {
+        if(!is_hts_format(feed->url)) {
+            return;
+        }
+    }
+    for(const auto& record : output_feed_by_url) {
+        if(!record.first.is_dev_null() && !is_hts_format(record.first)) {
+            return;
+        }
+    }
+    tag_augmentation = true;
+    for(auto feed : input_feed_by_index) {
+        feed->set_forwarding(true);
+        feed->set_tag_augmentation(true);
+    }
+    for(auto& record : output_feed_by_url) {
+        record.second->set_tag_augmentation(true);
+    }
+};
+void MultiplexJob::load_progress() {
+    decode_value_by_key< int32_t >("progress interval", progress_interval, ontology);
+    if(progress_interval > 0) {
+        URL url;
+        if(decode_value_by_key< URL >("progress url", url, ontology) && !url.is_stderr()) {
+            if(url.is_writable()) {
+                progress_file.open(url.path(), ios_base::out | ios_base::trunc);
+            }
+            if(!progress_file.is_open()) {
+                throw IOError("could not open " + string(url) + " for writing");
+            }
+        }
+    }
+};
+void MultiplexJob::load_trace() {
+    URL url;
+    if(decode_value_by_key< URL >("trace url", url, ontology)) {
+        trace = new TraceSink(url);
+        trace->open();
+    }
+};
+void MultiplexJob::load_checkpoint() {
+    if(decode_value_by_key< URL >("checkpoint url", checkpoint_url, ontology)) {
+        checkpoint_interval = DEFAULT_CHECKPOINT_INTERVAL;
+        decode_value_by_key< int32_t >("checkpoint interval", checkpoint_interval, ontology);
+        if(ontology.HasMember("trace url")) {
+            throw ConfigurationError("checkpoints can not be combined with a decoding trace");
+        }
+        if(!cluster_table_by_index.empty()) {
+            throw ConfigurationError("checkpoints can not be combined with directional molecular decoding");
+        }
+
+        /* every checkpoint records where the next read starts in every input file */
+        for(auto feed : input_feed_by_index) {
+            feed->set_position_tracking(true);
+        }
+
+        /*  a run preempted before its first checkpoint simply starts over */
+        if(decode_value_by_key< bool >("resume", ontology) && checkpoint_url.is_readable()) {
+            ifstream file(checkpoint_url.path());
+            const string content((istreambuf_iterator< char >(file)), istreambuf_iterator< char >());
+            file.close();
+
+            if(!resume_state.Parse(content.c_str()).HasParseError() && resume_state.IsObject()) {
+                list< URL > input;
+                for(const auto feed : input_feed_by_index) {
+                    input.emplace_back(feed->url);
+                }
+                if(decode_value_by_key< list< URL > >("input", resume_state) != input) {
+                    throw ConfigurationError("checkpoint " + string(checkpoint_url) + " was written for a different input");
+                }
+                decode_value_by_key< uint64_t >("ordinal", resume_ordinal, resume_state);
+
+                /*  seek every input to the next read when the checkpoint recorded where it starts,
+                    otherwise the reads processed before the checkpoint are read again and discarded */
+                Value::ConstMemberIterator reference = resume_state.FindMember("input position");
+                if(reference != resume_state.MemberEnd() && reference->value.IsArray() && reference->value.Size() == input_feed_by_index.size()) {
+                    auto element = reference->value.Begin();
+                    for(auto feed : input_feed_by_index) {
+                        FeedPosition position({ -2, 0, 0 });
+                        decode_value_by_key< int64_t >("offset", position.offset, *element);
+                        decode_value_by_key< int64_t >("skip", position.skip, *element);
+                        decode_value_by_key< int64_t >("consumed", position.consumed, *element);
+                        if(position.offset < -1 || position.skip < 0) {
+                            throw ConfigurationError("checkpoint " + string(checkpoint_url) + " is corrupt");
+                        }
+                        feed->set_resume_position(position);
+                        ++element;
+                    }
+                    resume_by_seek = true;
+                }
+            } else { throw ConfigurationError("checkpoint " + string(checkpoint_url) + " is corrupt"); }
+        }
+    }
+};
+void MultiplexJob::load_codec_index() {
+    /* every pivot decodes against the same read only mapping */
+    Value::ConstMemberIterator reference = ontology.FindMember("cellular");
+    if(reference != ontology.MemberEnd() && !reference->value.IsNull()) {
+        URL url;
+        auto map_index = [&](const Value& decoder) {
+            if(!decoder.HasMember("codec") && decode_value_by_key< URL >("codec index url", url, decoder)) {
+                if(codec_index_by_url.find(url) == codec_index_by_url.end()) {
+                    codec_index_by_url.emplace(make_pair(url, new CodecIndex(url)));
+                }
+            }
+        };
+        if(reference->value.IsObject()) {
+            map_index(reference->value);
+        } else if(reference->value.IsArray()) {
+            for(const auto& element : reference->value.GetArray()) {
+                map_index(element);
+            }
+        }
+    }
+};
+void MultiplexJob::load_census() {
+    /*  a census only reads the segments decoders extract barcodes from,
+        so feeds that carry none of them are read without decoding their records */
+    if(!census) {
+        return;
+    }
+    vector< bool > referenced(input_feed_by_segment.size(), false);
+    for(const auto& key : { "multiplex", "molecular", "cellular" }) {
+        Value::ConstMemberIterator reference = ontology.FindMember(key);
+        if(reference != ontology.MemberEnd()) {
+            list< const Value* > decoder_array;
+            if(reference->value.IsObject()) {
+                decoder_array.push_back(&reference->value);
+            } else if(reference->value.IsArray()) {
+                for(const auto& element : reference->value.GetArray()) {
+                    decoder_array.push_back(&element);
+                }
+            }
+            for(const auto decoder : decoder_array) {
+                if(decoder->HasMember("transform")) {
+                    const Rule rule(decode_value_by_key< Rule >("transform", *decoder));
+                    for(const auto& token : rule.token_array) {
+                        referenced[token.input_segment_index] = true;
+                    }
+                }
+            }
+        }
+    }
+    for(auto feed : input_feed_by_index) {
+        bool decoded(false);
+        for(size_t index(0); index < input_feed_by_segment.size(); ++index) {
+            if(input_feed_by_segment[index] == feed && referenced[index]) {
+                decoded = true;
+                break;
+            }
+        }
+        if(!decoded) {
+            feed->set_forwarding(true);
+        }
+    }
+};
+void MultiplexJob::load_cluster_table() {
+    /* directional molecular decoders in all pivots count into the same table */
+    if(!cluster_table_by_index.empty()) {
+        return;
+    }
+    Value::ConstMemberIterator reference = ontology.FindMember("molecular");
+    if(reference != ontology.MemberEnd() && !reference->value.IsNull()) {
+        auto create_table = [&](const Value& decoder) {
+            if(decode_value_by_key< Algorithm >("algorithm", decoder) == Algorithm::DIRECTIONAL) {
+                int32_t index(decode_value_by_key< int32_t >("index", decoder));
+                cluster_table_by_index.emplace(make_pair(index, new DirectionalClusterTable(decoder)));
+            }
+        };
+        if(reference->value.IsObject()) {
+            create_table(reference->value);
+        } else if(reference->value.IsArray()) {
+            for(const auto& element : reference->value.GetArray()) {
+                create_table(element);
+            }
+        }
+    }
+};
+void MultiplexJob::compile_codec_index() {
+    int32_t count(0);
+    Value::ConstMemberIterator reference = ontology.FindMember("cellular");
+    if(reference != ontology.MemberEnd() && !reference->value.IsNull()) {
+        URL url;
+        auto write_index = [&](const Value& decoder) {
+            if(decoder.HasMember("codec") && decode_value_by_key< URL >("codec index url", url, decoder)) {
+                CodecIndex::write(url, decoder);
+                ++count;
+            }
+        };
+        if(reference->value.IsObject()) {
+            write_index(reference->value);
+        } else if(reference->value.IsArray()) {
+            for(const auto& element : reference->value.GetArray()) {
+                write_index(element);
+            }
+        }
+    }
+    if(count == 0) {
+        throw ConfigurationError("no cellular decoder declares both a codec and a codec index url");
+    }
+};
+void MultiplexJob::count_molecules() {
+    /*  Directional clusters are assigned only after every molecular barcode in a group has been counted,
+        so a census job first reads the entire input and only decodes the barcodes and counts.
+        This costs a second read of the input but template segments are not decoded, transformed, accumulated or written
+        The frozen tables are then used read only by the directional decoders of this job */
+    list< URL > feed_url_array(decode_value_by_key< list< URL > >("input", ontology));
+    for(const auto& url : feed_url_array) {
+        if(url.is_stdin()) {
+            throw ConfigurationError("directional molecular decoding reads the input twice and can not read from standard input");
+        }
+    }
+
+    Document instruction;
+    instruction.CopyFrom(operation, instruction.GetAllocator());
+    MultiplexJob job(instruction);
+    job.ontology.CopyFrom(ontology, job.ontology.GetAllocator());
+    job.ontology.RemoveMember("progress url");
+    job.ontology.RemoveMember("trace url");
+    job.ontology.RemoveMember("checkpoint url");
+    job.ontology.RemoveMember("output writer");
+    encode_key_value("resume", false, job.ontology, job.ontology);
+    job.census = true;
+    job.load();
+    job.start();
+    job.stop();
+
+    for(auto& record : job.cluster_table_by_index) {
+        record.second->freeze();
+    }
+    cluster_table_by_index.swap(job.cluster_table_by_index);
+};
 void MultiplexJob::load_pivot() {
-    int32_t threads(decode_value_by_key< int32_t >("threads", ontology));
+    int32_t threads(0);
+    if(thread_budget != NULL) {
+        threads = leased_threads.load();
+    } else {
+        threads = decode_value_by_key< int32_t >("threads", ontology);
+        maximum_pivot_count = threads;
+        if(decode_value_by_key< int32_t >("decoding threads", threads, ontology)) {
+            maximum_pivot_count = max(maximum_pivot_count, threads);
+        } else if(thread_balancing) {
+            /* start with half the threads and let balancing decide */
+            threads = max(1, threads / 2);
+        }
+    }
     for(int32_t index(0); index < threads; ++index) {
-        pivot_array.emplace_back(*this, index);
+        emplace_pivot();
+    }
+};
+void MultiplexJob::load_shard() {
+    if(decode_shard(shard_index, shard_count) && shard_count > 1) {
+        /*  the first input feed decides where shard boundaries fall */
+        for(auto feed : input_feed_by_index) {
+            shard_file_array.emplace_back(feed->url, feed->resolution());
+        }
+        locate_shard(shard_index, shard_count, shard_file_array);
+
+        auto file = shard_file_array.begin();
+        for(auto feed : input_feed_by_index) {
+            feed->set_shard(file->begin, file->end, file->length);
+            ++file;
+        }
     }
 };
+bool MultiplexJob::decode_shard(int32_t& index, int32_t& count) const {
+    string buffer;
+    if(decode_value_by_key< string >("shard", buffer, ontology)) {
+        if(!parse_shard(buffer, index, count)) {
+            throw ConfigurationError("shard must be written i/N with 1 <= i <= N but is " + buffer);
+        }
+        return true;
+    }
+    return false;
+};
+void MultiplexJob::load_numa() {
+    bool enabled(false);
+    decode_value_by_key< bool >("numa", enabled, ontology);
+    if(enabled) {
+        numa = new NumaTopology();
+    }
+};
+Feed* MultiplexJob::construct_feed(const FeedProxy& proxy, const int32_t& ordinal) {
+    /*  In NUMA mode feeds are spread over the nodes the same way pivots are.
+        The feed is constructed while the calling thread is bound to its node
+        so the records in its buffers are first touched, and so allocated, on that node,
+        and the feed thread is bound to the same node when it starts */
+    if(numa != NULL) {
+        numa->bind_to_node(ordinal);
+    }
+    Feed* feed(NULL);
+    try {
+        switch(proxy.kind()) {
+            case FormatKind::FASTQ: {
+                feed = new FastqFeed(proxy);
+                break;
+            };
+            case FormatKind::HTS: {
+                feed = new HtsFeed(proxy);
+                break;
+            };
+            case FormatKind::DEV_NULL: {
+                feed = new NullFeed(proxy);
+                break;
+            };
+            case FormatKind::SYNTHETIC: {
+                if(proxy.direction == IoDirection::OUT) {
+                    throw ConfigurationError("can not use " + string(proxy.url) + " for output");
+                }
+                /*  synthetic templates are generated whole so the feed must provide every input segment */
+                if(proxy.resolution != decode_value_by_key< int32_t >("input segment cardinality", ontology)) {
+                    throw ConfigurationError("synthetic input can not be mixed with other input");
+                }
+                feed = new SyntheticFeed(proxy, ontology);
+                break;
+            };
+            default: {
+                throw InternalError("unknown " + string(proxy.direction == IoDirection::IN ? "input" : "output") + " format " + string(proxy.url));
+                break;
+            };
+        }
+    } catch(...) {
+        if(numa != NULL) {
+            numa->restore();
+        }
+        throw;
+    }
+    if(numa != NULL) {
+        numa->restore();
+        feed->set_cpu_affinity(numa->node_of(ordinal).cpu_array);
+    }
+    return feed;
+};
 void MultiplexJob::populate_channel(Channel& channel) {
     map< int32_t, Feed* > feed_by_index;
     channel.output_feed_by_segment.reserve(channel.output_feed_url_by_segment.size());
@@ -1219,6 +2577,49 @@ void MultiplexJob::print_global_instruction(ostream& o) const {
     int32_t threads;
     decode_value_by_key< int32_t >("threads", threads, ontology);
     o << "    Threads                                     " << to_string(threads) << endl;
+    if(decode_value_by_key< int32_t >("decoding threads", threads, ontology)) {
+        o << "    Decoding threads                            " << to_string(threads) << endl;
+    }
+    if(decode_value_by_key< int32_t >("compression threads", threads, ontology)) {
+        o << "    Compression threads                         " << to_string(threads) << endl;
+    }
+    if(decode_value_by_key< int32_t >("io threads", threads, ontology)) {
+        o << "    IO threads                                  " << to_string(threads) << endl;
+    }
+    int32_t read_ahead;
+    if(decode_value_by_key< int32_t >("read ahead", read_ahead, ontology) && read_ahead > 0) {
+        o << "    Input read ahead                            " << to_string(read_ahead) << "MiB x " << to_string(READ_AHEAD_DEPTH) << endl;
+    }
+    if(decode_value_by_key< bool >("memory map", ontology)) {
+        o << "    Memory mapped input                         " << "enabled" << endl;
+    }
+    WriterBackend output_writer(WriterBackend::STANDARD);
+    if(decode_value_by_key< WriterBackend >("output writer", output_writer, ontology) && output_writer != WriterBackend::STANDARD) {
+        o << "    Output writer                               " << output_writer << endl;
+        if(decode_value_by_key< int32_t >("writer threads", threads, ontology)) {
+            o << "    Writer threads                              " << to_string(threads) << endl;
+        }
+    }
+    int32_t compression_level;
+    if(decode_value_by_key< int32_t >("compression level", compression_level, ontology)) {
+        o << "    Output compression level                    " << to_string(compression_level) << endl;
+    }
+    list< string > cram_option;
+    if(decode_value_by_key< list< string > >("cram option", cram_option, ontology)) {
+        for(const auto& option : cram_option) {
+            o << "    CRAM option                                 " << option << endl;
+        }
+    }
+    string shard;
+    if(decode_value_by_key< string >("shard", shard, ontology)) {
+        o << "    Shard                                       " << shard << endl;
+    }
+    URL checkpoint;
+    if(decode_value_by_key< URL >("checkpoint url", checkpoint, ontology)) {
+        int32_t interval(DEFAULT_CHECKPOINT_INTERVAL);
+        decode_value_by_key< int32_t >("checkpoint interval", interval, ontology);
+        o << "    Checkpoint                                  " << checkpoint << " every " << interval << " seconds" << endl;
+    }
     o << endl;
 };
 void MultiplexJob::print_codec_group_instruction(const Value::Ch* key, const string& head, ostream& o) const {
@@ -1484,6 +2885,7 @@ void MultiplexJob::print_cellular_instruction(ostream& o) const {
 
 MultiplexPivot::MultiplexPivot(MultiplexJob& job, const int32_t& index) try :
     index(index),
+    placement(index),
     platform(decode_value_by_key< Platform >("platform", job.ontology)),
     leading_segment_index(decode_value_by_key< int32_t >("leading segment index", job.ontology)),
     input_segment_cardinality(decode_value_by_key< int32_t >("input segment cardinality", job.ontology)),
@@ -1495,8 +2897,21 @@ MultiplexPivot::MultiplexPivot(MultiplexJob& job, const int32_t& index) try :
     output_accumulator(find_value_by_key("multiplex", job.ontology)),
     job(job),
     disable_quality_control(decode_value_by_key< bool >("disable quality control", job.ontology)),
-    template_rule(decode_value_by_key< Rule >("transform", job.ontology)) {
-
+    template_rule(decode_value_by_key< Rule >("transform", job.ontology)),
+    cellular_first(!job.cluster_table_by_index.empty()),
+    pass_through(job.pass_through),
+    tag_augmentation(job.tag_augmentation),
+    census(job.census),
+    measure_wait_time(job.progress_interval > 0 || job.thread_balancing),
+    _count(0),
+    _wait_time(0),
+    _forwarded_count(0),
+    _retired(false),
+    ordinal(0) {
+
+    if(job.trace != NULL) {
+        trace_buffer.reserve(TRACE_BUFFER_CAPACITY);
+    }
     load_multiplex_decoding();
     load_molecular_decoding();
     load_cellular_decoding();
@@ -1516,8 +2931,11 @@ void MultiplexPivot::load_multiplex_decoding() {
             case Algorithm::PAMLD: {
                 MultiplexPAMLDecoder* pamld_decoder(new MultiplexPAMLDecoder(reference->value));
                 pamld_decoder->unclassified.populate(job.output_feed_by_url);
+                channel_by_index.reserve(pamld_decoder->element_by_index.size() + 1);
+                channel_by_index.push_back(&pamld_decoder->unclassified);
                 for(auto& channel : pamld_decoder->element_by_index) {
                     channel.populate(job.output_feed_by_url);
+                    channel_by_index.push_back(&channel);
                 }
                 multiplex = pamld_decoder;
                 break;
@@ -1525,8 +2943,11 @@ void MultiplexPivot::load_multiplex_decoding() {
             case Algorithm::MDD: {
                 MultiplexMDDecoder* mdd_decoder(new MultiplexMDDecoder(reference->value));
                 mdd_decoder->unclassified.populate(job.output_feed_by_url);
+                channel_by_index.reserve(mdd_decoder->element_by_index.size() + 1);
+                channel_by_index.push_back(&mdd_decoder->unclassified);
                 for(auto& channel : mdd_decoder->element_by_index) {
                     channel.populate(job.output_feed_by_url);
+                    channel_by_index.push_back(&channel);
                 }
                 multiplex = mdd_decoder;
                 break;
@@ -1534,6 +2955,7 @@ void MultiplexPivot::load_multiplex_decoding() {
             case Algorithm::PIPE: {
                 PipeDecoder< Channel >* pipe_decoder(new PipeDecoder< Channel >(reference->value));
                 pipe_decoder->unclassified.populate(job.output_feed_by_url);
+                channel_by_index.push_back(&pipe_decoder->unclassified);
                 multiplex = pipe_decoder;
                 break;
             };
@@ -1567,6 +2989,22 @@ void MultiplexPivot::load_molecular_decoder(const Value& value) {
             molecular.emplace_back(naive_decoder);
             break;
         };
+        case Algorithm::MDD: {
+            MolecularMDDecoder* md_decoder(new MolecularMDDecoder(value));
+            molecular.emplace_back(md_decoder);
+            break;
+        };
+        case Algorithm::PAMLD: {
+            MolecularPAMLDecoder* paml_decoder(new MolecularPAMLDecoder(value));
+            molecular.emplace_back(paml_decoder);
+            break;
+        };
+        case Algorithm::DIRECTIONAL: {
+            DirectionalClusterTable& table(*job.cluster_table_by_index.at(decode_value_by_key< int32_t >("index", value)));
+            MolecularDirectionalDecoder* directional_decoder(new MolecularDirectionalDecoder(value, table));
+            molecular.emplace_back(directional_decoder);
+            break;
+        };
         default:
             break;
     }
@@ -1589,6 +3027,25 @@ void MultiplexPivot::load_cellular_decoding() {
 };
 void MultiplexPivot::load_cellular_decoder(const Value& value) {
     Algorithm algorithm(decode_value_by_key< Algorithm >("algorithm", value));
+
+    URL url;
+    if(!value.HasMember("codec") && decode_value_by_key< URL >("codec index url", url, value)) {
+        const CodecIndex& index(*job.codec_index_by_url.at(url));
+        switch (algorithm) {
+            case Algorithm::PAMLD: {
+                cellular.emplace_back(new CellularIndexPAMLDecoder(value, index));
+                break;
+            };
+            case Algorithm::MDD: {
+                cellular.emplace_back(new CellularIndexMDDecoder(value, index));
+                break;
+            };
+            default:
+                break;
+        }
+        return;
+    }
+
     switch (algorithm) {
         case Algorithm::PAMLD: {
             CellularPAMLDecoder* paml_decoder(new CellularPAMLDecoder(value));
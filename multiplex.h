@@ -27,12 +27,21 @@
 #include "accumulate.h"
 #include "fastq.h"
 #include "hts.h"
+#include "synthetic.h"
+#include "trace.h"
+#include "shard.h"
 #include "decoder.h"
 #include "metric.h"
 
 class MultiplexJob;
 class MultiplexPivot;
 
+/*  Seconds from the start of decoding during which decoding threads are balanced */
+const int32_t THREAD_BALANCING_PERIOD(10);
+
+/*  Seconds between checkpoints when a checkpoint url is declared without an interval */
+const int32_t DEFAULT_CHECKPOINT_INTERVAL(600);
+
 class MultiplexJob : public Job {
     friend class MultiplexPivot;
     MultiplexJob(MultiplexJob const &) = delete;
@@ -49,29 +58,77 @@ class MultiplexJob : public Job {
         void stop();
         void execute() override;
         void describe(ostream& o) const override;
-        bool pull(Read& read);
+        bool pull(Read& read, uint64_t& ordinal);
         void print_compiled(ostream& o) const override;
+        void compile_codec_index() override;
 
     protected:
         const Pointer decoder_repository_query;
 
+        bool is_accepting_threads() const override {
+            return !end_of_input && running_pivot_count > 0;
+        };
         void manipulate() override;
+        void fingerprint_input(string& fingerprint) const override;
         void validate() override;
 
     private:
-        bool end_of_input;
+        atomic< bool > end_of_input;
+        uint64_t input_ordinal;
         htsThreadPool thread_pool;
+        htsThreadPool input_thread_pool;
+        bool thread_balancing;
+        int32_t maximum_pivot_count;
+        NumaTopology* numa;
+        double decoding_time;
         list< MultiplexPivot > pivot_array;
+        mutex pivot_mutex;
+        atomic< int32_t > running_pivot_count;
         list< Feed* > input_feed_by_index;
         list< Feed* > output_feed_by_index;
+        int32_t shard_index;
+        int32_t shard_count;
+        vector< ShardFile > shard_file_array;
         vector< Feed* > input_feed_by_segment;
         unordered_map< URL, Feed* > output_feed_by_url;
+        int32_t progress_interval;
+        bool progress_complete;
+        thread progress_thread;
+        mutex progress_mutex;
+        condition_variable progress_interrupt;
+        ofstream progress_file;
+        TraceSink* trace;
+        BatchWriter* writer;
+        bool pass_through;
+        bool tag_augmentation;
+        bool census;
+        URL checkpoint_url;
+        int32_t checkpoint_interval;
+        bool checkpoint_complete;
+        thread checkpoint_thread;
+        mutex checkpoint_mutex;
+        condition_variable checkpoint_interrupt;
+        condition_variable checkpoint_paused;
+        condition_variable checkpoint_released;
+        atomic< bool > checkpoint_pending;
+        int32_t paused_pivot_count;
+        int32_t checkpoint_count;
+        double checkpoint_time;
+        uint64_t resume_ordinal;
+        bool resume_by_seek;
+        exception_ptr checkpoint_error;
+        Document resume_state;
+        unordered_map< URL, CodecIndex* > codec_index_by_url;
+        map< int32_t, DirectionalClusterTable* > cluster_table_by_index;
         void compile_PG();
         void compile_input();
         void detect_input();
         void compile_decoder(Value& value, int32_t& index, const Value& default_decoder, const Value& default_barcode);
         void compile_decoder_group(const Value::Ch* key);
         void compile_output();
+        void compile_progress();
+        void compile_trace();
+        void compile_checkpoint();
         void compile_output_transformation();
         void compile_transformation(Value& value);
         void compile_codec(Value& value, const Value& default_decoder, const Value& default_barcode);
@@ -79,17 +136,48 @@ class MultiplexJob : public Job {
         bool infer_PU(const Value::Ch* key, string& buffer, Value& container, const bool& undetermined=false);
         bool infer_ID(const Value::Ch* key, string& buffer, Value& container, const bool& undetermined=false);
         void pad_url_array_by_key(const Value::Ch* key, Value& container, const int32_t& cardinality);
+        bool decode_shard(int32_t& index, int32_t& count) const;
         void cross_validate_io();
         void validate_decoder_group(const Value::Ch* key);
-        void validate_decoder(Value& value);
+        void validate_decoder(const Value::Ch* key, Value& value);
 
         void validate_url_accessibility();
         void load_thread_pool();
         void load_input();
+        void load_shard();
         void load_output();
+        void load_pass_through();
+        void load_tag_augmentation();
+        void load_census();
+        void load_progress();
+        void load_trace();
+        void load_checkpoint();
+        void load_numa();
+        Feed* construct_feed(const FeedProxy& proxy, const int32_t& ordinal);
+        void load_codec_index();
+        void load_cluster_table();
+        void count_molecules();
         void load_pivot();
+        MultiplexPivot& emplace_pivot();
+        void start_pivot(MultiplexPivot& pivot);
+        void complete_pivot();
+        void balance_pivots();
         void populate_channel(Channel& channel);
         void finalize();
+        void start_progress();
+        void stop_progress();
+        void run_progress();
+        void start_checkpoint();
+        void stop_checkpoint();
+        void run_checkpoint();
+        void write_checkpoint();
+        void pause_pivot();
+        void resume();
+        void encode_progress(const double& elapsed, const double& interval, uint64_t& last_input_count, uint64_t& last_output_count, Value& container, Document& document);
+
+        #if defined(PHENIQS_PROFILE)
+        void encode_profile(Value& container, Document& document) const;
+        #endif
 
         void print_global_instruction(ostream& o) const;
         void print_codec_group_instruction(const Value::Ch* key, const string& head, ostream& o) const;
@@ -109,6 +197,7 @@ class MultiplexPivot {
 
     public:
         const int32_t index;
+        int32_t placement;
         const Platform platform;
         const int32_t leading_segment_index;
         const int32_t input_segment_cardinality;
@@ -120,10 +209,34 @@ class MultiplexPivot {
         vector< Decoder* > cellular;
         InputAccumulator input_accumulator;
         OutputAccumulator output_accumulator;
+        vector< Channel* > channel_by_index;
+
+        #if defined(PHENIQS_PROFILE)
+        PivotProfile profile;
+        #endif
+
         MultiplexPivot(MultiplexJob& job, const int32_t& index);
+        inline uint64_t count() const {
+            return _count.load(memory_order_relaxed);
+        };
+        inline uint64_t forwarded_count() const {
+            return _forwarded_count;
+        };
+        inline uint64_t wait_time() const {
+            return _wait_time.load(memory_order_relaxed);
+        };
         void start() {
             pivot_thread = thread(&MultiplexPivot::run, this);
         };
+        inline void retire() {
+            _retired.store(true, memory_order_relaxed);
+        };
+        inline bool retired() const {
+            return _retired.load(memory_order_relaxed);
+        };
+        inline void set_cpu_affinity(const vector< int32_t >& cpu_array) {
+            cpu_affinity = cpu_array;
+        };
         void join() {
             pivot_thread.join();
         };
@@ -132,36 +245,145 @@ class MultiplexPivot {
         inline void validate() {
             input.validate();
         };
-        inline void transform() {
-            template_rule.apply(input, output);
-            multiplex->decode(input, output);
+        inline void decode_molecular() {
             for(auto& decoder : molecular) {
                 decoder->decode(input, output);
             }
+        };
+        inline void decode_cellular() {
             for(auto& decoder : cellular) {
                 decoder->decode(input, output);
             }
+        };
+        inline void transform() {
+            /*  a census only decodes the barcodes, nothing is accumulated, transformed or written */
+            if(census) {
+                multiplex->decode(input, output);
+                decode_cellular();
+                decode_molecular();
+                return;
+            }
+
+            /*  input statistics are collected before the input records are handed to the output segments */
+            input_accumulator.increment(input);
+
+            /*  the records were not decoded and are handed to the output segments as they were read */
+            if(pass_through) {
+                const bool qcfail(input.qcfail());
+                for(size_t i(0); i < output.segment_cardinality(); ++i) {
+                    output[i].forward(input[i]);
+                    output[i].set_qcfail(qcfail);
+                }
+                output.flush();
+                ++_forwarded_count;
+                return;
+            }
+
+            /*  with tag augmentation the output segments take over the input records after decoding */
+            if(!tag_augmentation) {
+                template_rule.apply(input, output);
+            }
+            multiplex->decode(input, output);
+
+            /* directional molecular decoders group by the cellular barcode so cellular decoding comes first */
+            if(cellular_first) {
+                decode_cellular();
+                decode_molecular();
+            } else {
+                decode_molecular();
+                decode_cellular();
+            }
             output.flush();
+
+            /*  hand the original records to the output segments so the output feeds only append the new auxiliary tags */
+            if(tag_augmentation) {
+                const bool qcfail(input.qcfail());
+                for(size_t i(0); i < output.segment_cardinality(); ++i) {
+                    output[i].forward(input[i]);
+                    output[i].set_qcfail(qcfail);
+                }
+            }
         };
         inline void push() {
-            multiplex->decoded->push(output);
+            if(!census) {
+                multiplex->decoded->push(output);
+            }
         };
         inline void increment() {
-            input_accumulator.increment(input);
+            if(census) {
+                return;
+            }
             output_accumulator.increment(multiplex->decoded->index, output);
+            if(job.trace != NULL) {
+                trace_buffer.emplace_back();
+                trace_buffer.back().encode(ordinal, multiplex->decoded->index, output);
+                if(trace_buffer.size() >= TRACE_BUFFER_CAPACITY) {
+                    job.trace->submit(trace_buffer);
+                }
+            }
+        };
+        inline void flush_trace() {
+            if(job.trace != NULL && !trace_buffer.empty()) {
+                job.trace->submit(trace_buffer);
+            }
         };
         inline void clear() {
             input.clear();
             output.clear();
         };
+        inline bool pull() {
+            if(measure_wait_time) {
+                steady_clock::time_point begin(steady_clock::now());
+                bool pulled(job.pull(input, ordinal));
+                _wait_time.fetch_add(duration_cast< nanoseconds >(steady_clock::now() - begin).count(), memory_order_relaxed);
+                return pulled;
+            } else {
+                return job.pull(input, ordinal);
+            }
+        };
+        /*  profile hooks compile to nothing unless built with PHENIQS_PROFILE */
+        inline void start_profile() {
+            #if defined(PHENIQS_PROFILE)
+            profile_checkpoint = steady_clock::now();
+            #endif
+        };
+        inline void lap_profile(const PivotStage& stage) {
+            #if defined(PHENIQS_PROFILE)
+            const uint64_t elapsed(lap_nanoseconds(profile_checkpoint));
+            switch(stage) {
+                case PivotStage::PULL:      profile.pull += elapsed;        break;
+                case PivotStage::VALIDATE:  profile.validate += elapsed;    break;
+                case PivotStage::TRANSFORM: profile.transform += elapsed;   break;
+                case PivotStage::PUSH:      profile.push += elapsed;        break;
+                case PivotStage::INCREMENT: profile.increment += elapsed;   break;
+            }
+            #endif
+        };
         void run() {
-            while(job.pull(input)) {
+            if(!cpu_affinity.empty()) {
+                bind_current_thread(cpu_affinity);
+            }
+
+            start_profile();
+            while(!retired() && pull()) {
+                lap_profile(PivotStage::PULL);
                 validate();
+                lap_profile(PivotStage::VALIDATE);
                 transform();
-                push();
+                lap_profile(PivotStage::TRANSFORM);
+
+                /* output feeds take over forwarded records so they are accounted for before the push */
                 increment();
+                lap_profile(PivotStage::INCREMENT);
+                push();
                 clear();
+                _count.fetch_add(1, memory_order_relaxed);
+                lap_profile(PivotStage::PUSH);
             }
+            lap_profile(PivotStage::PULL);
+            flush_trace();
+
+            job.complete_pivot();
         };
 
     private:
@@ -169,6 +391,21 @@ class MultiplexPivot {
         thread pivot_thread;
         const bool disable_quality_control;
         const TemplateRule template_rule;
+        const bool cellular_first;
+        const bool pass_through;
+        const bool tag_augmentation;
+        const bool census;
+        const bool measure_wait_time;
+        atomic< uint64_t > _count;
+        atomic< uint64_t > _wait_time;
+        uint64_t _forwarded_count;
+        atomic< bool > _retired;
+        uint64_t ordinal;
+        vector< TraceRecord > trace_buffer;
+        vector< int32_t > cpu_affinity;
+        #if defined(PHENIQS_PROFILE)
+        steady_clock::time_point profile_checkpoint;
+        #endif
         void load_multiplex_decoding();
         void load_molecular_decoding();
         void load_molecular_decoder(const Value& value);
@@ -0,0 +1,147 @@
+/*
+    Pheniqs : PHilology ENcoder wIth Quality Statistics
+    Copyright (C) 2018  Lior Galanti
+    NYU Center for Genetics and System Biology
+
+    Author: Lior Galanti <lior.galanti@nyu.edu>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "numa.h"
+
+static inline vector< int32_t > decode_cpu_list(const string& list) {
+    /* sysfs cpu lists are comma separated ranges, for instance 0-15,32-47 */
+    vector< int32_t > cpu_array;
+    size_t position(0);
+    while(position < list.size()) {
+        size_t end(list.find(',', position));
+        if(end == string::npos) {
+            end = list.size();
+        }
+        const string range(list.substr(position, end - position));
+        if(!range.empty()) {
+            const size_t dash(range.find('-'));
+            try {
+                if(dash == string::npos) {
+                    cpu_array.push_back(stoi(range));
+                } else {
+                    const int32_t first(stoi(range.substr(0, dash)));
+                    const int32_t last(stoi(range.substr(dash + 1)));
+                    for(int32_t cpu(first); cpu <= last; ++cpu) {
+                        cpu_array.push_back(cpu);
+                    }
+                }
+            } catch(invalid_argument& error) {
+            } catch(out_of_range& error) {
+            }
+        }
+        position = end + 1;
+    }
+    return cpu_array;
+};
+static inline vector< int32_t > process_affinity() {
+    vector< int32_t > cpu_array;
+
+    #if defined(__linux__)
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    if(sched_getaffinity(0, sizeof(mask), &mask) == 0) {
+        for(int32_t cpu(0); cpu < CPU_SETSIZE; ++cpu) {
+            if(CPU_ISSET(cpu, &mask)) {
+                cpu_array.push_back(cpu);
+            }
+        }
+    }
+    #endif
+
+    if(cpu_array.empty()) {
+        const int32_t concurrency(max(static_cast< int32_t >(thread::hardware_concurrency()), 1));
+        for(int32_t cpu(0); cpu < concurrency; ++cpu) {
+            cpu_array.push_back(cpu);
+        }
+    }
+    return cpu_array;
+};
+
+bool bind_current_thread(const vector< int32_t >& cpu_array) {
+    #if defined(__linux__)
+    if(!cpu_array.empty()) {
+        cpu_set_t mask;
+        CPU_ZERO(&mask);
+        for(const auto cpu : cpu_array) {
+            if(cpu >= 0 && cpu < CPU_SETSIZE) {
+                CPU_SET(cpu, &mask);
+            }
+        }
+        return pthread_setaffinity_np(pthread_self(), sizeof(mask), &mask) == 0;
+    }
+    #endif
+
+    return false;
+};
+
+NumaNode::NumaNode(const int32_t& index, const vector< int32_t >& cpu_array) :
+    index(index),
+    cpu_array(cpu_array) {
+};
+
+NumaTopology::NumaTopology() :
+    process_cpu_array(process_affinity()) {
+
+    #if defined(__linux__)
+    const set< int32_t > allowed(process_cpu_array.begin(), process_cpu_array.end());
+    set< int32_t > node_index;
+    DIR* directory(opendir("/sys/devices/system/node"));
+    if(directory != NULL) {
+        struct dirent* entry(NULL);
+        while((entry = readdir(directory)) != NULL) {
+            if(!strncmp(entry->d_name, "node", 4) && isdigit(entry->d_name[4])) {
+                node_index.insert(atoi(entry->d_name + 4));
+            }
+        }
+        closedir(directory);
+    }
+    for(const auto index : node_index) {
+        ifstream file("/sys/devices/system/node/node" + to_string(index) + "/cpulist");
+        if(file.is_open()) {
+            string list;
+            getline(file, list);
+            file.close();
+
+            vector< int32_t > cpu_array;
+            for(const auto cpu : decode_cpu_list(list)) {
+                if(allowed.count(cpu) > 0) {
+                    cpu_array.push_back(cpu);
+                }
+            }
+
+            /* nodes with no usable cores, for instance memory only nodes, are skipped */
+            if(!cpu_array.empty()) {
+                node_array.emplace_back(index, cpu_array);
+            }
+        }
+    }
+    #endif
+
+    if(node_array.empty()) {
+        node_array.emplace_back(0, process_cpu_array);
+    }
+};
+void NumaTopology::bind_to_node(const int32_t& ordinal) const {
+    bind_current_thread(node_of(ordinal).cpu_array);
+};
+void NumaTopology::restore() const {
+    bind_current_thread(process_cpu_array);
+};
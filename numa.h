@@ -0,0 +1,77 @@
+/*
+    Pheniqs : PHilology ENcoder wIth Quality Statistics
+    Copyright (C) 2018  Lior Galanti
+    NYU Center for Genetics and System Biology
+
+    Author: Lior Galanti <lior.galanti@nyu.edu>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PHENIQS_NUMA_H
+#define PHENIQS_NUMA_H
+
+#include "include.h"
+
+#if defined(__linux__)
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+/*  NUMA topology discovered from sysfs
+
+    Pheniqs does not link against libnuma. Memory placement relies on the kernel first touch policy
+    that places a page on the node of the thread that first writes to it, so binding a thread to the
+    cores of a node before it allocates is enough to keep its memory local to that node.
+    Only cores in the affinity mask the process was started with are used. On platforms without
+    thread affinity support, or when sysfs is not available, all cores are reported as a single node
+    and binding has no effect.
+*/
+class NumaNode {
+    public:
+        const int32_t index;
+        const vector< int32_t > cpu_array;
+        NumaNode(const int32_t& index, const vector< int32_t >& cpu_array);
+};
+
+class NumaTopology {
+    NumaTopology(NumaTopology const &) = delete;
+    void operator=(NumaTopology const &) = delete;
+
+    public:
+        vector< NumaNode > node_array;
+        NumaTopology();
+        inline int32_t size() const {
+            return static_cast< int32_t >(node_array.size());
+        };
+        /*  consecutive ordinals are spread over the nodes first and then over the cores of each node */
+        inline const NumaNode& node_of(const int32_t& ordinal) const {
+            return node_array[ordinal % node_array.size()];
+        };
+        inline int32_t cpu_of(const int32_t& ordinal) const {
+            const NumaNode& node(node_of(ordinal));
+            return node.cpu_array[(ordinal / size()) % node.cpu_array.size()];
+        };
+        void bind_to_node(const int32_t& ordinal) const;
+        void restore() const;
+
+    private:
+        vector< int32_t > process_cpu_array;
+};
+
+/*  restrict the calling thread to the given cores, returns false if affinity is not supported */
+bool bind_current_thread(const vector< int32_t >& cpu_array);
+
+#endif /* PHENIQS_NUMA_H */
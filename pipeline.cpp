@@ -21,9 +21,112 @@
 
 #include "pipeline.h"
 
+#include <sys/stat.h>
+
+/*  values of the environment variables a serialized instruction references.
+    variables are resolved when the instruction is compiled so they are part of the compile cache key */
+static void fingerprint_environment(const char* content, const size_t& size, string& fingerprint) {
+    size_t position(0);
+    while(position < size) {
+        if(content[position] == '~') {
+            const char* value(getenv("HOME"));
+            fingerprint.append("HOME=");
+            if(value != NULL) {
+                fingerprint.append(value);
+            }
+            fingerprint.push_back('\n');
+            ++position;
+
+        } else if(content[position] == '$' && position + 1 < size && content[position + 1] == '{') {
+            position += 2;
+            const size_t begin(position);
+            while(position < size && content[position] != '}') {
+                ++position;
+            }
+            const string name(content + begin, position - begin);
+            const char* value(getenv(name.c_str()));
+            fingerprint.append(name);
+            fingerprint.push_back('=');
+            if(value != NULL) {
+                fingerprint.append(value);
+            }
+            fingerprint.push_back('\n');
+
+        } else {
+            ++position;
+        }
+    }
+};
+
+/*  create the compile cache directory and its missing parents */
+static void create_cache_directory(const string& path) {
+    if(path.empty()) {
+        throw ConfigurationError("compile cache url must not be empty");
+    }
+    size_t position(0);
+    while(position != string::npos) {
+        position = path.find(PATH_SEPARATOR, position + 1);
+        const string directory(path.substr(0, position));
+        if(mkdir(directory.c_str(), 0777) != 0 && errno != EEXIST) {
+            throw IOError("failed to create compile cache directory " + directory + " : " + string(strerror(errno)));
+        }
+    }
+    struct stat status;
+    if(stat(path.c_str(), &status) != 0 || !S_ISDIR(status.st_mode)) {
+        throw IOError("compile cache url " + path + " is not a directory");
+    }
+    if(access(path.c_str(), W_OK | X_OK) != 0) {
+        throw IOError("insufficient permission to write to compile cache directory " + path);
+    }
+};
+
+ThreadBudget::ThreadBudget(const int32_t& capacity) try :
+    capacity(max(capacity, 1)),
+    thread_pool({NULL, 0}),
+    available(this->capacity),
+    waiting(0),
+    placement(0) {
+
+    thread_pool.pool = hts_tpool_init(this->capacity);
+    if(!thread_pool.pool) { throw InternalError("error creating thread pool"); }
+
+    } catch(ConfigurationError& error) {
+        throw ConfigurationError("ThreadBudget :: " + error.message);
+
+    } catch(exception& error) {
+        throw InternalError("ThreadBudget :: " + string(error.what()));
+};
+ThreadBudget::~ThreadBudget() {
+    if(thread_pool.pool != NULL) {
+        hts_tpool_destroy(thread_pool.pool);
+        thread_pool.pool = NULL;
+    }
+};
+int32_t ThreadBudget::acquire(const int32_t& maximum) {
+    unique_lock< mutex > budget_lock(budget_mutex);
+    ++waiting;
+    budget_changed.wait(budget_lock, [this]() { return available > 0; });
+    --waiting;
+    int32_t granted(min(available, max(maximum, 1)));
+    available -= granted;
+
+    /* jobs waiting to grow may proceed once no job is waiting for an initial share */
+    budget_changed.notify_all();
+    return granted;
+};
+void ThreadBudget::release(const int32_t& count) {
+    if(count > 0) {
+        lock_guard< mutex > budget_lock(budget_mutex);
+        available += count;
+        budget_changed.notify_all();
+    }
+};
+
 Job::Job(Document& operation) try :
     operation(move(operation)),
     report(kObjectType),
+    thread_budget(NULL),
+    leased_threads(0),
     projection_query("/projection") {
 
     } catch(ConfigurationError& error) {
@@ -32,6 +135,30 @@ Job::Job(Document& operation) try :
     } catch(exception& error) {
         throw InternalError("Job :: " + string(error.what()));
 };
+void Job::lease_threads(ThreadBudget* budget, const int32_t& count) {
+    thread_budget = budget;
+    leased_threads = count;
+};
+void Job::return_threads() {
+    if(thread_budget != NULL) {
+        thread_budget->release(leased_threads.exchange(0));
+    }
+};
+bool Job::lease_additional_thread() {
+    if(thread_budget != NULL) {
+        if(thread_budget->acquire_unless([this]() { return !is_accepting_threads(); })) {
+            leased_threads.fetch_add(1);
+            return true;
+        }
+    }
+    return false;
+};
+void Job::release_thread() {
+    if(thread_budget != NULL) {
+        leased_threads.fetch_sub(1);
+        thread_budget->release(1);
+    }
+};
 void Job::clean() {
     clean_json_value(ontology, ontology);
     sort_json_value(ontology, ontology);
@@ -60,11 +187,86 @@ void Job::assemble() {
     clean();
 };
 void Job::compile() {
+    URL cache_url;
+    if(decode_value_by_key< URL >("compile cache url", cache_url, ontology)) {
+        cache_url.expand();
+        compile_with_cache(cache_url.path());
+    } else {
+        compile_ontology();
+    }
+};
+void Job::compile_ontology() {
     manipulate();
     remove_disabled();
     clean();
     validate();
 };
+void Job::compile_with_cache(const string& cache_directory) {
+    /*  The assembled ontology already contains the instruction with all imports merged,
+        the command line, the working directory and the application version.
+        Together with the environment variables it references and the identity of the input files
+        compilation probes it is a complete description of the compilation input */
+    create_cache_directory(cache_directory);
+    const string key(hash_ontology());
+    const string path(cache_directory + "/" + key + ".json");
+
+    bool hit(false);
+    if(access(path.c_str(), R_OK) != -1) {
+        ifstream file(path);
+        const string content((istreambuf_iterator< char >(file)), istreambuf_iterator< char >());
+        file.close();
+
+        Document cached;
+        if(!cached.Parse(content.c_str()).HasParseError() && cached.IsObject()) {
+            ontology.Swap(cached);
+            hit = true;
+        }
+    }
+
+    if(!hit) {
+        compile_ontology();
+
+        /* write to a temporary file and rename so concurrent jobs never read a partial ontology */
+        const string temporary(path + "." + to_string(getpid()) + ".tmp");
+        ofstream file(temporary, ios_base::out | ios_base::trunc);
+        if(file.is_open()) {
+            print_json_line(ontology, file);
+            file.close();
+            if(file.fail() || rename(temporary.c_str(), path.c_str()) != 0) {
+                remove(temporary.c_str());
+            }
+        } else { throw IOError("failed to write compile cache entry " + temporary); }
+    }
+
+    Value cache(kObjectType);
+    encode_key_value("key", key, cache, report);
+    encode_key_value("hit", hit, cache, report);
+    report.AddMember(Value("compile cache", report.GetAllocator()).Move(), cache.Move(), report.GetAllocator());
+};
+string Job::hash_ontology() const {
+    StringBuffer buffer;
+    Writer< StringBuffer > writer(buffer);
+    ontology.Accept(writer);
+
+    string fingerprint(buffer.GetString(), buffer.GetSize());
+    fingerprint.push_back('\n');
+    fingerprint_environment(buffer.GetString(), buffer.GetSize(), fingerprint);
+    fingerprint_input(fingerprint);
+
+    /*  two independently seeded 64 bit FNV-1a lanes give a 128 bit content hash */
+    uint64_t left(0xcbf29ce484222325);
+    uint64_t right(0x84222325cbf29ce4);
+    const char* content(fingerprint.c_str());
+    for(size_t i(0); i < fingerprint.size(); ++i) {
+        left = (left ^ static_cast< uint8_t >(content[i])) * 0x100000001b3;
+        right = (right ^ static_cast< uint8_t >(content[i])) * 0x100000001b3;
+        right ^= right >> 29;
+    }
+
+    char key[33];
+    snprintf(key, sizeof(key), "%016llx%016llx", static_cast< unsigned long long >(left), static_cast< unsigned long long >(right));
+    return string(key);
+};
 void Job::print_ontology(ostream& o) const {
     print_json(ontology, o);
 };
@@ -26,6 +26,50 @@
 #include "json.h"
 #include "url.h"
 
+/*  Threads shared by jobs that execute concurrently.
+    Every job leases an initial share of pivot threads when it starts and returns a thread
+    whenever one of its pivots exits. A job that is still reading input can lease threads
+    returned by jobs that finished, but only when no job is waiting for its initial share,
+    so a large job grows into the cores freed by small ones without starving the jobs queued behind it.
+    Compression and decompression for all jobs is done by a single shared htslib thread pool.
+*/
+class ThreadBudget {
+    ThreadBudget(ThreadBudget const &) = delete;
+    void operator=(ThreadBudget const &) = delete;
+
+    public:
+        const int32_t capacity;
+        htsThreadPool thread_pool;
+        ThreadBudget(const int32_t& capacity);
+        ~ThreadBudget();
+        int32_t acquire(const int32_t& maximum);
+        void release(const int32_t& count);
+
+        /*  process wide ordinal so threads of concurrent jobs sharing the budget are placed on different cores */
+        inline int32_t next_placement() {
+            return placement.fetch_add(1, memory_order_relaxed);
+        };
+
+        /*  block until a thread is available or satisfied() returns true.
+            returns true if a thread was leased */
+        template < typename P > bool acquire_unless(P satisfied) {
+            unique_lock< mutex > budget_lock(budget_mutex);
+            budget_changed.wait(budget_lock, [&]() { return satisfied() || (available > 0 && waiting == 0); });
+            if(!satisfied()) {
+                --available;
+                return true;
+            }
+            return false;
+        };
+
+    private:
+        int32_t available;
+        int32_t waiting;
+        atomic< int32_t > placement;
+        mutex budget_mutex;
+        condition_variable budget_changed;
+};
+
 class Job {
     public:
         const Document operation;
@@ -36,23 +80,44 @@ class Job {
         inline bool is_compile_only() const {
             return decode_value_by_key< bool >("compile only", ontology);
         };
+        inline bool is_compile_codec_only() const {
+            return decode_value_by_key< bool >("compile codec only", ontology);
+        };
         inline bool is_lint_only() const {
             return decode_value_by_key< bool >("lint only", ontology);
         };
         inline bool is_validate_only() const {
             return decode_value_by_key< bool >("validate only", ontology);
         };
+        inline bool is_executable() const {
+            return !is_validate_only() && !is_lint_only() && !is_compile_only() && !is_compile_codec_only();
+        };
+        void lease_threads(ThreadBudget* budget, const int32_t& count);
+        void return_threads();
         virtual void assemble();
         virtual void compile();
         virtual void load() {};
         virtual void execute() {};
         virtual void print_ontology(ostream& o) const;
         virtual void print_compiled(ostream& o) const;
+        virtual void compile_codec_index() {};
         virtual void print_report(ostream& o) const;
+        /*  reports go to standard error so standard output is free for records */
+        virtual ostream& report_stream() const {
+            return cerr;
+        };
         virtual void describe(ostream& o) const;
 
     protected:
+        ThreadBudget* thread_budget;
+        atomic< int32_t > leased_threads;
+        bool lease_additional_thread();
+        void release_thread();
+        virtual bool is_accepting_threads() const {
+            return false;
+        };
         virtual void manipulate() {};
+        virtual void fingerprint_input(string& fingerprint) const {};
         virtual void clean();
         virtual void validate() {};
         void overlay(const Value& instruction);
@@ -62,6 +127,9 @@ class Job {
     private:
         const Pointer projection_query;
         void remove_disabled();
+        void compile_ontology();
+        void compile_with_cache(const string& cache_directory);
+        string hash_ontology() const;
         Document load_document_with_import(const URL& url, set< URL >& visited) const;
 };
 
@@ -0,0 +1,66 @@
+/*
+    Pheniqs : PHilology ENcoder wIth Quality Statistics
+    Copyright (C) 2018  Lior Galanti
+    NYU Center for Genetics and System Biology
+
+    Author: Lior Galanti <lior.galanti@nyu.edu>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "profile.h"
+
+#if defined(PHENIQS_PROFILE)
+
+static inline double to_seconds(const uint64_t& value) {
+    return static_cast< double >(value) / 1e9;
+};
+static void encode_wait(const string& key, const uint64_t& count, const uint64_t& wait, Value& container, Document& document) {
+    Value element(kObjectType);
+    encode_key_value("count", count, element, document);
+    encode_key_value("time", to_seconds(wait), element, document);
+    if(count > 0) {
+        encode_key_value("average", to_seconds(wait) / static_cast< double >(count), element, document);
+    }
+    container.AddMember(Value(key.c_str(), key.size(), document.GetAllocator()).Move(), element.Move(), document.GetAllocator());
+};
+bool encode_key_value(const string& key, const FeedProfile& value, Value& container, Document& document) {
+    if(container.IsObject()) {
+        container.RemoveMember(key.c_str());
+        Value element(kObjectType);
+        encode_wait("pull lock", value.pull_lock_count.load(), value.pull_lock_wait.load(), element, document);
+        encode_wait("push lock", value.push_lock_count.load(), value.push_lock_wait.load(), element, document);
+        encode_wait("flushable", value.flushable_count, value.flushable_wait, element, document);
+        encode_wait("replenishable", value.replenishable_count, value.replenishable_wait, element, document);
+        container.AddMember(Value(key.c_str(), key.size(), document.GetAllocator()).Move(), element.Move(), document.GetAllocator());
+        return true;
+    } else { throw ConfigurationError(string(key) + " container is not a dictionary"); }
+    return false;
+};
+bool encode_key_value(const string& key, const PivotProfile& value, Value& container, Document& document) {
+    if(container.IsObject()) {
+        container.RemoveMember(key.c_str());
+        Value element(kObjectType);
+        encode_key_value("pull", to_seconds(value.pull), element, document);
+        encode_key_value("validate", to_seconds(value.validate), element, document);
+        encode_key_value("transform", to_seconds(value.transform), element, document);
+        encode_key_value("push", to_seconds(value.push), element, document);
+        encode_key_value("increment", to_seconds(value.increment), element, document);
+        container.AddMember(Value(key.c_str(), key.size(), document.GetAllocator()).Move(), element.Move(), document.GetAllocator());
+        return true;
+    } else { throw ConfigurationError(string(key) + " container is not a dictionary"); }
+    return false;
+};
+
+#endif /* PHENIQS_PROFILE */
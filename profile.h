@@ -0,0 +1,127 @@
+/*
+    Pheniqs : PHilology ENcoder wIth Quality Statistics
+    Copyright (C) 2018  Lior Galanti
+    NYU Center for Genetics and System Biology
+
+    Author: Lior Galanti <lior.galanti@nyu.edu>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PHENIQS_PROFILE_H
+#define PHENIQS_PROFILE_H
+
+#include "include.h"
+#include "json.h"
+
+/*  stages of the pivot loop timed when built with PHENIQS_PROFILE */
+enum class PivotStage : uint8_t {
+    PULL,
+    VALIDATE,
+    TRANSFORM,
+    PUSH,
+    INCREMENT,
+};
+
+#if defined(PHENIQS_PROFILE)
+
+/*  nanoseconds elapsed since checkpoint */
+inline uint64_t elapsed_nanoseconds(const steady_clock::time_point& checkpoint) {
+    return static_cast< uint64_t >(duration_cast< nanoseconds >(steady_clock::now() - checkpoint).count());
+};
+
+/*  nanoseconds elapsed since checkpoint, checkpoint is moved to now */
+inline uint64_t lap_nanoseconds(steady_clock::time_point& checkpoint) {
+    steady_clock::time_point now(steady_clock::now());
+    uint64_t elapsed(static_cast< uint64_t >(duration_cast< nanoseconds >(now - checkpoint).count()));
+    checkpoint = now;
+    return elapsed;
+};
+
+/*  Time a feed spends blocked.
+    pull and push lock are contended by the pivot threads so they are accumulated atomically.
+    flushable and replenishable are only waited on by the feed thread. */
+class FeedProfile {
+    FeedProfile(FeedProfile const &) = delete;
+    void operator=(FeedProfile const &) = delete;
+
+    public:
+        atomic< uint64_t > pull_lock_count;
+        atomic< uint64_t > pull_lock_wait;
+        atomic< uint64_t > push_lock_count;
+        atomic< uint64_t > push_lock_wait;
+        uint64_t flushable_count;
+        uint64_t flushable_wait;
+        uint64_t replenishable_count;
+        uint64_t replenishable_wait;
+        FeedProfile() :
+            pull_lock_count(0),
+            pull_lock_wait(0),
+            push_lock_count(0),
+            push_lock_wait(0),
+            flushable_count(0),
+            flushable_wait(0),
+            replenishable_count(0),
+            replenishable_wait(0) {
+        };
+        inline void increment_pull_lock(const steady_clock::time_point& checkpoint) {
+            pull_lock_wait.fetch_add(elapsed_nanoseconds(checkpoint), memory_order_relaxed);
+            pull_lock_count.fetch_add(1, memory_order_relaxed);
+        };
+        inline void increment_push_lock(const steady_clock::time_point& checkpoint) {
+            push_lock_wait.fetch_add(elapsed_nanoseconds(checkpoint), memory_order_relaxed);
+            push_lock_count.fetch_add(1, memory_order_relaxed);
+        };
+        inline void increment_flushable(const steady_clock::time_point& checkpoint) {
+            flushable_wait += elapsed_nanoseconds(checkpoint);
+            ++flushable_count;
+        };
+        inline void increment_replenishable(const steady_clock::time_point& checkpoint) {
+            replenishable_wait += elapsed_nanoseconds(checkpoint);
+            ++replenishable_count;
+        };
+};
+bool encode_key_value(const string& key, const FeedProfile& value, Value& container, Document& document);
+
+/*  Time a pivot thread spends in each stage of processing a read.
+    pull includes the time blocked on the input feed pull locks
+    and push includes the time blocked on the output feed push locks. */
+class PivotProfile {
+    public:
+        uint64_t pull;
+        uint64_t validate;
+        uint64_t transform;
+        uint64_t push;
+        uint64_t increment;
+        PivotProfile() :
+            pull(0),
+            validate(0),
+            transform(0),
+            push(0),
+            increment(0) {
+        };
+        PivotProfile& operator+=(const PivotProfile& rhs) {
+            pull += rhs.pull;
+            validate += rhs.validate;
+            transform += rhs.transform;
+            push += rhs.push;
+            increment += rhs.increment;
+            return *this;
+        };
+};
+bool encode_key_value(const string& key, const PivotProfile& value, Value& container, Document& document);
+
+#endif /* PHENIQS_PROFILE */
+
+#endif /* PHENIQS_PROFILE_H */
@@ -26,6 +26,7 @@ void to_string(const FormatKind& value, string& result) {
         case FormatKind::FASTQ:         result.assign("FASTQ");      break;
         case FormatKind::HTS:           result.assign("HTS");        break;
         case FormatKind::DEV_NULL:      result.assign("DEV_NULL");   break;
+        case FormatKind::SYNTHETIC:     result.assign("SYNTHETIC");  break;
         default:                        result.assign("UNKNOWN");    break;
     }
 };
@@ -34,6 +35,7 @@ bool from_string(const char* value, FormatKind& result) {
     else if(!strcmp(value, "FASTQ"))    result = FormatKind::FASTQ;
     else if(!strcmp(value, "HTS"))      result = FormatKind::HTS;
     else if(!strcmp(value, "DEV_NULL"))      result = FormatKind::DEV_NULL;
+    else if(!strcmp(value, "SYNTHETIC"))     result = FormatKind::SYNTHETIC;
     else                                result = FormatKind::UNKNOWN;
 
     return (result == FormatKind::UNKNOWN ? false : true);
@@ -71,6 +73,50 @@ template<> bool decode_value_by_key< FormatKind >(const Value::Ch* key, FormatKi
     return false;
 };
 
+void to_string(const RecordGrouping& value, string& result) {
+    switch(value) {
+        case RecordGrouping::CELLULAR:  result.assign("cellular");   break;
+        case RecordGrouping::MOLECULAR: result.assign("molecular");  break;
+        case RecordGrouping::NONE:      result.assign("none");       break;
+        default:                        result.assign("unknown");    break;
+    }
+};
+bool from_string(const char* value, RecordGrouping& result) {
+         if(value == NULL)                  result = RecordGrouping::NONE;
+    else if(!strcmp(value, "none"))         result = RecordGrouping::NONE;
+    else if(!strcmp(value, "cellular"))     result = RecordGrouping::CELLULAR;
+    else if(!strcmp(value, "molecular"))    result = RecordGrouping::MOLECULAR;
+    else                                    result = RecordGrouping::UNKNOWN;
+
+    return (result == RecordGrouping::UNKNOWN ? false : true);
+};
+bool from_string(const string& value, RecordGrouping& result) {
+    return from_string(value.c_str(), result);
+};
+ostream& operator<<(ostream& o, const RecordGrouping& value) {
+    string string_value;
+    to_string(value, string_value);
+    o << string_value;
+    return o;
+};
+void encode_key_value(const string& key, const RecordGrouping& value, Value& container, Document& document) {
+    string string_value;
+    to_string(value, string_value);
+    Value v(string_value.c_str(), string_value.length(), document.GetAllocator());
+    Value k(key.c_str(), key.size(), document.GetAllocator());
+    container.RemoveMember(key.c_str());
+    container.AddMember(k.Move(), v.Move(), document.GetAllocator());
+};
+template<> bool decode_value_by_key< RecordGrouping >(const Value::Ch* key, RecordGrouping& value, const Value& container) {
+    Value::ConstMemberIterator element = container.FindMember(key);
+    if(element != container.MemberEnd() && !element->value.IsNull()) {
+        if(element->value.IsString()) {
+            return from_string(element->value.GetString(), value);
+        } else { throw ConfigurationError(string(key) + " element must be a string"); }
+    }
+    return false;
+};
+
 FeedProxy::FeedProxy(const Value& ontology) try :
     index(decode_value_by_key< int32_t >("index", ontology)),
     url(decode_value_by_key< URL >("url", ontology)),
@@ -79,7 +125,20 @@ FeedProxy::FeedProxy(const Value& ontology) try :
     hfile(NULL),
     capacity(decode_value_by_key< int32_t >("capacity", ontology)),
     resolution(decode_value_by_key< int32_t >("resolution", ontology)),
-    platform(decode_value_by_key< Platform >("platform", ontology)) {
+    platform(decode_value_by_key< Platform >("platform", ontology)),
+    grouping(RecordGrouping::NONE),
+    grouping_capacity(DEFAULT_GROUPING_MEMORY << 10),
+    compression_level(DEFAULT_COMPRESSION_LEVEL),
+    compression_workers(0),
+    resume_offset(-1),
+    read_ahead(0),
+    memory_map(false),
+    writer(NULL) {
+
+    decode_value_by_key< RecordGrouping >("grouping", grouping, ontology);
+    decode_value_by_key< int32_t >("grouping capacity", grouping_capacity, ontology);
+    decode_value_by_key< int32_t >("compression level", compression_level, ontology);
+    decode_value_by_key< list< string > >("cram option", cram_option, ontology);
 
     } catch(ConfigurationError& error) {
         throw ConfigurationError("FeedProxy :: " + error.message);
@@ -122,7 +181,7 @@ void FeedProxy::register_pg(const HeadPGAtom& pg) {
     }
 };
 void FeedProxy::probe() {
-    if(!is_dev_null()) {
+    if(!is_dev_null() && !is_synthetic()) {
         switch(direction) {
             case IoDirection::IN: {
                 /*  Probe input file
@@ -130,7 +189,15 @@ void FeedProxy::probe() {
                     Here you can potentially use hfile to probe the file
                     and verify file format and potentially examine the first read
                 */
-                hfile = hopen(url.c_str(), "r");
+                if(memory_map) {
+                    hfile = hopen_mapped(url.path());
+                }
+                if(hfile == NULL && read_ahead > 0) {
+                    hfile = hopen_read_ahead(url.path(), static_cast< size_t >(read_ahead) * 1024 * 1024);
+                }
+                if(hfile == NULL) {
+                    hfile = hopen(url.c_str(), "r");
+                }
                 if(url.type() == FormatType::UNKNOWN) {
                     ssize_t peeked(0);
                     unsigned char* buffer(NULL);
@@ -255,7 +322,24 @@ void FeedProxy::probe() {
                 break;
             };
             case IoDirection::OUT: {
-                hfile = hopen(url.c_str(), "w");
+                if(resume_offset >= 0 && !url.is_standard_stream()) {
+                    /* discard everything written after the checkpoint and continue from there */
+                    if(truncate(url.c_str(), resume_offset) != 0) {
+                        throw IOError("failed to truncate " + string(url) + " to " + to_string(resume_offset) + " bytes");
+                    }
+                    if(writer != NULL) {
+                        hfile = hopen_batched(url.path(), writer, resume_offset);
+                    } else {
+                        hfile = hopen(url.c_str(), "a");
+                    }
+                } else if(writer != NULL && !url.is_standard_stream()) {
+                    hfile = hopen_batched(url.path(), writer);
+                } else {
+                    hfile = hopen(url.c_str(), "w");
+                }
+                if(hfile == NULL) {
+                    throw IOError("failed to open " + string(url) + " for writing");
+                }
                 break;
             };
             default:
@@ -288,6 +372,8 @@ ostream& operator<<(ostream& o, const FeedProxy& proxy) {
     o << "capacity : " << proxy.capacity << endl;
     o << "resolution : " << proxy.resolution << endl;
     o << "phred_offset : " << to_string(proxy.phred_offset) << endl;
+    o << "grouping : " << proxy.grouping << endl;
+    o << "compression level : " << proxy.compression_level << endl;
     o << proxy.url.description();
     return o;
 };
@@ -25,14 +25,20 @@
 #include "include.h"
 #include "url.h"
 #include "atom.h"
+#include "readahead.h"
+#include "mapped.h"
+#include "writer.h"
 
 const ssize_t PEEK_BUFFER_CAPACITY(4096);
 const int DEFAULT_FEED_CAPACITY(60);
 const int DEFAULT_FEED_RESOLUTION(60);
+const int32_t DEFAULT_GROUPING_MEMORY(768);
+const int32_t DEFAULT_COMPRESSION_LEVEL(-1);
 
 enum class FormatKind : uint8_t {
     UNKNOWN,
     DEV_NULL,
+    SYNTHETIC,
     FASTQ,
     HTS,
 };
@@ -43,6 +49,23 @@ bool from_string(const string& value, FormatKind& result);
 ostream& operator<<(ostream& o, const FormatKind& value);
 void encode_key_value(const string& key, const FormatKind& value, Value& container, Document& document);
 
+/*  Order in which records are written to a SAM, BAM or CRAM output
+    none        records are written in the order they are decoded
+    cellular    records are grouped by the CB cellular barcode tag
+    molecular   records are grouped by CB and then by the MI molecular identifier, or RX if MI is missing
+*/
+enum class RecordGrouping : uint8_t {
+    UNKNOWN,
+    NONE,
+    CELLULAR,
+    MOLECULAR,
+};
+void to_string(const RecordGrouping& value, string& result);
+bool from_string(const char* value, RecordGrouping& result);
+bool from_string(const string& value, RecordGrouping& result);
+ostream& operator<<(ostream& o, const RecordGrouping& value);
+void encode_key_value(const string& key, const RecordGrouping& value, Value& container, Document& document);
+
 class FeedProxy {
     friend ostream& operator<<(ostream& o, const FeedProxy& proxy);
 
@@ -55,12 +78,24 @@ class FeedProxy {
         int capacity;
         int resolution;
         Platform platform;
+        RecordGrouping grouping;
+        int32_t grouping_capacity;
+        int32_t compression_level;
+        int32_t compression_workers;
+        list< string > cram_option;
+        int64_t resume_offset;
+        int32_t read_ahead;
+        bool memory_map;
+        BatchWriter* writer;
         unordered_map< string, const HeadPGAtom > program_by_id;
         unordered_map< string, const HeadRGAtom > read_group_by_id;
         FeedProxy(const Value& ontology);
         inline bool is_dev_null() const {
             return url.is_dev_null();
         };
+        inline bool is_synthetic() const {
+            return url.is_synthetic();
+        };
         inline bool is_stdin() const {
             return url.is_stdin();
         };
@@ -71,7 +106,10 @@ class FeedProxy {
             return url.is_stderr();
         };
         inline FormatKind kind() const {
-            if(!is_dev_null()) {
+            if(is_synthetic()) {
+                return FormatKind::SYNTHETIC;
+
+            } else if(!is_dev_null()) {
                 switch(url.type()) {
                     case FormatType::SAM:
                     case FormatType::BAM:
@@ -36,12 +36,34 @@ class Segment : public ObservedSequence {
         kstring_t name;
         uint16_t flag;
         Auxiliary auxiliary;
+        /*  original input record moved into the segment, without decoding it, when records are forwarded to the output.
+            The FASTQ text in raw for FASTQ input or the bam1_t in record for SAM, BAM and CRAM input.
+            Output feeds move the record on so both are mutable */
+        bool forwarded;
+        mutable kstring_t raw;
+        mutable bam1_t* record;
         inline void clear() override {
             ObservedSequence::clear();
             ks_clear(name);
+            ks_clear(raw);
+            forwarded = false;
             set_qcfail(false);
             auxiliary.clear();
         };
+        /*  take over the original record forwarded with another segment */
+        inline void forward(Segment& other) {
+            swap(raw, other.raw);
+            swap(record, other.record);
+            length = other.length;
+            forwarded = other.forwarded;
+            other.length = 0;
+            other.forwarded = false;
+        };
+        /*  a segment forwarded from SAM, BAM or CRAM input was not unpacked,
+            its sequence and quality are read from the 4 bit packed record */
+        inline bool packed() const {
+            return forwarded && record != NULL;
+        };
         inline uint32_t segment_index() const {
             if(!auxiliary.FI) {
                 if(flag & uint16_t(HtsFlag::PAIRED)) {
@@ -116,14 +138,22 @@ class Segment : public ObservedSequence {
             platform(Platform::UNKNOWN),
             name({ 0, 0, NULL }),
             flag(0),
-            auxiliary() {
+            auxiliary(),
+            forwarded(false),
+            raw({ 0, 0, NULL }),
+            record(NULL) {
 
             ks_terminate(name);
+            ks_terminate(raw);
             flag |= uint16_t(HtsFlag::UNMAP);
             flag |= uint16_t(HtsFlag::MUNMAP);
         };
         ~Segment() override {
             ks_free(name);
+            ks_free(raw);
+            if(record != NULL) {
+                bam_destroy1(record);
+            }
         };
 };
 ostream& operator<<(ostream& o, const Segment& segment);
@@ -244,11 +274,21 @@ class Read : public SequenceArray< Segment > {
         inline void set_molecular_distance(const uint32_t& distance) {
             molecular_distance += distance;
         };
+        inline void update_molecular_quality(const Observation& observation) {
+            for(auto& segment : this->segment_array) {
+                segment.auxiliary.update_molecular_quality(observation);
+            }
+        };
         inline void update_raw_molecular_barcode(const Observation& observation) {
             for(auto& segment : this->segment_array) {
                 segment.auxiliary.update_raw_molecular_barcode(observation);
             }
         };
+        inline void update_molecular_identifier(const string& identifier) {
+            for(auto& segment : this->segment_array) {
+                segment.auxiliary.update_molecular_identifier(identifier);
+            }
+        };
 
         inline void update_cellular_barcode(const Barcode& barcode) {
             for(auto& segment : this->segment_array) {
@@ -260,6 +300,11 @@ class Read : public SequenceArray< Segment > {
                 segment.auxiliary.update_cellular_barcode(observation);
             }
         };
+        inline void update_cellular_barcode(const uint8_t* code, const int32_t& length) {
+            for(auto& segment : this->segment_array) {
+                segment.auxiliary.update_cellular_barcode(code, length);
+            }
+        };
         inline void update_cellular_decoding_confidence(const double& confidence) {
             cellular_decoding_confidence *= confidence;
         };
@@ -0,0 +1,242 @@
+/*
+    Pheniqs : PHilology ENcoder wIth Quality Statistics
+    Copyright (C) 2018  Lior Galanti
+    NYU Center for Genetics and System Biology
+
+    Author: Lior Galanti <lior.galanti@nyu.edu>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "readahead.h"
+#include "backend.h"
+
+ReadAhead::ReadAhead(const int& descriptor, const size_t& capacity, const int32_t& depth) :
+    descriptor(descriptor),
+    capacity(capacity),
+    ring(max(depth, 2)),
+    head(0),
+    tail(0),
+    filled(0),
+    cursor(0),
+    next_offset(0),
+    end_of_file(false),
+    error(0),
+    generation(0),
+    stopped(false) {
+
+    for(auto& block : ring) {
+        void* data(NULL);
+        if(posix_memalign(&data, READ_AHEAD_ALIGNMENT, capacity) != 0) {
+            for(auto& allocated : ring) {
+                free(allocated.data);
+            }
+            throw OutOfMemoryError();
+        }
+        block.data = static_cast< uint8_t* >(data);
+        block.size = 0;
+    }
+
+    #if defined(POSIX_FADV_SEQUENTIAL)
+    posix_fadvise(descriptor, 0, 0, POSIX_FADV_SEQUENTIAL);
+    #endif
+
+    io_thread = thread(&ReadAhead::run, this);
+};
+ReadAhead::~ReadAhead() {
+    {
+        lock_guard< mutex > ring_lock(ring_mutex);
+        stopped = true;
+    }
+    block_vacant.notify_all();
+    io_thread.join();
+    for(auto& block : ring) {
+        free(block.data);
+    }
+    ::close(descriptor);
+};
+ssize_t ReadAhead::read_block(uint8_t* buffer, const off_t& offset) {
+    /* network file systems may return short reads before the end of the file */
+    size_t size(0);
+    while(size < capacity) {
+        ssize_t consumed(pread(descriptor, buffer + size, capacity - size, offset + size));
+        if(consumed > 0) {
+            size += consumed;
+        } else if(consumed == 0) {
+            break;
+        } else if(errno != EINTR) {
+            return -1;
+        }
+    }
+    return size;
+};
+void ReadAhead::run() {
+    unique_lock< mutex > ring_lock(ring_mutex);
+    while(!stopped) {
+        block_vacant.wait(ring_lock, [this]() { return stopped || (filled < ring.size() && !end_of_file && error == 0); });
+        if(!stopped) {
+            /*  the tail block is not visible to the consumer until it is filled
+                so it is safe to read into it without holding the lock */
+            Block& block(ring[tail]);
+            const off_t offset(next_offset);
+            const uint64_t expected(generation);
+            ring_lock.unlock();
+
+            const ssize_t size(read_block(block.data, offset));
+            const int code(errno);
+
+            #if defined(POSIX_FADV_WILLNEED)
+            if(size == static_cast< ssize_t >(capacity)) {
+                posix_fadvise(descriptor, offset + size, capacity, POSIX_FADV_WILLNEED);
+            }
+            #endif
+
+            ring_lock.lock();
+
+            /* a seek while reading invalidates the block */
+            if(expected == generation) {
+                if(size < 0) {
+                    error = code;
+                } else {
+                    if(size > 0) {
+                        block.size = size;
+                        next_offset += size;
+                        tail = (tail + 1) % ring.size();
+                        ++filled;
+                    }
+                    if(size < static_cast< ssize_t >(capacity)) {
+                        end_of_file = true;
+                    }
+                }
+                block_ready.notify_all();
+            }
+        }
+    }
+};
+ssize_t ReadAhead::read(void* buffer, const size_t& size) {
+    unique_lock< mutex > ring_lock(ring_mutex);
+    block_ready.wait(ring_lock, [this]() { return filled > 0 || end_of_file || error != 0; });
+    if(filled > 0) {
+        /*  the head block is not written by the IO thread until it is released */
+        Block& block(ring[head]);
+        const size_t consumed(min(size, block.size - cursor));
+        ring_lock.unlock();
+
+        memcpy(buffer, block.data + cursor, consumed);
+
+        ring_lock.lock();
+        cursor += consumed;
+        if(cursor == block.size) {
+            cursor = 0;
+            head = (head + 1) % ring.size();
+            --filled;
+            block_vacant.notify_one();
+        }
+        return consumed;
+
+    } else if(error != 0) {
+        errno = error;
+        return -1;
+    }
+    return 0;
+};
+off_t ReadAhead::seek(const off_t& offset, const int& whence) {
+    off_t position(offset);
+    switch(whence) {
+        case SEEK_SET:
+            break;
+        case SEEK_END: {
+            struct stat status;
+            if(fstat(descriptor, &status) != 0) {
+                return -1;
+            }
+            position += status.st_size;
+            break;
+        };
+        default:
+            errno = EINVAL;
+            return -1;
+    }
+    if(position < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    {
+        lock_guard< mutex > ring_lock(ring_mutex);
+        ++generation;
+        head = 0;
+        tail = 0;
+        filled = 0;
+        cursor = 0;
+        next_offset = position;
+        end_of_file = false;
+        error = 0;
+    }
+    block_vacant.notify_one();
+    return position;
+};
+
+typedef struct {
+    hFILE base;
+    ReadAhead* reader;
+} hFILE_read_ahead;
+
+static ssize_t read_ahead_read(hFILE* fp, void* buffer, size_t nbytes) {
+    return reinterpret_cast< hFILE_read_ahead* >(fp)->reader->read(buffer, nbytes);
+};
+static ssize_t read_ahead_write(hFILE* fp, const void* buffer, size_t nbytes) {
+    errno = EBADF;
+    return -1;
+};
+static off_t read_ahead_seek(hFILE* fp, off_t offset, int whence) {
+    return reinterpret_cast< hFILE_read_ahead* >(fp)->reader->seek(offset, whence);
+};
+static int read_ahead_close(hFILE* fp) {
+    delete reinterpret_cast< hFILE_read_ahead* >(fp)->reader;
+    return 0;
+};
+static const struct hFILE_backend read_ahead_backend = {
+    read_ahead_read,
+    read_ahead_write,
+    read_ahead_seek,
+    NULL,
+    read_ahead_close
+};
+
+hFILE* hopen_read_ahead(const string& path, const size_t& capacity, const int32_t& depth) {
+    hFILE* hfile(NULL);
+    int descriptor(::open(path.c_str(), O_RDONLY));
+    if(descriptor >= 0) {
+        struct stat status;
+        if(fstat(descriptor, &status) == 0 && S_ISREG(status.st_mode)) {
+            hFILE_read_ahead* fp(reinterpret_cast< hFILE_read_ahead* >(hfile_init(sizeof(hFILE_read_ahead), "r", 0)));
+            if(fp != NULL) {
+                try {
+                    fp->reader = new ReadAhead(descriptor, capacity, depth);
+                } catch(...) {
+                    hfile_destroy(&fp->base);
+                    ::close(descriptor);
+                    throw;
+                }
+                fp->base.backend = &read_ahead_backend;
+                hfile = &fp->base;
+            } else {
+                ::close(descriptor);
+            }
+        } else {
+            ::close(descriptor);
+        }
+    }
+    return hfile;
+};
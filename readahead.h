@@ -0,0 +1,86 @@
+/*
+    Pheniqs : PHilology ENcoder wIth Quality Statistics
+    Copyright (C) 2018  Lior Galanti
+    NYU Center for Genetics and System Biology
+
+    Author: Lior Galanti <lior.galanti@nyu.edu>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PHENIQS_READAHEAD_H
+#define PHENIQS_READAHEAD_H
+
+#include "include.h"
+#include "error.h"
+
+#include <sys/stat.h>
+
+/*  Depth of the read ahead ring, the number of reads that can be in flight or waiting to be consumed */
+const int32_t READ_AHEAD_DEPTH(4);
+
+/*  Read ahead alignment, buffers start on a page boundary */
+const size_t READ_AHEAD_ALIGNMENT(4096);
+
+/*  Asynchronous read ahead for input files
+
+    Decompression threads consume input through kseq and bgzf, which read in small synchronous
+    chunks. On network file systems every one of those reads can stall for the round trip to the server.
+    A dedicated IO thread instead reads ahead of the consumer with large sequential reads into a ring of
+    page aligned buffers and the consumer copies out of the buffers that are ready, so unless the IO
+    thread falls behind the file system latency is hidden. The kernel is told the file is read
+    sequentially and the block after the one being read is prefetched.
+    A seek discards the ring and restarts reading from the new position.
+*/
+class ReadAhead {
+    ReadAhead(ReadAhead const &) = delete;
+    void operator=(ReadAhead const &) = delete;
+
+    public:
+        ReadAhead(const int& descriptor, const size_t& capacity, const int32_t& depth);
+        ~ReadAhead();
+        ssize_t read(void* buffer, const size_t& size);
+        off_t seek(const off_t& offset, const int& whence);
+
+    private:
+        struct Block {
+            uint8_t* data;
+            size_t size;
+        };
+        const int descriptor;
+        const size_t capacity;
+        vector< Block > ring;
+        size_t head;
+        size_t tail;
+        size_t filled;
+        size_t cursor;
+        off_t next_offset;
+        bool end_of_file;
+        int error;
+        uint64_t generation;
+        bool stopped;
+        mutex ring_mutex;
+        condition_variable block_ready;
+        condition_variable block_vacant;
+        thread io_thread;
+        void run();
+        ssize_t read_block(uint8_t* buffer, const off_t& offset);
+};
+
+/*  hFILE reading a regular file through a ReadAhead.
+    Returns NULL if the path is not a regular file so the caller can fall back to hopen.
+    capacity is the size of every read in bytes */
+hFILE* hopen_read_ahead(const string& path, const size_t& capacity, const int32_t& depth=READ_AHEAD_DEPTH);
+
+#endif /* PHENIQS_READAHEAD_H */
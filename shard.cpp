@@ -0,0 +1,627 @@
+/*
+    Pheniqs : PHilology ENcoder wIth Quality Statistics
+    Copyright (C) 2018  Lior Galanti
+    NYU Center for Genetics and System Biology
+
+    Author: Lior Galanti <lior.galanti@nyu.edu>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "shard.h"
+
+/*  Size of a BGZF block header, the gzip member header with the BC extra subfield holding the block size */
+static const int BGZF_HEADER_SIZE(18);
+
+/*  A BGZF block is at most 64KiB so a window of two blocks always contains a complete block header */
+static const int64_t BGZF_SCAN_WINDOW(0x20000 + BGZF_HEADER_SIZE);
+
+/*  Upper bound on the size of a BAM record considered when probing for a record boundary */
+static const int32_t MAXIMUM_BAM_RECORD_SIZE(0x4000000);
+
+/*  Decompressed bytes kept behind the read position before the buffer is compacted */
+static const size_t SHARD_BUFFER_THRESHOLD(0x100000);
+
+static inline uint16_t decode_uint16(const uint8_t* code) {
+    return static_cast< uint16_t >(code[0] | (code[1] << 8));
+};
+static inline uint32_t decode_uint32(const uint8_t* code) {
+    return
+        static_cast< uint32_t >(code[0]) |
+        static_cast< uint32_t >(code[1]) << 8 |
+        static_cast< uint32_t >(code[2]) << 16 |
+        static_cast< uint32_t >(code[3]) << 24;
+};
+static inline int32_t decode_int32(const uint8_t* code) {
+    return static_cast< int32_t >(decode_uint32(code));
+};
+static inline bool is_bgzf_header(const uint8_t* code) {
+    return
+        code[0] == 0x1f && code[1] == 0x8b && code[2] == 0x08 && (code[3] & 0x04) &&
+        code[10] == 6 && code[11] == 0 &&
+        code[12] == 'B' && code[13] == 'C' &&
+        code[14] == 2 && code[15] == 0;
+};
+
+bool parse_shard(const string& value, int32_t& index, int32_t& count) {
+    /* shards are written i/N with 1 <= i <= N */
+    const char* begin(value.c_str());
+    char* end(NULL);
+    long i(strtol(begin, &end, 10));
+    if(end != begin && *end == '/') {
+        begin = end + 1;
+        long n(strtol(begin, &end, 10));
+        if(end != begin && *end == '\0' && i > 0 && i <= n && n <= numeric_limits< int32_t >::max()) {
+            index = static_cast< int32_t >(i - 1);
+            count = static_cast< int32_t >(n);
+            return true;
+        }
+    }
+    return false;
+};
+string shard_suffix(const int32_t& index, const int32_t& count) {
+    return "_shard" + to_string(index + 1) + "of" + to_string(count);
+};
+
+ShardFile::ShardFile(const URL& url, const int32_t& resolution) :
+    url(url),
+    resolution(resolution),
+    begin(-1),
+    end(-1),
+    length(-1) {
+};
+void encode_value(const ShardFile& value, Value& container, Document& document) {
+    container.SetObject();
+    encode_key_value("url", value.url, container, document);
+    encode_key_value("begin", value.begin, container, document);
+    encode_key_value("end", value.end, container, document);
+    encode_key_value("length", value.length, container, document);
+};
+
+/*  Sequential reader over the decompressed content of a BGZF file used to locate shard boundaries.
+
+    Blocks are decompressed one at a time and appended to a buffer that remembers the compressed
+    address of every block, so any position in the buffer can be translated back to a virtual offset.
+    Virtual offsets are normalized the way bgzf_tell reports them, a position at the end of a block
+    is reported as the beginning of the next block.
+*/
+class ShardReader {
+    ShardReader(ShardReader const &) = delete;
+    void operator=(ShardReader const &) = delete;
+
+    public:
+        const URL url;
+        const int32_t resolution;
+        int64_t size;
+        int64_t origin;
+        ShardReader(const URL& url, const int32_t& resolution) :
+            url(url),
+            resolution(resolution),
+            size(0),
+            origin(0),
+            raw(NULL),
+            bgzf(NULL),
+            position(0),
+            eof(false),
+            empty_address(-1) {
+        };
+        virtual ~ShardReader() {
+            if(bgzf != NULL) {
+                bgzf_close(bgzf);
+                bgzf = NULL;
+            }
+            if(raw != NULL) {
+                hclose(raw);
+                raw = NULL;
+            }
+        };
+        virtual void open() {
+            if((raw = hopen(url.c_str(), "r")) == NULL) {
+                throw IOError("failed to open " + string(url) + " for reading");
+            }
+            if((size = hseek(raw, 0, SEEK_END)) < 0) {
+                throw ConfigurationError("sharding requires a seekable input but " + string(url) + " is not");
+            }
+            if((bgzf = bgzf_open(url.c_str(), "r")) == NULL) {
+                throw IOError("failed to open " + string(url) + " for reading");
+            }
+            if(!bgzf->is_compressed || bgzf->is_gzip) {
+                throw ConfigurationError("sharding requires BGZF compressed input but " + string(url) + " is not");
+            }
+        };
+
+        /*  locate the first read after the first BGZF block at or after a compressed address */
+        bool locate(const int64_t& address, int64_t& boundary, string& name) {
+            const int64_t block(find_block(address));
+            if(block >= 0) {
+                if((block << 16) <= origin) {
+                    seek(origin);
+                    return align(true, boundary, name);
+
+                } else {
+                    seek(block << 16);
+                    if(synchronize()) {
+                        return align(false, boundary, name);
+                    }
+                }
+            }
+            return false;
+        };
+
+        /*  locate the first record of the read named target, searching a widening window around a compressed address */
+        void search(const int64_t& address, const string& target, int64_t& boundary) {
+            int64_t margin(max(size / 256, BGZF_SCAN_WINDOW));
+            while(true) {
+                const int64_t lower(max(static_cast< int64_t >(0), address - margin));
+                const int64_t upper(address + margin);
+                const int64_t block(find_block(lower));
+                if(block >= 0) {
+                    bool opening(false);
+                    bool synchronized(false);
+                    if((block << 16) <= origin) {
+                        seek(origin);
+                        opening = true;
+                        synchronized = true;
+                    } else {
+                        seek(block << 16);
+                        synchronized = synchronize();
+                    }
+                    if(synchronized) {
+                        string previous;
+                        string name;
+                        while(true) {
+                            const int64_t offset(tell());
+                            if(offset < 0 || (offset >> 16) > upper || !next(name)) {
+                                break;
+                            }
+                            if(name == target && (resolution == 1 || opening || (!previous.empty() && previous != target))) {
+                                boundary = offset;
+                                return;
+                            }
+                            previous.swap(name);
+                            opening = false;
+                        }
+                    }
+                }
+                if(lower == 0 && upper >= size) {
+                    throw ConfigurationError("failed to locate read " + target + " in " + string(url) + " when synchronizing shard");
+                }
+                margin *= 4;
+            }
+        };
+
+        /*  uncompressed bytes between two virtual offsets, computed from the block headers and footers without decompressing */
+        int64_t measure(const int64_t& begin, const int64_t& end) {
+            int64_t length(static_cast< int64_t >(end & 0xFFFF) - static_cast< int64_t >(begin & 0xFFFF));
+            int64_t address(begin >> 16);
+            const int64_t last(end >> 16);
+            uint8_t header[BGZF_HEADER_SIZE];
+            uint8_t footer[4];
+            while(address < last) {
+                if(!read_header(address, header) || !is_bgzf_header(header)) {
+                    throw IOError("invalid BGZF block at " + to_string(address) + " in " + string(url));
+                }
+                const int64_t block_size(decode_uint16(header + 16) + 1);
+                if(hseek(raw, address + block_size - 4, SEEK_SET) < 0 || hread(raw, footer, 4) != 4) {
+                    throw IOError("failed to read " + string(url));
+                }
+                length += decode_uint32(footer);
+                address += block_size;
+            }
+            return length;
+        };
+
+    protected:
+        hFILE* raw;
+        BGZF* bgzf;
+        vector< uint8_t > buffer;
+        size_t position;
+        vector< pair< size_t, int64_t > > block_array;
+        bool eof;
+        int64_t empty_address;
+
+        /*  advance to the first record boundary */
+        virtual bool synchronize() = 0;
+
+        /*  consume the record at the current position and report its read name */
+        virtual bool next(string& name) = 0;
+
+        inline const uint8_t* data() const {
+            return buffer.data() + position;
+        };
+        inline size_t available() const {
+            return buffer.size() - position;
+        };
+        void seek(const int64_t& offset) {
+            buffer.clear();
+            block_array.clear();
+            position = 0;
+            eof = false;
+            empty_address = -1;
+            if(bgzf_seek(bgzf, (offset >> 16) << 16, SEEK_SET) < 0) {
+                throw IOError("failed to seek in " + string(url));
+            }
+            const size_t skip(offset & 0xFFFF);
+            if(skip > 0) {
+                fill(skip);
+                advance(min(skip, available()));
+            }
+        };
+
+        /*  decompress blocks until size bytes are available, returns false if the file ends first */
+        bool fill(const size_t& size) {
+            while(available() < size && !eof) {
+                if(bgzf_read_block(bgzf) < 0) {
+                    throw IOError("failed to read " + string(url));
+                }
+                if(bgzf->block_length > 0) {
+                    const uint8_t* block(static_cast< const uint8_t* >(bgzf->uncompressed_block));
+                    block_array.emplace_back(buffer.size(), bgzf->block_address);
+                    buffer.insert(buffer.end(), block, block + bgzf->block_length);
+
+                } else if(bgzf->block_address == empty_address) {
+                    /* bgzf_read_block does not move past the end of the file */
+                    eof = true;
+
+                } else {
+                    empty_address = bgzf->block_address;
+                }
+            }
+            return available() >= size;
+        };
+        void advance(const size_t& size) {
+            position += size;
+            if(position > SHARD_BUFFER_THRESHOLD && !block_array.empty()) {
+                /* drop the blocks that end before the current position */
+                size_t first(0);
+                while(first + 1 < block_array.size() && block_array[first + 1].first <= position) {
+                    ++first;
+                }
+                const size_t offset(block_array[first].first);
+                if(offset > 0) {
+                    buffer.erase(buffer.begin(), buffer.begin() + offset);
+                    block_array.erase(block_array.begin(), block_array.begin() + first);
+                    for(auto& block : block_array) {
+                        block.first -= offset;
+                    }
+                    position -= offset;
+                }
+            }
+        };
+
+        /*  virtual offset of the current position, -1 at the end of the file */
+        int64_t tell() {
+            if(fill(1)) {
+                for(auto block = block_array.rbegin(); block != block_array.rend(); ++block) {
+                    if(block->first <= position) {
+                        return (block->second << 16) | static_cast< int64_t >(position - block->first);
+                    }
+                }
+            }
+            return -1;
+        };
+
+        /*  offset of the next occurrence of c at or after offset, relative to the current position */
+        bool find(const uint8_t& c, const size_t& offset, size_t& found) {
+            size_t start(offset);
+            while(true) {
+                if(start < available()) {
+                    const void* hit(memchr(data() + start, c, available() - start));
+                    if(hit != NULL) {
+                        found = static_cast< size_t >(static_cast< const uint8_t* >(hit) - data());
+                        return true;
+                    }
+                    start = available();
+                }
+                if(!fill(available() + 1)) {
+                    return false;
+                }
+            }
+        };
+
+        /*  move from a record boundary to the first record of a read.
+            when reads span several records the first read is skipped unless it is known to be complete */
+        bool align(const bool& opening, int64_t& boundary, string& name) {
+            if(resolution > 1 && !opening) {
+                string previous;
+                if(next(previous)) {
+                    while(true) {
+                        boundary = tell();
+                        if(boundary < 0 || !next(name)) {
+                            return false;
+                        }
+                        if(name != previous) {
+                            return true;
+                        }
+                    }
+                }
+                return false;
+
+            } else {
+                boundary = tell();
+                return boundary >= 0 && next(name);
+            }
+        };
+
+    private:
+        bool read_header(const int64_t& address, uint8_t* header) {
+            return hseek(raw, address, SEEK_SET) >= 0 && hread(raw, header, BGZF_HEADER_SIZE) == BGZF_HEADER_SIZE;
+        };
+
+        /*  compressed address of the first BGZF block at or after address, -1 if there is none.
+            A candidate header is only accepted if it is followed by another block header or the end of the file */
+        int64_t find_block(const int64_t& address) {
+            vector< uint8_t > window(BGZF_SCAN_WINDOW);
+            if(hseek(raw, address, SEEK_SET) < 0) {
+                throw IOError("failed to seek in " + string(url));
+            }
+            const ssize_t length(hread(raw, window.data(), window.size()));
+            if(length < 0) {
+                throw IOError("failed to read " + string(url));
+            }
+            uint8_t header[BGZF_HEADER_SIZE];
+            for(ssize_t i(0); i + BGZF_HEADER_SIZE <= length; ++i) {
+                if(is_bgzf_header(window.data() + i)) {
+                    const int64_t candidate(address + i);
+                    const int64_t following(candidate + decode_uint16(window.data() + i + 16) + 1);
+                    if(following == size || (following < size && read_header(following, header) && is_bgzf_header(header))) {
+                        return candidate;
+                    }
+                }
+            }
+            return -1;
+        };
+};
+
+class FastqShardReader : public ShardReader {
+    public:
+        FastqShardReader(const URL& url, const int32_t& resolution) :
+            ShardReader(url, resolution) {
+        };
+
+    protected:
+        bool synchronize() override {
+            /* a block may begin in the middle of a line so the first line is never a candidate */
+            size_t end(0);
+            if(find('\n', 0, end)) {
+                advance(end + 1);
+                while(!is_record()) {
+                    if(!find('\n', 0, end)) {
+                        return false;
+                    }
+                    advance(end + 1);
+                }
+                return true;
+            }
+            return false;
+        };
+        bool next(string& name) override {
+            size_t end(0);
+            if(line(0, end)) {
+                const uint8_t* code(data());
+                size_t length(1);
+                while(length < end && code[length] != ' ' && code[length] != '\t' && code[length] != '\r') {
+                    ++length;
+                }
+                name.assign(reinterpret_cast< const char* >(code + 1), length - 1);
+                for(int32_t i(1); i < 4; ++i) {
+                    if(!line(end + 1, end)) {
+                        return false;
+                    }
+                }
+                advance(min(end + 1, available()));
+                return true;
+            }
+            return false;
+        };
+
+    private:
+        /*  end of the line starting at offset, the end of the file terminates the last line */
+        bool line(const size_t& offset, size_t& end) {
+            if(find('\n', offset, end)) {
+                return true;
+            } else if(offset < available()) {
+                end = available();
+                return true;
+            }
+            return false;
+        };
+
+        /*  a quality line may start with @ but is never followed by a line starting with +
+            two lines later, so a header, sequence, separator and quality line of equal
+            length followed by another header identify a record boundary */
+        bool is_record() {
+            size_t header(0);
+            size_t sequence(0);
+            size_t separator(0);
+            size_t quality(0);
+            if(line(0, header) && line(header + 1, sequence) && line(sequence + 1, separator) && line(separator + 1, quality)) {
+                const uint8_t* code(data());
+                if(code[0] == '@' && code[sequence + 1] == '+' && sequence - header == quality - separator) {
+                    if(fill(quality + 2)) {
+                        return data()[quality + 1] == '@';
+                    }
+                    return true;
+                }
+            }
+            return false;
+        };
+};
+
+class BamShardReader : public ShardReader {
+    public:
+        BamShardReader(const URL& url, const int32_t& resolution) :
+            ShardReader(url, resolution),
+            reference_count(0) {
+        };
+        void open() override {
+            ShardReader::open();
+            bam_hdr_t* hdr(bam_hdr_read(bgzf));
+            if(hdr == NULL) {
+                throw IOError("failed to read header from " + string(url));
+            }
+            reference_count = hdr->n_targets;
+            bam_hdr_destroy(hdr);
+            origin = bgzf_tell(bgzf);
+        };
+
+    protected:
+        bool synchronize() override {
+            while(fill(1)) {
+                if(is_record()) {
+                    return true;
+                }
+                advance(1);
+            }
+            return false;
+        };
+        bool next(string& name) override {
+            if(fill(36)) {
+                const int32_t block_size(decode_int32(data()));
+                const uint8_t name_length(data()[12]);
+                if(block_size >= 32 && name_length > 0 && fill(4 + static_cast< size_t >(block_size))) {
+                    name.assign(reinterpret_cast< const char* >(data() + 36), name_length - 1);
+                    advance(4 + static_cast< size_t >(block_size));
+                    return true;
+                }
+            }
+            return false;
+        };
+
+    private:
+        int32_t reference_count;
+
+        /*  three consecutive plausible records, or plausible records running to the end of the file */
+        bool is_record() {
+            size_t offset(0);
+            size_t record_size(0);
+            for(int32_t i(0); i < 3; ++i) {
+                if(!is_record_at(offset, record_size)) {
+                    return i > 0 && !fill(offset + 1) && offset == available();
+                }
+                offset += record_size;
+            }
+            return true;
+        };
+        bool is_record_at(const size_t& offset, size_t& record_size) {
+            if(fill(offset + 36)) {
+                const uint8_t* code(data() + offset);
+                const int32_t block_size(decode_int32(code));
+                const int32_t reference_id(decode_int32(code + 4));
+                const int32_t alignment_position(decode_int32(code + 8));
+                const uint8_t name_length(code[12]);
+                const uint16_t cigar_length(decode_uint16(code + 16));
+                const int32_t sequence_length(decode_int32(code + 20));
+                const int32_t mate_reference_id(decode_int32(code + 24));
+                const int32_t mate_position(decode_int32(code + 28));
+                if(block_size < 32 || block_size > MAXIMUM_BAM_RECORD_SIZE) {
+                    return false;
+                }
+                if(reference_id < -1 || reference_id >= reference_count || mate_reference_id < -1 || mate_reference_id >= reference_count) {
+                    return false;
+                }
+                if(alignment_position < -1 || mate_position < -1 || name_length < 1 || sequence_length < 0) {
+                    return false;
+                }
+                const int64_t expected(
+                    32 +
+                    static_cast< int64_t >(name_length) +
+                    4 * static_cast< int64_t >(cigar_length) +
+                    (static_cast< int64_t >(sequence_length) + 1) / 2 +
+                    static_cast< int64_t >(sequence_length));
+                if(expected > block_size) {
+                    return false;
+                }
+                if(fill(offset + 36 + name_length)) {
+                    /* read names are null terminated and made of printable characters other than @ */
+                    const uint8_t* name(data() + offset + 36);
+                    if(name[name_length - 1] != '\0') {
+                        return false;
+                    }
+                    for(int32_t i(0); i < name_length - 1; ++i) {
+                        if(name[i] < '!' || name[i] > '~' || name[i] == '@') {
+                            return false;
+                        }
+                    }
+                    record_size = 4 + static_cast< size_t >(block_size);
+                    return fill(offset + record_size);
+                }
+            }
+            return false;
+        };
+};
+
+static vector< int64_t > locate_boundary(const int32_t& index, const int32_t& count, vector< ShardReader* >& reader_array) {
+    /*  the first file decides where the boundary falls and the others follow its read name */
+    vector< int64_t > boundary(reader_array.size(), -1);
+    if(index == 0) {
+        for(size_t i(0); i < reader_array.size(); ++i) {
+            boundary[i] = reader_array[i]->origin;
+        }
+    } else if(index < count) {
+        ShardReader* reference(reader_array.front());
+        string name;
+        if(reference->locate(reference->size / count * index, boundary[0], name)) {
+            for(size_t i(1); i < reader_array.size(); ++i) {
+                reader_array[i]->search(reader_array[i]->size / count * index, name, boundary[i]);
+            }
+        } else {
+            boundary[0] = -1;
+        }
+    }
+    return boundary;
+};
+void locate_shard(const int32_t& index, const int32_t& count, vector< ShardFile >& file_array) {
+    vector< ShardReader* > reader_array;
+    try {
+        for(auto& file : file_array) {
+            switch(file.url.type()) {
+                case FormatType::FASTQ:
+                    reader_array.push_back(new FastqShardReader(file.url, file.resolution));
+                    break;
+                case FormatType::BAM:
+                    reader_array.push_back(new BamShardReader(file.url, file.resolution));
+                    break;
+                default:
+                    throw ConfigurationError("sharding supports FASTQ and BAM input but " + string(file.url) + " is neither");
+            }
+            reader_array.back()->open();
+        }
+        if(!reader_array.empty()) {
+            vector< int64_t > begin(locate_boundary(index, count, reader_array));
+            vector< int64_t > end(locate_boundary(index + 1, count, reader_array));
+            for(size_t i(0); i < file_array.size(); ++i) {
+                ShardFile& file(file_array[i]);
+                if(begin[i] < 0) {
+                    file.begin = -1;
+                    file.end = -1;
+                    file.length = 0;
+
+                } else {
+                    file.begin = begin[i];
+                    file.end = end[i];
+                    file.length = end[i] < 0 ? -1 : reader_array[i]->measure(begin[i], end[i]);
+                }
+            }
+        }
+    } catch(...) {
+        for(auto reader : reader_array) {
+            delete reader;
+        }
+        throw;
+    }
+    for(auto reader : reader_array) {
+        delete reader;
+    }
+};
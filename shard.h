@@ -0,0 +1,58 @@
+/*
+    Pheniqs : PHilology ENcoder wIth Quality Statistics
+    Copyright (C) 2018  Lior Galanti
+    NYU Center for Genetics and System Biology
+
+    Author: Lior Galanti <lior.galanti@nyu.edu>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PHENIQS_SHARD_H
+#define PHENIQS_SHARD_H
+
+#include "include.h"
+#include "url.h"
+
+/*  Sharding splits a BGZF compressed FASTQ or BAM input between independent processes.
+
+    Shard k of N starts at the first record boundary following the first BGZF block found
+    at k/N of the compressed size of the first input file, so no index is required.
+    When reads span several records, as in interleaved input, the boundary is moved to the
+    first record of the next read. Every other input file is synchronized by searching,
+    around the same relative position, for the record with the same read name.
+    Shard boundaries are computed the same way by every process, so the end of shard k
+    is exactly the beginning of shard k + 1 and every read is processed by exactly one shard.
+*/
+bool parse_shard(const string& value, int32_t& index, int32_t& count);
+string shard_suffix(const int32_t& index, const int32_t& count);
+
+class ShardFile {
+    public:
+        const URL url;
+        const int32_t resolution;
+        /*  virtual offset of the first record in the shard, -1 if the shard is empty */
+        int64_t begin;
+        /*  virtual offset of the first record in the next shard, -1 if the shard extends to the end of the file */
+        int64_t end;
+        /*  uncompressed bytes between begin and end, -1 if the shard extends to the end of the file */
+        int64_t length;
+        ShardFile(const URL& url, const int32_t& resolution);
+};
+void encode_value(const ShardFile& value, Value& container, Document& document);
+
+/*  index is zero based */
+void locate_shard(const int32_t& index, const int32_t& count, vector< ShardFile >& file_array);
+
+#endif /* PHENIQS_SHARD_H */
@@ -0,0 +1,243 @@
+/*
+    Pheniqs : PHilology ENcoder wIth Quality Statistics
+    Copyright (C) 2018  Lior Galanti
+    NYU Center for Genetics and System Biology
+
+    Author: Lior Galanti <lior.galanti@nyu.edu>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "synthetic.h"
+
+SyntheticCodec::SyntheticCodec(const Value& ontology, const vector< int32_t >& segment_length, const double& noise) try :
+    barcode_array(decode_value_by_key< vector< Barcode > >("codec", ontology)) {
+
+    /*  the residual probability mass is drawn as noise.
+        When not explicitly specified the noise is the undetermined concentration of the decoder */
+    double residual(noise);
+    if(residual < 0) {
+        residual = 0;
+        Value::ConstMemberIterator reference = ontology.FindMember("undetermined");
+        if(reference != ontology.MemberEnd()) {
+            decode_value_by_key< double >("concentration", residual, reference->value);
+        }
+    }
+
+    double total(0);
+    for(const auto& barcode : barcode_array) {
+        total += barcode.concentration;
+    }
+    if(total > 0) {
+        double factor((1.0 - residual) / total);
+        double cumulative(0);
+        cumulative_concentration.reserve(barcode_array.size());
+        for(const auto& barcode : barcode_array) {
+            cumulative += barcode.concentration * factor;
+            cumulative_concentration.push_back(cumulative);
+        }
+    } else { throw ConfigurationError("codec concentration must be positive"); }
+
+    /*  place each token of the decoder transform on the synthetic input segments */
+    const Rule rule(decode_value_by_key< Rule >("transform", ontology));
+    vector< int32_t > barcode_offset(rule.output_segment_cardinality, 0);
+    for(const auto& transform : rule.transform_array) {
+        const int32_t input_segment_index(transform.token.input_segment_index);
+        if(input_segment_index < static_cast< int32_t >(segment_length.size())) {
+            const int32_t length(segment_length[input_segment_index]);
+            const int32_t start(transform.token.decode_start(length));
+            const int32_t end(transform.token.decode_end(length));
+            if(end > start) {
+                placement_array.emplace_back (
+                    input_segment_index,
+                    start,
+                    end - start,
+                    transform.output_segment_index,
+                    barcode_offset[transform.output_segment_index],
+                    transform.left == LeftTokenOperator::REVERSE_COMPLEMENT
+                );
+                barcode_offset[transform.output_segment_index] += end - start;
+            }
+        } else { throw ConfigurationError("token " + string(transform.token) + " references non existing synthetic segment"); }
+    }
+
+    for(const auto& barcode : barcode_array) {
+        for(size_t i(0); i < barcode.segment_cardinality(); ++i) {
+            if(i >= barcode_offset.size() || barcode[i].length != barcode_offset[i]) {
+                throw ConfigurationError (
+                    "barcode segment " + to_string(i) + " is " + to_string(barcode[i].length) +
+                    " nucleotides long but the synthetic segment layout provides " +
+                    (i < barcode_offset.size() ? to_string(barcode_offset[i]) : string("none"))
+                );
+            }
+        }
+    }
+
+    } catch(ConfigurationError& error) {
+        throw ConfigurationError("SyntheticCodec :: " + error.message);
+
+    } catch(exception& error) {
+        throw InternalError("SyntheticCodec :: " + string(error.what()));
+};
+
+SyntheticFeed::SyntheticFeed(const FeedProxy& proxy, const Value& ontology) try :
+    BufferedFeed< FastqRecord >(proxy),
+    _opened(false),
+    read_cardinality(1000000),
+    generated(0),
+    substitution_rate(0.01),
+    quality(36),
+    error_quality(12),
+    noise(-1),
+    uniform(0, 1) {
+
+    uint64_t seed(1);
+    segment_length.assign(_resolution, 100);
+    Value::ConstMemberIterator reference = ontology.FindMember("synthetic");
+    if(reference != ontology.MemberEnd() && reference->value.IsObject()) {
+        const Value& synthetic(reference->value);
+        decode_value_by_key< uint64_t >("reads", read_cardinality, synthetic);
+        decode_value_by_key< uint64_t >("seed", seed, synthetic);
+        decode_value_by_key< double >("substitution rate", substitution_rate, synthetic);
+        decode_value_by_key< double >("noise", noise, synthetic);
+        decode_value_by_key< int32_t >("quality", quality, synthetic);
+        decode_value_by_key< int32_t >("error quality", error_quality, synthetic);
+
+        int32_t read_length;
+        if(decode_value_by_key< int32_t >("read length", read_length, synthetic)) {
+            segment_length.assign(_resolution, read_length);
+        }
+        vector< int32_t > length_by_segment;
+        if(decode_value_by_key< vector< int32_t > >("segment length", length_by_segment, synthetic)) {
+            if(static_cast< int >(length_by_segment.size()) == _resolution) {
+                segment_length = length_by_segment;
+            } else {
+                throw ConfigurationError (
+                    to_string(length_by_segment.size()) + " synthetic segment lengths declared for " +
+                    to_string(_resolution) + " input segments"
+                );
+            }
+        }
+    }
+
+    if(substitution_rate < 0 || substitution_rate > 1) {
+        throw ConfigurationError("synthetic substitution rate " + to_string(substitution_rate) + " not between 0 and 1");
+    }
+    if(noise > 1) {
+        throw ConfigurationError("synthetic noise " + to_string(noise) + " not between 0 and 1");
+    }
+    if(quality < MIN_PHRED_VALUE || quality > MAX_PHRED_VALUE || error_quality < MIN_PHRED_VALUE || error_quality > MAX_PHRED_VALUE) {
+        throw ConfigurationError("synthetic quality out of range");
+    }
+    for(const auto& length : segment_length) {
+        if(length < 1) {
+            throw ConfigurationError("synthetic segment length must be positive");
+        }
+    }
+
+    generator.seed(seed);
+    load_codec(ontology, "multiplex");
+    load_codec(ontology, "cellular");
+    barcode_index_by_codec.resize(codec_array.size());
+
+    } catch(ConfigurationError& error) {
+        throw ConfigurationError("SyntheticFeed :: " + error.message);
+
+    } catch(exception& error) {
+        throw InternalError("SyntheticFeed :: " + string(error.what()));
+};
+static inline bool has_codec(const Value& decoder) {
+    if(decoder.IsObject()) {
+        Value::ConstMemberIterator reference = decoder.FindMember("codec");
+        return reference != decoder.MemberEnd() && reference->value.IsObject();
+    }
+    return false;
+};
+void SyntheticFeed::load_codec(const Value& ontology, const Value::Ch* key) {
+    Value::ConstMemberIterator reference = ontology.FindMember(key);
+    if(reference != ontology.MemberEnd()) {
+        if(reference->value.IsObject()) {
+            if(has_codec(reference->value)) {
+                codec_array.emplace_back(reference->value, segment_length, noise);
+            }
+
+        } else if(reference->value.IsArray()) {
+            for(const auto& element : reference->value.GetArray()) {
+                if(has_codec(element)) {
+                    codec_array.emplace_back(element, segment_length, noise);
+                }
+            }
+        }
+    }
+};
+void SyntheticFeed::generate() {
+    size_t codec_index(0);
+    for(const auto& codec : codec_array) {
+        barcode_index_by_codec[codec_index] = codec.draw(uniform(generator));
+        ++codec_index;
+    }
+
+    /*  every segment of the template is written to a consecutive vacant buffer record.
+        The buffer capacity is aligned to the feed resolution so a template never wraps */
+    for(int32_t segment_index(0); segment_index < _resolution; ++segment_index) {
+        FastqRecord* record(buffer->vacant());
+        const int32_t length(segment_length[segment_index]);
+
+        ks_clear(record->name);
+        ks_clear(record->comment);
+        ks_clear(record->sequence);
+        ks_clear(record->quality);
+        ks_put_string("synthetic:" + to_string(generated), record->name);
+
+        ks_increase_to_size(record->sequence, length + 2);
+        ks_increase_to_size(record->quality, length + 2);
+        uint8_t* code(reinterpret_cast< uint8_t* >(record->sequence.s));
+        uint8_t* phred(reinterpret_cast< uint8_t* >(record->quality.s));
+        for(int32_t i(0); i < length; ++i) {
+            code[i] = random_nucleotide();
+            phred[i] = high_quality();
+        }
+
+        codec_index = 0;
+        for(const auto& codec : codec_array) {
+            const int32_t barcode_index(barcode_index_by_codec[codec_index]);
+            if(barcode_index >= 0) {
+                const Barcode& barcode(codec.barcode_array[barcode_index]);
+                for(const auto& placement : codec.placement_array) {
+                    if(placement.input_segment_index == segment_index) {
+                        const uint8_t* expected(barcode[placement.barcode_segment_index].code + placement.barcode_offset);
+                        for(int32_t i(0); i < placement.length; ++i) {
+                            uint8_t nucleotide(placement.reverse_complement ?
+                                BamToReverseComplementBam[expected[placement.length - i - 1]] :
+                                expected[i]);
+                            if(uniform(generator) < substitution_rate) {
+                                code[placement.start + i] = substitute_nucleotide(nucleotide);
+                                phred[placement.start + i] = low_quality();
+                            } else {
+                                code[placement.start + i] = nucleotide;
+                            }
+                        }
+                    }
+                }
+            }
+            ++codec_index;
+        }
+
+        record->sequence.l = length;
+        record->sequence.s[length] = '\0';
+        record->quality.l = length;
+        record->quality.s[length] = '\0';
+        buffer->increment();
+    }
+};
@@ -0,0 +1,144 @@
+/*
+    Pheniqs : PHilology ENcoder wIth Quality Statistics
+    Copyright (C) 2018  Lior Galanti
+    NYU Center for Genetics and System Biology
+
+    Author: Lior Galanti <lior.galanti@nyu.edu>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PHENIQS_SYNTHETIC_H
+#define PHENIQS_SYNTHETIC_H
+
+#include "include.h"
+#include "fastq.h"
+#include "transform.h"
+#include "barcode.h"
+
+/*  A stretch of an input segment that carries part of a barcode segment */
+class SyntheticPlacement {
+    public:
+        const int32_t input_segment_index;
+        const int32_t start;
+        const int32_t length;
+        const int32_t barcode_segment_index;
+        const int32_t barcode_offset;
+        const bool reverse_complement;
+        SyntheticPlacement(
+            const int32_t& input_segment_index,
+            const int32_t& start,
+            const int32_t& length,
+            const int32_t& barcode_segment_index,
+            const int32_t& barcode_offset,
+            const bool& reverse_complement) :
+
+            input_segment_index(input_segment_index),
+            start(start),
+            length(length),
+            barcode_segment_index(barcode_segment_index),
+            barcode_offset(barcode_offset),
+            reverse_complement(reverse_complement) {
+        };
+};
+
+/*  Barcodes of a single decoder and where they are embedded in the input segments */
+class SyntheticCodec {
+    public:
+        const vector< Barcode > barcode_array;
+        vector< double > cumulative_concentration;
+        vector< SyntheticPlacement > placement_array;
+        SyntheticCodec(const Value& ontology, const vector< int32_t >& segment_length, const double& noise);
+        /*  index of the barcode at cumulative probability p, -1 for noise */
+        inline int32_t draw(const double& p) const {
+            auto position(upper_bound(cumulative_concentration.begin(), cumulative_concentration.end(), p));
+            if(position != cumulative_concentration.end()) {
+                return static_cast< int32_t >(position - cumulative_concentration.begin());
+            } else {
+                return -1;
+            }
+        };
+};
+
+/*  Input feed that generates reads on the fly from the configured codecs.
+    Selected by declaring /dev/synthetic as the path of every input segment.
+    Reads are generated on the feed thread into the same FastqRecord buffers
+    used by FastqFeed so the pivots see an identical pipeline without any disk IO.
+*/
+class SyntheticFeed : public BufferedFeed< FastqRecord > {
+    public:
+        SyntheticFeed(const FeedProxy& proxy, const Value& ontology);
+        void open() override {
+            _opened = true;
+        };
+        void close() override {
+            _opened = false;
+        };
+        inline bool opened() override {
+            return _opened;
+        };
+
+    protected:
+        inline void encode(FastqRecord* record, const Segment& segment) const override {
+        };
+        inline void decode(const FastqRecord* record, Segment& segment) override {
+            record->encode(segment);
+        };
+        inline void replenish_buffer() override {
+            while(opened() && buffer->is_not_full()) {
+                if(generated < read_cardinality) {
+                    generate();
+                    ++generated;
+                } else {
+                    close();
+                }
+            }
+        };
+        inline void flush_buffer() override {
+        };
+
+    private:
+        bool _opened;
+        uint64_t read_cardinality;
+        uint64_t generated;
+        double substitution_rate;
+        int32_t quality;
+        int32_t error_quality;
+        double noise;
+        vector< int32_t > segment_length;
+        list< SyntheticCodec > codec_array;
+        vector< int32_t > barcode_index_by_codec;
+        mt19937_64 generator;
+        uniform_real_distribution< double > uniform;
+        void load_codec(const Value& ontology, const Value::Ch* key);
+        void generate();
+        inline uint8_t random_nucleotide() {
+            return static_cast< uint8_t >(1 << (generator() & 3));
+        };
+        inline uint8_t substitute_nucleotide(const uint8_t& nucleotide) {
+            uint8_t result;
+            do {
+                result = random_nucleotide();
+            } while(result == nucleotide);
+            return result;
+        };
+        inline uint8_t high_quality() {
+            return static_cast< uint8_t >(max(static_cast< int32_t >(MIN_PHRED_VALUE), quality - 4 + static_cast< int32_t >(generator() % 9)));
+        };
+        inline uint8_t low_quality() {
+            return static_cast< uint8_t >(MIN_PHRED_VALUE + generator() % (max(error_quality - MIN_PHRED_VALUE, 0) + 1));
+        };
+};
+
+#endif /* PHENIQS_SYNTHETIC_H */
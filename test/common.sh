@@ -0,0 +1,91 @@
+#!/usr/bin/env sh
+
+# Pheniqs : PHilology ENcoder wIth Quality Statistics
+# Copyright (C) 2018  Lior Galanti
+# NYU Center for Genetics and System Biology
+
+# Author: Lior Galanti <lior.galanti@nyu.edu>
+
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Affero General Public License as
+# published by the Free Software Foundation, either version 3 of the
+# License, or (at your option) any later version.
+
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Affero General Public License for more details.
+
+# You should have received a copy of the GNU Affero General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# Shared helpers for the regression tests, sourced by every test script.
+# PHENIQS points to the executable under test and defaults to the one built in the repository root.
+
+set -eu
+
+TEST_HOME="$(cd "$(dirname "$0")" && pwd)"
+PHENIQS="${PHENIQS:-$TEST_HOME/../pheniqs}"
+WORKSPACE="$(mktemp -d "${TMPDIR:-/tmp}/pheniqs-test.XXXXXX")"
+trap 'rm -rf "$WORKSPACE"' EXIT
+
+fail() {
+    printf '%s : %s\n' "$(basename "$0")" "$*" >&2
+    exit 1
+}
+
+# Convert the BDGGG fixtures to BGZF compressed BAM files, which sharding and seeking require.
+# The fixtures are plain gzip, which can only be read sequentially.
+BDGGG_INPUT="--input $WORKSPACE/BDGGG_s01.bam --input $WORKSPACE/BDGGG_s02.bam --input $WORKSPACE/BDGGG_s03.bam"
+prepare_bdggg() {
+    for segment in 01 02 03; do
+        "$PHENIQS" demux \
+        --input "$TEST_HOME/BDGGG/BDGGG_s$segment.fastq.gz" \
+        --output "$WORKSPACE/BDGGG_s$segment.bam" \
+        2> /dev/null || fail "failed to convert BDGGG_s$segment.fastq.gz"
+    done
+}
+
+# Compare the input and output quality control sections of two reports.
+# Floating point values may differ in the last digits when accumulated in a different order.
+compare_report() {
+    python3 - "$1" "$2" << 'PYTHON' || fail "report $2 does not match $1"
+import json
+import math
+import sys
+
+def compare(left, right, path):
+    if isinstance(left, dict) and isinstance(right, dict):
+        if set(left) != set(right):
+            raise ValueError('{} keys differ'.format(path))
+        for key in left:
+            compare(left[key], right[key], path + '/' + key)
+    elif isinstance(left, list) and isinstance(right, list):
+        if len(left) != len(right):
+            raise ValueError('{} lengths differ'.format(path))
+        for index, pair in enumerate(zip(left, right)):
+            compare(pair[0], pair[1], '{}/{}'.format(path, index))
+    elif isinstance(left, float) or isinstance(right, float):
+        if not math.isclose(left, right, rel_tol=1e-9, abs_tol=1e-12):
+            raise ValueError('{} {} != {}'.format(path, left, right))
+    elif left != right:
+        raise ValueError('{} {} != {}'.format(path, left, right))
+
+try:
+    with open(sys.argv[1]) as file:
+        expected = json.load(file)
+    with open(sys.argv[2]) as file:
+        observed = json.load(file)
+    for key in ('demultiplex input report', 'demultiplex output report'):
+        compare(expected[key], observed[key], key)
+except (KeyError, OSError, ValueError) as error:
+    sys.stderr.write('{}\n'.format(error))
+    sys.exit(1)
+PYTHON
+}
+
+# Print the records of SAM files, without the header, in a canonical order
+# so output written by several decoding threads can be compared
+sorted_sam_records() {
+    cat "$@" | grep -v '^@' | LC_ALL=C sort
+}
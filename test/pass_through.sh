@@ -0,0 +1,97 @@
+#!/usr/bin/env sh
+
+# Pheniqs : PHilology ENcoder wIth Quality Statistics
+# Copyright (C) 2018  Lior Galanti
+# NYU Center for Genetics and System Biology
+
+# Author: Lior Galanti <lior.galanti@nyu.edu>
+
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Affero General Public License as
+# published by the Free Software Foundation, either version 3 of the
+# License, or (at your option) any later version.
+
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Affero General Public License for more details.
+
+# You should have received a copy of the GNU Affero General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# Decode the BDGGG fixtures through the pipe decoder with quality control, which decodes every record,
+# and again without quality control, which forwards the records without decoding them.
+# Forwarded FASTQ records must carry the same identifier, sequence and quality as the decoded ones,
+# from a compressed stream and from a memory mapped file, and forwarded BAM records must be written
+# exactly as the decoded records are encoded.
+
+. "$(dirname "$0")/common.sh"
+
+# Print the identifier, sequence and quality of every record in FASTQ files in a canonical order.
+# The comment of a forwarded record is written as it was read.
+sorted_fastq_records() {
+    awk 'NR % 4 == 1 { name = $1 } NR % 4 == 2 { sequence = $0 } NR % 4 == 0 { print name, sequence, $0 }' "$@" | LC_ALL=C sort
+}
+
+forwarded_count() {
+    python3 -c 'import json, sys; print(json.load(open(sys.argv[1])).get("pass through", {}).get("count", 0))' "$1"
+}
+
+for segment in 01 02 03; do
+    original="$TEST_HOME/BDGGG/BDGGG_s$segment.fastq.gz"
+
+    "$PHENIQS" demux \
+    --input "$original" \
+    --output "$WORKSPACE/baseline_s$segment.fastq" \
+    2> "$WORKSPACE/baseline_s$segment.json" || fail "failed to decode BDGGG_s$segment.fastq.gz"
+
+    "$PHENIQS" demux \
+    --quality \
+    --input "$original" \
+    --output "$WORKSPACE/forwarded_s$segment.fastq" \
+    2> "$WORKSPACE/forwarded_s$segment.json" || fail "failed to forward BDGGG_s$segment.fastq.gz"
+
+    "$PHENIQS" demux \
+    --quality \
+    --mmap \
+    --input "$WORKSPACE/baseline_s$segment.fastq" \
+    --output "$WORKSPACE/mapped_s$segment.fastq" \
+    2> "$WORKSPACE/mapped_s$segment.json" || fail "failed to forward the memory mapped BDGGG_s$segment.fastq"
+
+    [ "$(forwarded_count "$WORKSPACE/baseline_s$segment.json")" -eq 0 ] || fail "BDGGG_s$segment was forwarded with quality control"
+    [ "$(forwarded_count "$WORKSPACE/forwarded_s$segment.json")" -gt 0 ] || fail "BDGGG_s$segment.fastq.gz was not forwarded"
+    [ "$(forwarded_count "$WORKSPACE/mapped_s$segment.json")" -gt 0 ] || fail "the memory mapped BDGGG_s$segment.fastq was not forwarded"
+
+    sorted_fastq_records "$WORKSPACE/baseline_s$segment.fastq" > "$WORKSPACE/baseline_s$segment.records"
+    sorted_fastq_records "$WORKSPACE/forwarded_s$segment.fastq" > "$WORKSPACE/forwarded_s$segment.records"
+    sorted_fastq_records "$WORKSPACE/mapped_s$segment.fastq" > "$WORKSPACE/mapped_s$segment.records"
+    [ -s "$WORKSPACE/baseline_s$segment.records" ] || fail "BDGGG_s$segment produced no reads"
+    cmp -s "$WORKSPACE/baseline_s$segment.records" "$WORKSPACE/forwarded_s$segment.records" || fail "forwarded BDGGG_s$segment.fastq.gz does not match the decoded reads"
+    cmp -s "$WORKSPACE/baseline_s$segment.records" "$WORKSPACE/mapped_s$segment.records" || fail "forwarded memory mapped BDGGG_s$segment.fastq does not match the decoded reads"
+done
+
+prepare_bdggg
+
+run() {
+    prefix="$1"
+    shift
+    "$PHENIQS" demux \
+    $BDGGG_INPUT \
+    --output "$WORKSPACE/${prefix}_s01.sam" \
+    --output "$WORKSPACE/${prefix}_s02.sam" \
+    --output "$WORKSPACE/${prefix}_s03.sam" \
+    "$@" \
+    2> "$WORKSPACE/$prefix.json"
+}
+
+run baseline || fail "failed to decode the BDGGG BAM files"
+run forwarded --quality || fail "failed to forward the BDGGG BAM files"
+
+[ "$(forwarded_count "$WORKSPACE/forwarded.json")" -gt 0 ] || fail "the BDGGG BAM files were not forwarded"
+
+for segment in 01 02 03; do
+    sorted_sam_records "$WORKSPACE/baseline_s$segment.sam" > "$WORKSPACE/baseline_s$segment.sam.records"
+    sorted_sam_records "$WORKSPACE/forwarded_s$segment.sam" > "$WORKSPACE/forwarded_s$segment.sam.records"
+    [ -s "$WORKSPACE/baseline_s$segment.sam.records" ] || fail "BDGGG_s$segment.bam produced no reads"
+    cmp -s "$WORKSPACE/baseline_s$segment.sam.records" "$WORKSPACE/forwarded_s$segment.sam.records" || fail "forwarded BDGGG_s$segment.bam does not match the encoded records"
+done
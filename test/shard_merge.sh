@@ -0,0 +1,54 @@
+#!/usr/bin/env sh
+
+# Pheniqs : PHilology ENcoder wIth Quality Statistics
+# Copyright (C) 2018  Lior Galanti
+# NYU Center for Genetics and System Biology
+
+# Author: Lior Galanti <lior.galanti@nyu.edu>
+
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Affero General Public License as
+# published by the Free Software Foundation, either version 3 of the
+# License, or (at your option) any later version.
+
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Affero General Public License for more details.
+
+# You should have received a copy of the GNU Affero General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# Decode the BDGGG fixture in a single run and again split into two shards.
+# The merged shard report must match the report of the single run,
+# and the shard outputs together must hold exactly the reads of the single run.
+
+. "$(dirname "$0")/common.sh"
+
+prepare_bdggg
+
+run() {
+    "$PHENIQS" demux \
+    --config "$TEST_HOME/BDGGG/BDGGG_annotated.json" \
+    --base-input "$WORKSPACE" \
+    --base-output "$WORKSPACE" \
+    $BDGGG_INPUT \
+    --output "$WORKSPACE/BDGGG.sam" \
+    --mergeable \
+    "$@"
+}
+
+run 2> "$WORKSPACE/single.json" || fail "single run failed"
+run --shard 1/2 2> "$WORKSPACE/shard1.json" || fail "shard 1/2 failed"
+run --shard 2/2 2> "$WORKSPACE/shard2.json" || fail "shard 2/2 failed"
+
+"$PHENIQS" merge \
+--report "$WORKSPACE/shard1.json" \
+--report "$WORKSPACE/shard2.json" \
+> "$WORKSPACE/merged.json" || fail "merge failed"
+
+compare_report "$WORKSPACE/single.json" "$WORKSPACE/merged.json"
+
+sorted_sam_records "$WORKSPACE/BDGGG.sam" > "$WORKSPACE/single.records"
+sorted_sam_records "$WORKSPACE/BDGGG_shard1of2.sam" "$WORKSPACE/BDGGG_shard2of2.sam" > "$WORKSPACE/sharded.records"
+cmp -s "$WORKSPACE/single.records" "$WORKSPACE/sharded.records" || fail "sharded output does not match the single run"
@@ -0,0 +1,53 @@
+#!/usr/bin/env sh
+
+# Pheniqs : PHilology ENcoder wIth Quality Statistics
+# Copyright (C) 2018  Lior Galanti
+# NYU Center for Genetics and System Biology
+
+# Author: Lior Galanti <lior.galanti@nyu.edu>
+
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Affero General Public License as
+# published by the Free Software Foundation, either version 3 of the
+# License, or (at your option) any later version.
+
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Affero General Public License for more details.
+
+# You should have received a copy of the GNU Affero General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# Compress every BDGGG segment to zstd and decompress it again.
+# The zstd files must be zstd frames and reading them back must yield exactly
+# the reads written from the original fixtures. Several compression threads
+# exercise the zstd worker threads of the writer.
+
+. "$(dirname "$0")/common.sh"
+
+for segment in 01 02 03; do
+    original="$TEST_HOME/BDGGG/BDGGG_s$segment.fastq.gz"
+
+    "$PHENIQS" demux \
+    --input "$original" \
+    --output "$WORKSPACE/expected_s$segment.fastq" \
+    2> /dev/null || fail "failed to decompress BDGGG_s$segment.fastq.gz"
+
+    "$PHENIQS" demux \
+    --threads 4 \
+    --input "$original" \
+    --output "$WORKSPACE/BDGGG_s$segment.fastq.zst" \
+    2> /dev/null || fail "failed to compress BDGGG_s$segment.fastq.gz with zstd"
+
+    magic="$(od -An -tx1 -N4 "$WORKSPACE/BDGGG_s$segment.fastq.zst" | tr -d ' \n')"
+    [ "$magic" = "28b52ffd" ] || fail "BDGGG_s$segment.fastq.zst is not zstd compressed"
+
+    "$PHENIQS" demux \
+    --input "$WORKSPACE/BDGGG_s$segment.fastq.zst" \
+    --output "$WORKSPACE/observed_s$segment.fastq" \
+    2> /dev/null || fail "failed to read BDGGG_s$segment.fastq.zst"
+
+    [ -s "$WORKSPACE/expected_s$segment.fastq" ] || fail "BDGGG_s$segment produced no reads"
+    cmp -s "$WORKSPACE/expected_s$segment.fastq" "$WORKSPACE/observed_s$segment.fastq" || fail "BDGGG_s$segment does not survive a zstd round trip"
+done
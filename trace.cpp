@@ -0,0 +1,144 @@
+/*
+    Pheniqs : PHilology ENcoder wIth Quality Statistics
+    Copyright (C) 2018  Lior Galanti
+    NYU Center for Genetics and System Biology
+
+    Author: Lior Galanti <lior.galanti@nyu.edu>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "trace.h"
+
+TraceSink::TraceSink(const URL& url) try :
+    url(url),
+    tsv(url.extension() == "tsv"),
+    closing(false),
+    kbuffer({ 0, 0, NULL }),
+    _count(0) {
+
+    ks_terminate(kbuffer);
+
+    } catch(ConfigurationError& error) {
+        throw ConfigurationError("TraceSink :: " + error.message);
+
+    } catch(exception& error) {
+        throw InternalError("TraceSink :: " + string(error.what()));
+};
+TraceSink::~TraceSink() {
+    if(writer_thread.joinable()) {
+        {
+            lock_guard< mutex > queue_lock(queue_mutex);
+            closing = true;
+            queue_not_empty.notify_one();
+        }
+        writer_thread.join();
+    }
+    ks_free(kbuffer);
+};
+void TraceSink::open() {
+    if(url.is_writable()) {
+        file.open(url.path(), ios_base::out | ios_base::trunc | ios_base::binary);
+    }
+    if(file.is_open()) {
+        if(tsv) {
+            file << "read\tchannel\tdistance\tconfidence\tbarcode" << endl;
+
+        } else {
+            const uint32_t version(TRACE_FORMAT_VERSION);
+            const uint32_t record_size(sizeof(TraceRecord));
+            file.write(TRACE_MAGIC, sizeof(TRACE_MAGIC));
+            file.write(reinterpret_cast< const char* >(&version), sizeof(version));
+            file.write(reinterpret_cast< const char* >(&record_size), sizeof(record_size));
+        }
+        writer_thread = thread(&TraceSink::run, this);
+
+    } else { throw IOError("could not open " + string(url) + " for writing"); }
+};
+void TraceSink::close() {
+    {
+        lock_guard< mutex > queue_lock(queue_mutex);
+        closing = true;
+        queue_not_empty.notify_one();
+    }
+    if(writer_thread.joinable()) {
+        writer_thread.join();
+    }
+    if(file.is_open()) {
+        file.close();
+        if(file.fail()) {
+            throw IOError("failed writing trace to " + string(url));
+        }
+    }
+};
+void TraceSink::submit(vector< TraceRecord >& buffer) {
+    unique_lock< mutex > queue_lock(queue_mutex);
+    queue_not_full.wait(queue_lock, [this]() { return queue.size() < TRACE_QUEUE_CAPACITY; });
+
+    queue.emplace_back();
+    queue.back().swap(buffer);
+    if(!vacant.empty()) {
+        buffer.swap(vacant.front());
+        vacant.pop_front();
+    } else {
+        buffer.reserve(TRACE_BUFFER_CAPACITY);
+    }
+    queue_not_empty.notify_one();
+};
+void TraceSink::run() {
+    vector< TraceRecord > records;
+    unique_lock< mutex > queue_lock(queue_mutex);
+    while(true) {
+        queue_not_empty.wait(queue_lock, [this]() { return !queue.empty() || closing; });
+        if(!queue.empty()) {
+            records.swap(queue.front());
+            queue.pop_front();
+            queue_not_full.notify_all();
+
+            /* write outside the lock so pivots can keep submitting */
+            queue_lock.unlock();
+            write(records);
+            records.clear();
+            queue_lock.lock();
+
+            vacant.emplace_back();
+            vacant.back().swap(records);
+
+        } else { break; }
+    }
+};
+void TraceSink::write(const vector< TraceRecord >& buffer) {
+    if(tsv) {
+        ks_clear(kbuffer);
+        for(const auto& record : buffer) {
+            ks_put_string(to_string(record.read), kbuffer);
+            ks_put_character('\t', kbuffer);
+            ks_put_string(to_string(record.channel), kbuffer);
+            ks_put_character('\t', kbuffer);
+            ks_put_uint32(record.distance, kbuffer);
+            ks_put_character('\t', kbuffer);
+            ks_put_string(to_string(record.confidence), kbuffer);
+            ks_put_character('\t', kbuffer);
+            for(uint16_t i(0); i < record.length; ++i) {
+                ks_put_character(BamToAmbiguousAscii[record.nucleotide(i)], kbuffer);
+            }
+            ks_put_character('\n', kbuffer);
+        }
+        file.write(kbuffer.s, kbuffer.l);
+
+    } else {
+        file.write(reinterpret_cast< const char* >(buffer.data()), buffer.size() * sizeof(TraceRecord));
+    }
+    _count += buffer.size();
+};
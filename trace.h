@@ -0,0 +1,111 @@
+/*
+    Pheniqs : PHilology ENcoder wIth Quality Statistics
+    Copyright (C) 2018  Lior Galanti
+    NYU Center for Genetics and System Biology
+
+    Author: Lior Galanti <lior.galanti@nyu.edu>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PHENIQS_TRACE_H
+#define PHENIQS_TRACE_H
+
+#include "include.h"
+#include "url.h"
+#include "read.h"
+
+#define TRACE_MAGIC "PHNQTRC"
+#define TRACE_FORMAT_VERSION 1
+#define TRACE_BARCODE_CAPACITY 64
+#define TRACE_BUFFER_CAPACITY 16384
+#define TRACE_QUEUE_CAPACITY 64
+
+/*  Fixed width decoding trace record.
+    The raw multiplex barcode is packed as 4 bit BAM nucleotide codes, two per byte,
+    high nibble first, truncated at TRACE_BARCODE_CAPACITY nucleotides.
+    The binary trace file is a 16 byte header, the 8 byte TRACE_MAGIC, a uint32_t format version
+    and a uint32_t record size, followed by records in host byte order.
+*/
+class TraceRecord {
+    public:
+        uint64_t read;
+        int32_t channel;
+        uint32_t distance;
+        float confidence;
+        uint16_t length;
+        uint8_t reserved[2];
+        uint8_t barcode[TRACE_BARCODE_CAPACITY / 2];
+        inline void encode(const uint64_t& ordinal, const int32_t& index, const Read& output) {
+            read = ordinal;
+            channel = index;
+            distance = output.multiplex_distance;
+            confidence = static_cast< float >(output.multiplex_decoding_confidence);
+            reserved[0] = 0;
+            reserved[1] = 0;
+            memset(barcode, 0, TRACE_BARCODE_CAPACITY / 2);
+
+            const kstring_t& BC(output.auxiliary().BC);
+            length = 0;
+            for(size_t i(0); i < BC.l && length < TRACE_BARCODE_CAPACITY; ++i) {
+                if(BC.s[i] != '-') {
+                    uint8_t code(AsciiToAmbiguousBam[static_cast< uint8_t >(BC.s[i])]);
+                    barcode[length >> 1] |= (length & 1) ? code : code << 4;
+                    ++length;
+                }
+            }
+        };
+        inline uint8_t nucleotide(const uint16_t& position) const {
+            return (position & 1) ? barcode[position >> 1] & 0xf : barcode[position >> 1] >> 4;
+        };
+};
+static_assert(sizeof(TraceRecord) == 56, "unexpected trace record size");
+
+/*  Asynchronous decoding trace writer.
+    Pivots fill private record buffers and hand full buffers over with submit,
+    receiving a recycled empty buffer in exchange. A dedicated thread writes the buffers
+    in the order they were submitted so records from different pivots are interleaved.
+*/
+class TraceSink {
+    TraceSink(TraceSink const &) = delete;
+    void operator=(TraceSink const &) = delete;
+
+    public:
+        const URL url;
+        const bool tsv;
+        TraceSink(const URL& url);
+        ~TraceSink();
+        void open();
+        void close();
+        void submit(vector< TraceRecord >& buffer);
+        inline uint64_t count() const {
+            return _count;
+        };
+
+    private:
+        ofstream file;
+        bool closing;
+        thread writer_thread;
+        mutex queue_mutex;
+        condition_variable queue_not_empty;
+        condition_variable queue_not_full;
+        list< vector< TraceRecord > > queue;
+        list< vector< TraceRecord > > vacant;
+        kstring_t kbuffer;
+        uint64_t _count;
+        void run();
+        void write(const vector< TraceRecord >& buffer);
+};
+
+#endif /* PHENIQS_TRACE_H */
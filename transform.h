@@ -71,6 +71,9 @@ class Token {
         inline bool empty() const {
             return (end_terminated && start >= end) && ((start >= 0 && end >= 0) || (start < 0 && end < 0));
         };
+        inline bool whole() const {
+            return start == 0 && !end_terminated;
+        };
         inline bool constant() const {
             if(end_terminated) {
                return (start >= 0 && end >= 0) || (start < 0 && end < 0);
@@ -145,13 +148,39 @@ class Rule {
         };
         inline void apply(const Read& source, Observation& target) const {
             for(auto& transform : transform_array ) {
-                const Segment& from = source[transform.token.input_segment_index];
-                ObservedSequence& to = target[transform.output_segment_index];
-                const int32_t start(transform.token.decode_start(from.length));
-                const int32_t end(transform.token.decode_end(from.length));
-                const int32_t size(end - start);
-                if(size > 0) {
-                    to.increase_by_size(size);
+                append_token(transform, source[transform.token.input_segment_index], target[transform.output_segment_index]);
+            }
+        };
+
+    protected:
+        /*  append the token of an input segment to an output sequence.
+            A segment that was not unpacked is read directly from the 4 bit packed sequence of its record */
+        inline void append_token(const EmbeddedToken& transform, const Segment& from, ObservedSequence& to) const {
+            const int32_t start(transform.token.decode_start(from.length));
+            const int32_t end(transform.token.decode_end(from.length));
+            const int32_t size(end - start);
+            if(size > 0) {
+                to.increase_by_size(size);
+                if(from.packed()) {
+                    const uint8_t* code(bam_get_seq(from.record));
+                    const uint8_t* quality(bam_get_qual(from.record));
+                    switch (transform.left) {
+                        case LeftTokenOperator::NONE: {
+                            for(int32_t i(0); i < size; ++i) {
+                                to.code[to.length + i] = bam_seqi(code, start + i);
+                            }
+                            memcpy(to.quality + to.length, quality + start, size);
+                            break;
+                        };
+                        case LeftTokenOperator::REVERSE_COMPLEMENT: {
+                            for(int32_t i(0); i < size; ++i) {
+                                to.code[to.length + i] = BamToReverseComplementBam[bam_seqi(code, end - i - 1)];
+                                to.quality[to.length + i] = quality[end - i - 1];
+                            }
+                            break;
+                        };
+                    }
+                } else {
                     switch (transform.left) {
                         case LeftTokenOperator::NONE: {
                             memcpy(to.code + to.length, from.code + start, size);
@@ -166,9 +195,9 @@ class Rule {
                             break;
                         };
                     }
-                    to.length += size;
-                    to.terminate();
                 }
+                to.length += size;
+                to.terminate();
             }
         };
 };
@@ -190,33 +219,27 @@ class TemplateRule : public Rule {
         };
         ~TemplateRule() override {
 
+        };
+        /*  every output segment is an unmodified copy of the input segment at the same position */
+        inline bool identity(const int32_t& input_segment_cardinality) const {
+            if(output_segment_cardinality != input_segment_cardinality || static_cast< int32_t >(transform_array.size()) != output_segment_cardinality) {
+                return false;
+            }
+            int32_t index(0);
+            for(auto& transform : transform_array) {
+                if(
+                    transform.output_segment_index != index ||
+                    transform.token.input_segment_index != index ||
+                    transform.left != LeftTokenOperator::NONE ||
+                    !transform.token.whole()
+                ) { return false; }
+                ++index;
+            }
+            return true;
         };
         inline void apply(const Read& source, Read& target) const {
             for(auto& transform : transform_array ) {
-                const Segment& from = source[transform.token.input_segment_index];
-                Segment& to = target[transform.output_segment_index];
-                const int32_t start(transform.token.decode_start(from.length));
-                const int32_t end(transform.token.decode_end(from.length));
-                const int32_t size(end - start);
-                if(size > 0) {
-                    to.increase_by_size(size);
-                    switch (transform.left) {
-                        case LeftTokenOperator::NONE: {
-                            memcpy(to.code + to.length, from.code + start, size);
-                            memcpy(to.quality + to.length, from.quality + start, size);
-                            break;
-                        };
-                        case LeftTokenOperator::REVERSE_COMPLEMENT: {
-                            for(int32_t i(0); i < size; ++i) {
-                                to.code[to.length + i] = BamToReverseComplementBam[from.code[end - i - 1]];
-                                to.quality[to.length + i] = from.quality[end - i - 1];
-                            }
-                            break;
-                        };
-                    }
-                    to.length += size;
-                    to.terminate();
-                }
+                append_token(transform, source[transform.token.input_segment_index], target[transform.output_segment_index]);
             }
 
             /* assign the pivot qc_fail flag from the leader */
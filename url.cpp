@@ -308,7 +308,7 @@ void URL::parse_file(const string& path) {
 
                     // if there is a second extension
                     // and the first is a compression marker
-                    if(_extension == "gz" || _extension == "bz2" || _extension == "xz") {
+                    if(_extension == "gz" || _extension == "bz2" || _extension == "xz" || _extension == "zst") {
                         position = _basename.find_last_of(EXTENSION_SEPARATOR);
                         if(position != string::npos) {
                             _compression.assign(_extension);
@@ -387,7 +387,7 @@ void URL::relocate_sibling(const URL& base) {
     }
 };
 bool URL::is_readable() const {
-    if(is_stdin()) {
+    if(is_stdin() || is_synthetic()) {
         return true;
     } else if(is_stdout() || is_stderr() || is_dev_null()) {
         return false;
@@ -396,7 +396,7 @@ bool URL::is_readable() const {
     }
 };
 bool URL::is_writable() const {
-    if(is_stdin()) {
+    if(is_stdin() || is_synthetic()) {
         return false;
     } else if(is_stdout() || is_stderr() || is_dev_null()) {
         return true;
@@ -594,7 +594,7 @@ template<> bool decode_value_by_key< list< URL > >(const Value::Ch* key, list< U
 };
 
 void encode_value(const URL& value, Value& container, Document& document) {
-    if(value.is_standard_stream() && !value.is_dev_null()) {
+    if(value.is_standard_stream() && !value.is_dev_null() && !value.is_synthetic()) {
         container.SetObject();
         encode_key_value("path", value.path(), container, document);
         encode_key_value("type", value.type(), container, document);
@@ -681,3 +681,15 @@ void relocate_url_array_by_key(const Value::Ch* key, Value& container, Document&
     }
     encode_key_value(key, value, container, document);
 };
+void suffix_url_array_by_key(const Value::Ch* key, Value& container, Document& document, const string& suffix) {
+    /* append a suffix to the basename of every file in the array, standard streams are left untouched */
+    list< URL > value;
+    if(decode_value_by_key< list< URL > >(key, value, container)) {
+        for(auto& url : value) {
+            if(!url.is_standard_stream()) {
+                url.set_basename(url.basename() + suffix);
+            }
+        }
+        encode_key_value(key, value, container, document);
+    }
+};
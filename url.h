@@ -30,6 +30,7 @@
 #define CANONICAL_STDOUT_PATH "/dev/stdout"
 #define CANONICAL_STDERR_PATH "/dev/stderr"
 #define CANONICAL_NULL_DEVICE_PATH "/dev/null"
+#define CANONICAL_SYNTHETIC_DEVICE_PATH "/dev/synthetic"
 const char PATH_SEPARATOR('/');
 const char EXTENSION_SEPARATOR('.');
 
@@ -127,8 +128,11 @@ class URL {
         inline bool is_dev_null() const {
             return _path == CANONICAL_NULL_DEVICE_PATH;
         };
+        inline bool is_synthetic() const {
+            return _path == CANONICAL_SYNTHETIC_DEVICE_PATH;
+        };
         inline bool is_standard_stream() const {
-            return is_stdin() || is_stdout() || is_stderr() || is_dev_null();
+            return is_stdin() || is_stdout() || is_stderr() || is_dev_null() || is_synthetic();
         };
         inline bool is_absolute() const {
             return !_dirname.empty() && _dirname[0] == PATH_SEPARATOR;
@@ -187,5 +191,6 @@ void expand_url_value(Value& container, Document& document, const IoDirection& d
 void expand_url_value_by_key(const Value::Ch* key, Value& container, Document& document, const IoDirection& direction=IoDirection::UNKNOWN);
 void expand_url_array_by_key(const Value::Ch* key, Value& container, Document& document, const IoDirection& direction=IoDirection::UNKNOWN);
 void relocate_url_array_by_key(const Value::Ch* key, Value& container, Document& document, const URL& base);
+void suffix_url_array_by_key(const Value::Ch* key, Value& container, Document& document, const string& suffix);
 
 #endif /* PHENIQS_URL_H */
@@ -0,0 +1,520 @@
+/*
+    Pheniqs : PHilology ENcoder wIth Quality Statistics
+    Copyright (C) 2018  Lior Galanti
+    NYU Center for Genetics and System Biology
+
+    Author: Lior Galanti <lior.galanti@nyu.edu>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "writer.h"
+#include "backend.h"
+
+void to_string(const WriterBackend& value, string& result) {
+    switch(value) {
+        case WriterBackend::STANDARD:   result.assign("standard");  break;
+        case WriterBackend::BATCHED:    result.assign("batched");   break;
+        case WriterBackend::PWRITE:     result.assign("pwrite");    break;
+        default:                        result.assign("unknown");   break;
+    }
+};
+bool from_string(const char* value, WriterBackend& result) {
+         if(value == NULL)                  result = WriterBackend::STANDARD;
+    else if(!strcmp(value, "standard"))     result = WriterBackend::STANDARD;
+    else if(!strcmp(value, "batched"))      result = WriterBackend::BATCHED;
+    else if(!strcmp(value, "pwrite"))       result = WriterBackend::PWRITE;
+    else                                    result = WriterBackend::UNKNOWN;
+
+    return (result == WriterBackend::UNKNOWN ? false : true);
+};
+bool from_string(const string& value, WriterBackend& result) {
+    return from_string(value.c_str(), result);
+};
+ostream& operator<<(ostream& o, const WriterBackend& value) {
+    string string_value;
+    to_string(value, string_value);
+    o << string_value;
+    return o;
+};
+void encode_key_value(const string& key, const WriterBackend& value, Value& container, Document& document) {
+    string string_value;
+    to_string(value, string_value);
+    Value v(string_value.c_str(), string_value.length(), document.GetAllocator());
+    Value k(key.c_str(), key.size(), document.GetAllocator());
+    container.RemoveMember(key.c_str());
+    container.AddMember(k.Move(), v.Move(), document.GetAllocator());
+};
+template<> bool decode_value_by_key< WriterBackend >(const Value::Ch* key, WriterBackend& value, const Value& container) {
+    Value::ConstMemberIterator element = container.FindMember(key);
+    if(element != container.MemberEnd() && !element->value.IsNull()) {
+        if(element->value.IsString()) {
+            return from_string(element->value.GetString(), value);
+        } else { throw ConfigurationError(string(key) + " element must be a string"); }
+    }
+    return false;
+};
+
+/*  hFILE backend writing through a BatchWriter.
+    offset is the file position of the next write, pending and error are guarded by the writer queue mutex */
+struct BatchedFile {
+    hFILE base;
+    BatchWriter* writer;
+    int descriptor;
+    off_t offset;
+    size_t pending;
+    int error;
+};
+
+#if defined(PHENIQS_IO_URING)
+IoUring::IoUring() :
+    capacity(0),
+    descriptor(-1),
+    submission_map(MAP_FAILED),
+    submission_map_size(0),
+    completion_map(MAP_FAILED),
+    completion_map_size(0),
+    submission_entry(static_cast< struct io_uring_sqe* >(MAP_FAILED)),
+    submission_entry_size(0),
+    submission_head(NULL),
+    submission_tail(NULL),
+    submission_mask(NULL),
+    submission_array(NULL),
+    completion_head(NULL),
+    completion_tail(NULL),
+    completion_mask(NULL),
+    completion_entry(NULL) {
+};
+IoUring::~IoUring() {
+    if(submission_entry != MAP_FAILED) {
+        munmap(submission_entry, submission_entry_size);
+    }
+    if(completion_map != MAP_FAILED && completion_map != submission_map) {
+        munmap(completion_map, completion_map_size);
+    }
+    if(submission_map != MAP_FAILED) {
+        munmap(submission_map, submission_map_size);
+    }
+    if(descriptor >= 0) {
+        close(descriptor);
+    }
+};
+bool IoUring::open(const unsigned& depth) {
+    /*  io_uring may be missing from the kernel, disabled by the administrator or blocked by seccomp
+        in which case the caller falls back to pwrite */
+    struct io_uring_params parameters;
+    memset(&parameters, 0, sizeof(struct io_uring_params));
+    descriptor = static_cast< int >(syscall(__NR_io_uring_setup, depth, &parameters));
+    if(descriptor < 0) {
+        return false;
+    }
+
+    submission_map_size = parameters.sq_off.array + parameters.sq_entries * sizeof(unsigned);
+    completion_map_size = parameters.cq_off.cqes + parameters.cq_entries * sizeof(struct io_uring_cqe);
+    if(parameters.features & IORING_FEAT_SINGLE_MMAP) {
+        submission_map_size = max(submission_map_size, completion_map_size);
+        completion_map_size = submission_map_size;
+    }
+    submission_map = mmap(NULL, submission_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, descriptor, IORING_OFF_SQ_RING);
+    if(submission_map == MAP_FAILED) {
+        return false;
+    }
+    if(parameters.features & IORING_FEAT_SINGLE_MMAP) {
+        completion_map = submission_map;
+    } else {
+        completion_map = mmap(NULL, completion_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, descriptor, IORING_OFF_CQ_RING);
+        if(completion_map == MAP_FAILED) {
+            return false;
+        }
+    }
+    submission_entry_size = parameters.sq_entries * sizeof(struct io_uring_sqe);
+    submission_entry = static_cast< struct io_uring_sqe* >(mmap(NULL, submission_entry_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, descriptor, IORING_OFF_SQES));
+    if(submission_entry == MAP_FAILED) {
+        return false;
+    }
+
+    uint8_t* submission(static_cast< uint8_t* >(submission_map));
+    submission_head = reinterpret_cast< unsigned* >(submission + parameters.sq_off.head);
+    submission_tail = reinterpret_cast< unsigned* >(submission + parameters.sq_off.tail);
+    submission_mask = reinterpret_cast< unsigned* >(submission + parameters.sq_off.ring_mask);
+    submission_array = reinterpret_cast< unsigned* >(submission + parameters.sq_off.array);
+
+    uint8_t* completion(static_cast< uint8_t* >(completion_map));
+    completion_head = reinterpret_cast< unsigned* >(completion + parameters.cq_off.head);
+    completion_tail = reinterpret_cast< unsigned* >(completion + parameters.cq_off.tail);
+    completion_mask = reinterpret_cast< unsigned* >(completion + parameters.cq_off.ring_mask);
+    completion_entry = reinterpret_cast< struct io_uring_cqe* >(completion + parameters.cq_off.cqes);
+
+    capacity = parameters.sq_entries;
+    return true;
+};
+void IoUring::prepare_write(WriteRequest* request) {
+    const unsigned tail(*submission_tail);
+    const unsigned index(tail & *submission_mask);
+    struct io_uring_sqe* entry(submission_entry + index);
+
+    request->vector.iov_base = request->data + request->written;
+    request->vector.iov_len = request->size - request->written;
+
+    memset(entry, 0, sizeof(struct io_uring_sqe));
+    entry->opcode = IORING_OP_WRITEV;
+    entry->fd = request->descriptor;
+    entry->addr = reinterpret_cast< uint64_t >(&request->vector);
+    entry->len = 1;
+    entry->off = static_cast< uint64_t >(request->offset) + request->written;
+    entry->user_data = reinterpret_cast< uint64_t >(request);
+    submission_array[index] = index;
+
+    /* the kernel must see the entry before the tail that publishes it */
+    __atomic_store_n(submission_tail, tail + 1, __ATOMIC_RELEASE);
+};
+unsigned IoUring::unsubmitted() const {
+    return *submission_tail - __atomic_load_n(submission_head, __ATOMIC_ACQUIRE);
+};
+int IoUring::enter(const unsigned& submit, const unsigned& wait) {
+    int submitted(0);
+    do {
+        submitted = static_cast< int >(syscall(__NR_io_uring_enter, descriptor, submit, wait, wait > 0 ? IORING_ENTER_GETEVENTS : 0, NULL, 0));
+    } while(submitted < 0 && errno == EINTR);
+    return submitted;
+};
+bool IoUring::reap(WriteRequest*& request, int32_t& result) {
+    const unsigned head(*completion_head);
+    if(head != __atomic_load_n(completion_tail, __ATOMIC_ACQUIRE)) {
+        const struct io_uring_cqe* entry(completion_entry + (head & *completion_mask));
+        request = reinterpret_cast< WriteRequest* >(entry->user_data);
+        result = entry->res;
+        __atomic_store_n(completion_head, head + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+    return false;
+};
+#endif
+
+BatchWriter::BatchWriter(const WriterBackend& backend, const int32_t& threads) try :
+    _backend(backend),
+    queued_bytes(0),
+    stopped(false),
+    failure_code(0),
+    request_count(0),
+    byte_count(0),
+    system_call_count(0),
+    accumulated_latency(0),
+    maximum_latency(0) {
+
+    if(_backend == WriterBackend::BATCHED) {
+        #if defined(PHENIQS_IO_URING)
+        if(ring.open(BATCH_WRITER_RING_DEPTH)) {
+            thread_pool.emplace_back(&BatchWriter::run_io_uring, this);
+        } else {
+            _backend = WriterBackend::PWRITE;
+        }
+        #else
+        _backend = WriterBackend::PWRITE;
+        #endif
+    }
+    if(_backend == WriterBackend::PWRITE) {
+        for(int32_t i(0); i < max(threads, 1); ++i) {
+            thread_pool.emplace_back(&BatchWriter::run_pwrite, this);
+        }
+    }
+    if(thread_pool.empty()) {
+        throw ConfigurationError("output writer must be batched or pwrite");
+    }
+
+    } catch(ConfigurationError& error) {
+        throw ConfigurationError("BatchWriter :: " + error.message);
+
+    } catch(exception& error) {
+        throw InternalError("BatchWriter :: " + string(error.what()));
+};
+BatchWriter::~BatchWriter() {
+    {
+        lock_guard< mutex > queue_lock(queue_mutex);
+        stopped = true;
+    }
+    queue_not_empty.notify_all();
+    for(auto& worker : thread_pool) {
+        worker.join();
+    }
+};
+bool BatchWriter::write(BatchedFile* file, const void* buffer, const size_t& size) {
+    /*  The hFILE reuses its buffer as soon as the write returns so the data is copied into the request */
+    WriteRequest* request(new WriteRequest());
+    if((request->data = static_cast< uint8_t* >(malloc(size))) == NULL) {
+        delete request;
+        throw OutOfMemoryError();
+    }
+    memcpy(request->data, buffer, size);
+    request->file = file;
+    request->descriptor = file->descriptor;
+    request->size = size;
+    request->written = 0;
+    request->offset = file->offset;
+
+    unique_lock< mutex > queue_lock(queue_mutex);
+    /* a single request larger than the queue capacity is admitted when the queue is empty */
+    queue_not_full.wait(queue_lock, [this, &size]() { return failure_code != 0 || queued_bytes == 0 || queued_bytes + size <= BATCH_WRITER_QUEUE_CAPACITY; });
+    if(failure_code != 0) {
+        errno = failure_code;
+        queue_lock.unlock();
+        free(request->data);
+        delete request;
+        return false;
+    }
+    file->offset += size;
+    request->queued = steady_clock::now();
+    queue.push_back(request);
+    queued_bytes += size;
+    ++(file->pending);
+    queue_lock.unlock();
+    queue_not_empty.notify_one();
+    return true;
+};
+int BatchWriter::drain(BatchedFile* file) {
+    /* writes still in the ring when it failed are never reaped so a failure ends the wait */
+    unique_lock< mutex > queue_lock(queue_mutex);
+    request_complete.wait(queue_lock, [this, file]() { return file->pending == 0 || failure_code != 0; });
+    return file->error != 0 ? file->error : failure_code;
+};
+void BatchWriter::rethrow() {
+    lock_guard< mutex > queue_lock(queue_mutex);
+    if(failure) {
+        rethrow_exception(failure);
+    }
+};
+void BatchWriter::complete(WriteRequest* request, const int& error, const uint64_t& system_calls) {
+    const double latency(duration< double >(steady_clock::now() - request->queued).count());
+    {
+        lock_guard< mutex > queue_lock(queue_mutex);
+        ++request_count;
+        byte_count += request->written;
+        system_call_count += system_calls;
+        accumulated_latency += latency;
+        maximum_latency = max(maximum_latency, latency);
+        queued_bytes -= request->size;
+        if(error != 0 && request->file->error == 0) {
+            request->file->error = error;
+        }
+        --(request->file->pending);
+    }
+    free(request->data);
+    delete request;
+    request_complete.notify_all();
+    queue_not_full.notify_all();
+};
+void BatchWriter::fail(const int& error, const string& message, list< WriteRequest* >& incomplete) {
+    /*  Fail the writes that were not yet submitted. Writes already in the ring are abandoned,
+        their buffers are leaked rather than released while the kernel may still read them */
+    {
+        lock_guard< mutex > queue_lock(queue_mutex);
+        failure_code = error;
+        failure = make_exception_ptr(IOError(message));
+        incomplete.splice(incomplete.end(), queue);
+    }
+    for(auto request : incomplete) {
+        complete(request, error, 0);
+    }
+    incomplete.clear();
+    request_complete.notify_all();
+    queue_not_full.notify_all();
+};
+void BatchWriter::run_pwrite() {
+    while(true) {
+        WriteRequest* request(NULL);
+        {
+            unique_lock< mutex > queue_lock(queue_mutex);
+            queue_not_empty.wait(queue_lock, [this]() { return stopped || !queue.empty(); });
+            if(queue.empty()) {
+                break;
+            }
+            request = queue.front();
+            queue.pop_front();
+        }
+
+        int error(0);
+        uint64_t system_calls(0);
+        while(request->written < request->size) {
+            ssize_t written(pwrite(request->descriptor, request->data + request->written, request->size - request->written, request->offset + request->written));
+            ++system_calls;
+            if(written > 0) {
+                request->written += written;
+            } else if(written < 0 && errno == EINTR) {
+                continue;
+            } else {
+                error = written < 0 ? errno : EIO;
+                break;
+            }
+        }
+        complete(request, error, system_calls);
+    }
+};
+void BatchWriter::run_io_uring() {
+    #if defined(PHENIQS_IO_URING)
+    /*  Every pass moves everything queued, up to the ring capacity, into the submission ring,
+        submits it and waits for at least one completion with a single io_uring_enter call.
+        The submission thread only blocks on the queue when nothing is in flight.
+        Short writes are resubmitted for the remainder */
+    unsigned in_flight(0);
+    list< WriteRequest* > incomplete;
+    while(true) {
+        {
+            unique_lock< mutex > queue_lock(queue_mutex);
+            if(in_flight == 0 && incomplete.empty()) {
+                queue_not_empty.wait(queue_lock, [this]() { return stopped || !queue.empty(); });
+                if(queue.empty()) {
+                    break;
+                }
+            }
+            while(!queue.empty() && in_flight + incomplete.size() < ring.capacity) {
+                incomplete.push_back(queue.front());
+                queue.pop_front();
+            }
+        }
+        for(auto request : incomplete) {
+            ring.prepare_write(request);
+            ++in_flight;
+        }
+        incomplete.clear();
+
+        if(ring.enter(ring.unsubmitted(), 1) < 0) {
+            if(errno != EBUSY && errno != EAGAIN) {
+                const int error(errno);
+                fail(error, "io_uring submission failed " + string(strerror(error)), incomplete);
+                break;
+            }
+        }
+        ++system_call_count;
+
+        WriteRequest* request(NULL);
+        int32_t result(0);
+        while(ring.reap(request, result)) {
+            --in_flight;
+            if(result > 0) {
+                request->written += result;
+                if(request->written < request->size) {
+                    incomplete.push_back(request);
+                } else {
+                    complete(request, 0, 0);
+                }
+            } else if(result == -EINTR || result == -EAGAIN) {
+                incomplete.push_back(request);
+            } else {
+                complete(request, result < 0 ? -result : EIO, 0);
+            }
+        }
+    }
+    #endif
+};
+void BatchWriter::encode(Value& container, Document& document) const {
+    encode_key_value("backend", _backend == WriterBackend::BATCHED ? string("io_uring") : string("pwrite"), container, document);
+    encode_key_value("threads", static_cast< int32_t >(thread_pool.size()), container, document);
+    encode_key_value("requests", request_count, container, document);
+    encode_key_value("bytes", byte_count, container, document);
+    encode_key_value("system calls", system_call_count, container, document);
+    if(request_count > 0) {
+        encode_key_value("requests per system call", static_cast< double >(request_count) / static_cast< double >(max(system_call_count, uint64_t(1))), container, document);
+        encode_key_value("mean latency", accumulated_latency / static_cast< double >(request_count), container, document);
+        encode_key_value("maximum latency", maximum_latency, container, document);
+    }
+};
+
+static ssize_t batched_read(hFILE*, void*, size_t) {
+    errno = EBADF;
+    return -1;
+};
+static ssize_t batched_write(hFILE* fp, const void* buffer, size_t nbytes) {
+    BatchedFile* file(reinterpret_cast< BatchedFile* >(fp));
+    try {
+        if(file->writer->write(file, buffer, nbytes)) {
+            return static_cast< ssize_t >(nbytes);
+        }
+        return -1;
+    } catch(OutOfMemoryError&) {
+        errno = ENOMEM;
+        return -1;
+    }
+};
+static off_t batched_seek(hFILE* fp, off_t offset, int whence) {
+    BatchedFile* file(reinterpret_cast< BatchedFile* >(fp));
+    int error(file->writer->drain(file));
+    if(error != 0) {
+        errno = error;
+        return -1;
+    }
+    switch(whence) {
+        case SEEK_SET:
+            file->offset = offset;
+            break;
+        case SEEK_CUR:
+            file->offset += offset;
+            break;
+        case SEEK_END: {
+            off_t end(lseek(file->descriptor, 0, SEEK_END));
+            if(end < 0) {
+                return -1;
+            }
+            file->offset = end + offset;
+            break;
+        };
+        default:
+            errno = EINVAL;
+            return -1;
+    }
+    return file->offset;
+};
+static int batched_flush(hFILE* fp) {
+    BatchedFile* file(reinterpret_cast< BatchedFile* >(fp));
+    int error(file->writer->drain(file));
+    if(error != 0) {
+        errno = error;
+        return -1;
+    }
+    return 0;
+};
+static int batched_close(hFILE* fp) {
+    BatchedFile* file(reinterpret_cast< BatchedFile* >(fp));
+    int error(file->writer->drain(file));
+    int closed(close(file->descriptor));
+    if(error != 0) {
+        errno = error;
+        return -1;
+    }
+    return closed;
+};
+static const struct hFILE_backend batched_backend = {
+    batched_read,
+    batched_write,
+    batched_seek,
+    batched_flush,
+    batched_close
+};
+hFILE* hopen_batched(const string& path, BatchWriter* writer, const int64_t& offset) {
+    int descriptor(open(path.c_str(), O_WRONLY | O_CREAT | (offset < 0 ? O_TRUNC : 0), 0666));
+    if(descriptor < 0) {
+        return NULL;
+    }
+    BatchedFile* file(reinterpret_cast< BatchedFile* >(hfile_init(sizeof(BatchedFile), "w", BATCH_WRITE_CAPACITY)));
+    if(file == NULL) {
+        close(descriptor);
+        return NULL;
+    }
+    file->writer = writer;
+    file->descriptor = descriptor;
+    file->offset = offset < 0 ? 0 : static_cast< off_t >(offset);
+    file->pending = 0;
+    file->error = 0;
+    file->base.backend = &batched_backend;
+    return &file->base;
+};
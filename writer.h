@@ -0,0 +1,182 @@
+/*
+    Pheniqs : PHilology ENcoder wIth Quality Statistics
+    Copyright (C) 2018  Lior Galanti
+    NYU Center for Genetics and System Biology
+
+    Author: Lior Galanti <lior.galanti@nyu.edu>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PHENIQS_WRITER_H
+#define PHENIQS_WRITER_H
+
+#include "include.h"
+#include "error.h"
+#include "json.h"
+
+#include <sys/stat.h>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define PHENIQS_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#if !defined(__NR_io_uring_setup) || !defined(__NR_io_uring_enter)
+#undef PHENIQS_IO_URING
+#endif
+#endif
+#endif
+
+/*  Size of the hFILE buffer of a batched output file, the largest write submitted to the writer */
+const size_t BATCH_WRITE_CAPACITY(1024 * 1024);
+
+/*  Bytes that may be queued or in flight before writing output files blocks */
+const size_t BATCH_WRITER_QUEUE_CAPACITY(256 * 1024 * 1024);
+
+/*  Submission queue entries in the io_uring */
+const unsigned BATCH_WRITER_RING_DEPTH(256);
+
+/*  Threads in the pwrite pool when writer threads is not specified */
+const int32_t BATCH_WRITER_THREADS(4);
+
+/*  How output files are written
+
+    standard    every output feed writes its own file with blocking write calls
+    batched     writes from all output files are submitted together through io_uring, or pwrite if unavailable
+    pwrite      writes from all output files are queued to a pool of pwrite threads
+*/
+enum class WriterBackend : uint8_t {
+    UNKNOWN,
+    STANDARD,
+    BATCHED,
+    PWRITE,
+};
+void to_string(const WriterBackend& value, string& result);
+bool from_string(const char* value, WriterBackend& result);
+bool from_string(const string& value, WriterBackend& result);
+ostream& operator<<(ostream& o, const WriterBackend& value);
+void encode_key_value(const string& key, const WriterBackend& value, Value& container, Document& document);
+template<> bool decode_value_by_key< WriterBackend >(const Value::Ch* key, WriterBackend& value, const Value& container);
+
+struct BatchedFile;
+
+struct WriteRequest {
+    BatchedFile* file;
+    int descriptor;
+    uint8_t* data;
+    size_t size;
+    size_t written;
+    off_t offset;
+    steady_clock::time_point queued;
+    struct iovec vector;
+};
+
+#if defined(PHENIQS_IO_URING)
+/*  Minimal io_uring submission and completion ring over the raw system calls, liburing is not required */
+class IoUring {
+    IoUring(IoUring const &) = delete;
+    void operator=(IoUring const &) = delete;
+
+    public:
+        unsigned capacity;
+        IoUring();
+        ~IoUring();
+        bool open(const unsigned& depth);
+        void prepare_write(WriteRequest* request);
+        int enter(const unsigned& submit, const unsigned& wait);
+        bool reap(WriteRequest*& request, int32_t& result);
+        unsigned unsubmitted() const;
+
+    private:
+        int descriptor;
+        void* submission_map;
+        size_t submission_map_size;
+        void* completion_map;
+        size_t completion_map_size;
+        struct io_uring_sqe* submission_entry;
+        size_t submission_entry_size;
+        unsigned* submission_head;
+        unsigned* submission_tail;
+        unsigned* submission_mask;
+        unsigned* submission_array;
+        unsigned* completion_head;
+        unsigned* completion_tail;
+        unsigned* completion_mask;
+        struct io_uring_cqe* completion_entry;
+};
+#endif
+
+/*  Output writer shared by all output files of a job
+
+    Every output file of a demultiplexing run is written by its own feed thread, and with hundreds of
+    output files the many small blocking writes cost more in system calls and context switches than the
+    IO itself. Output files opened through the batched writer hand completed buffers, whole BGZF blocks
+    or the hFILE buffer for uncompressed output, to a single queue. One submission thread drains the
+    queue into an io_uring, submitting the writes of all files with a single system call, and reaps
+    their completions. When io_uring is not available a small pool of threads writes the queue with pwrite.
+    Writes carry their file offset so they may complete in any order, and flushing or closing a file
+    waits for its outstanding writes. If the ring itself fails the error is recorded instead of thrown
+    on the submission thread, every later write, flush or close fails with it and rethrow raises it
+    on the calling thread.
+*/
+class BatchWriter {
+    BatchWriter(BatchWriter const &) = delete;
+    void operator=(BatchWriter const &) = delete;
+
+    public:
+        BatchWriter(const WriterBackend& backend, const int32_t& threads);
+        ~BatchWriter();
+        /*  backend actually used, BATCHED when writes are submitted through io_uring */
+        WriterBackend backend() const {
+            return _backend;
+        };
+        bool write(BatchedFile* file, const void* buffer, const size_t& size);
+        int drain(BatchedFile* file);
+        void rethrow();
+        void encode(Value& container, Document& document) const;
+
+    private:
+        WriterBackend _backend;
+        mutex queue_mutex;
+        condition_variable queue_not_empty;
+        condition_variable queue_not_full;
+        condition_variable request_complete;
+        list< WriteRequest* > queue;
+        size_t queued_bytes;
+        bool stopped;
+        int failure_code;
+        exception_ptr failure;
+        vector< thread > thread_pool;
+        #if defined(PHENIQS_IO_URING)
+        IoUring ring;
+        #endif
+        uint64_t request_count;
+        uint64_t byte_count;
+        uint64_t system_call_count;
+        double accumulated_latency;
+        double maximum_latency;
+        void complete(WriteRequest* request, const int& error, const uint64_t& system_calls);
+        void fail(const int& error, const string& message, list< WriteRequest* >& incomplete);
+        void run_pwrite();
+        void run_io_uring();
+};
+
+/*  hFILE writing to a file through a BatchWriter.
+    offset is where writing starts in an existing file, used when resuming, otherwise the file is truncated.
+    Returns NULL if the file can not be opened */
+hFILE* hopen_batched(const string& path, BatchWriter* writer, const int64_t& offset=-1);
+
+#endif /* PHENIQS_WRITER_H */
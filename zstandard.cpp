@@ -0,0 +1,233 @@
+/*
+    Pheniqs : PHilology ENcoder wIth Quality Statistics
+    Copyright (C) 2018  Lior Galanti
+    NYU Center for Genetics and System Biology
+
+    Author: Lior Galanti <lior.galanti@nyu.edu>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "zstandard.h"
+#include "backend.h"
+
+bool is_zstd(hFILE* hfile) {
+    uint8_t magic[4];
+    return
+        hfile != NULL &&
+        hpeek(hfile, magic, 4) == 4 &&
+        magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd;
+};
+
+#if defined(PHENIQS_ZSTD)
+typedef struct {
+    hFILE base;
+    hFILE* source;
+    ZSTD_DStream* stream;
+    uint8_t* input;
+    size_t input_capacity;
+    ZSTD_inBuffer buffer;
+    bool end_of_input;
+    bool frame_complete;
+} hFILE_zstd_reader;
+
+static ssize_t zstd_reader_read(hFILE* fp, void* buffer, size_t nbytes) {
+    hFILE_zstd_reader* reader(reinterpret_cast< hFILE_zstd_reader* >(fp));
+    ZSTD_outBuffer output = { buffer, nbytes, 0 };
+    while(output.pos == 0 && !(reader->end_of_input && reader->buffer.pos == reader->buffer.size)) {
+        if(reader->buffer.pos == reader->buffer.size) {
+            ssize_t consumed(hread(reader->source, reader->input, reader->input_capacity));
+            if(consumed < 0) {
+                return -1;
+            } else if(consumed == 0) {
+                reader->end_of_input = true;
+                break;
+            }
+            reader->buffer.size = static_cast< size_t >(consumed);
+            reader->buffer.pos = 0;
+        }
+        const size_t code(ZSTD_decompressStream(reader->stream, &output, &reader->buffer));
+        if(ZSTD_isError(code)) {
+            errno = EIO;
+            return -1;
+        }
+        reader->frame_complete = (code == 0);
+    }
+    if(output.pos == 0 && reader->end_of_input && !reader->frame_complete) {
+        /* the stream ended in the middle of a frame */
+        errno = EIO;
+        return -1;
+    }
+    return static_cast< ssize_t >(output.pos);
+};
+static ssize_t zstd_reader_write(hFILE*, const void*, size_t) {
+    errno = EBADF;
+    return -1;
+};
+static off_t zstd_reader_seek(hFILE*, off_t, int) {
+    errno = ESPIPE;
+    return -1;
+};
+static int zstd_reader_close(hFILE* fp) {
+    hFILE_zstd_reader* reader(reinterpret_cast< hFILE_zstd_reader* >(fp));
+    ZSTD_freeDStream(reader->stream);
+    free(reader->input);
+    return hclose(reader->source);
+};
+static const struct hFILE_backend zstd_reader_backend = {
+    zstd_reader_read,
+    zstd_reader_write,
+    zstd_reader_seek,
+    NULL,
+    zstd_reader_close
+};
+hFILE* hopen_zstd_reader(hFILE* source) {
+    hFILE_zstd_reader* fp(reinterpret_cast< hFILE_zstd_reader* >(hfile_init(sizeof(hFILE_zstd_reader), "r", ZSTD_DStreamOutSize())));
+    if(fp == NULL) {
+        throw OutOfMemoryError();
+    }
+    fp->input_capacity = ZSTD_DStreamInSize();
+    if((fp->input = static_cast< uint8_t* >(malloc(fp->input_capacity))) == NULL || (fp->stream = ZSTD_createDStream()) == NULL) {
+        free(fp->input);
+        hfile_destroy(&fp->base);
+        throw OutOfMemoryError();
+    }
+    ZSTD_initDStream(fp->stream);
+    fp->source = source;
+    fp->buffer = { fp->input, 0, 0 };
+    fp->end_of_input = false;
+    fp->frame_complete = true;
+    fp->base.backend = &zstd_reader_backend;
+    return &fp->base;
+};
+
+typedef struct {
+    hFILE base;
+    hFILE* sink;
+    ZSTD_CCtx* context;
+    uint8_t* output;
+    size_t output_capacity;
+    bool pending;
+    uint64_t frame_count;
+} hFILE_zstd_writer;
+
+/*  compress input, or only drain the context when input is empty, and write the compressed bytes to the sink.
+    with ZSTD_e_end the call returns when the frame is complete */
+static int zstd_writer_compress(hFILE_zstd_writer* writer, ZSTD_inBuffer& input, const ZSTD_EndDirective& directive) {
+    size_t remaining(0);
+    do {
+        ZSTD_outBuffer output = { writer->output, writer->output_capacity, 0 };
+        remaining = ZSTD_compressStream2(writer->context, &output, &input, directive);
+        if(ZSTD_isError(remaining)) {
+            errno = EIO;
+            return -1;
+        }
+        if(output.pos > 0 && hwrite(writer->sink, writer->output, output.pos) != static_cast< ssize_t >(output.pos)) {
+            return -1;
+        }
+    } while(directive == ZSTD_e_continue ? input.pos < input.size : remaining != 0);
+    return 0;
+};
+static int zstd_writer_end_frame(hFILE_zstd_writer* writer) {
+    ZSTD_inBuffer input = { NULL, 0, 0 };
+    if(zstd_writer_compress(writer, input, ZSTD_e_end) < 0) {
+        return -1;
+    }
+    writer->pending = false;
+    ++(writer->frame_count);
+    return 0;
+};
+static ssize_t zstd_writer_read(hFILE*, void*, size_t) {
+    errno = EBADF;
+    return -1;
+};
+static ssize_t zstd_writer_write(hFILE* fp, const void* buffer, size_t nbytes) {
+    hFILE_zstd_writer* writer(reinterpret_cast< hFILE_zstd_writer* >(fp));
+    ZSTD_inBuffer input = { buffer, nbytes, 0 };
+    if(zstd_writer_compress(writer, input, ZSTD_e_continue) < 0) {
+        return -1;
+    }
+    writer->pending = writer->pending || nbytes > 0;
+    return static_cast< ssize_t >(nbytes);
+};
+static off_t zstd_writer_seek(hFILE*, off_t, int) {
+    errno = ESPIPE;
+    return -1;
+};
+static int zstd_writer_flush(hFILE* fp) {
+    hFILE_zstd_writer* writer(reinterpret_cast< hFILE_zstd_writer* >(fp));
+    if(writer->pending && zstd_writer_end_frame(writer) < 0) {
+        return -1;
+    }
+    return hflush(writer->sink);
+};
+static int zstd_writer_close(hFILE* fp) {
+    hFILE_zstd_writer* writer(reinterpret_cast< hFILE_zstd_writer* >(fp));
+
+    /* an empty output is written as a single empty frame so it is still a valid zstd file */
+    int error(0);
+    if(writer->pending || writer->frame_count == 0) {
+        error = zstd_writer_end_frame(writer);
+    }
+    ZSTD_freeCCtx(writer->context);
+    free(writer->output);
+    if(hclose(writer->sink) < 0) {
+        error = -1;
+    }
+    return error;
+};
+static const struct hFILE_backend zstd_writer_backend = {
+    zstd_writer_read,
+    zstd_writer_write,
+    zstd_writer_seek,
+    zstd_writer_flush,
+    zstd_writer_close
+};
+hFILE* hopen_zstd_writer(hFILE* sink, const int32_t& level, const int32_t& threads) {
+    hFILE_zstd_writer* fp(reinterpret_cast< hFILE_zstd_writer* >(hfile_init(sizeof(hFILE_zstd_writer), "w", ZSTD_CStreamInSize())));
+    if(fp == NULL) {
+        throw OutOfMemoryError();
+    }
+    fp->output_capacity = ZSTD_CStreamOutSize();
+    if((fp->output = static_cast< uint8_t* >(malloc(fp->output_capacity))) == NULL || (fp->context = ZSTD_createCCtx()) == NULL) {
+        free(fp->output);
+        hfile_destroy(&fp->base);
+        throw OutOfMemoryError();
+    }
+    if(ZSTD_isError(ZSTD_CCtx_setParameter(fp->context, ZSTD_c_compressionLevel, level))) {
+        ZSTD_freeCCtx(fp->context);
+        free(fp->output);
+        hfile_destroy(&fp->base);
+        throw ConfigurationError("invalid zstd compression level " + to_string(level));
+    }
+
+    /*  a libzstd built without multithreading support rejects workers and compresses in the calling thread */
+    if(threads > 0) {
+        ZSTD_CCtx_setParameter(fp->context, ZSTD_c_nbWorkers, threads);
+    }
+    fp->sink = sink;
+    fp->pending = false;
+    fp->frame_count = 0;
+    fp->base.backend = &zstd_writer_backend;
+    return &fp->base;
+};
+
+#else
+hFILE* hopen_zstd_reader(hFILE*) {
+    throw ConfigurationError("pheniqs was built without zstd support");
+};
+hFILE* hopen_zstd_writer(hFILE*, const int32_t&, const int32_t&) {
+    throw ConfigurationError("pheniqs was built without zstd support");
+};
+#endif
@@ -0,0 +1,53 @@
+/*
+    Pheniqs : PHilology ENcoder wIth Quality Statistics
+    Copyright (C) 2018  Lior Galanti
+    NYU Center for Genetics and System Biology
+
+    Author: Lior Galanti <lior.galanti@nyu.edu>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PHENIQS_ZSTANDARD_H
+#define PHENIQS_ZSTANDARD_H
+
+#include "include.h"
+#include "error.h"
+
+/*  Zstandard support is optional, build with `make with-zstd=1` or have libzstd in LIB_PREFIX */
+#if defined(PHENIQS_ZSTD)
+#include <zstd.h>
+#endif
+
+/*  Compression level used for zstd output unless specified otherwise */
+const int32_t DEFAULT_ZSTD_LEVEL(3);
+
+/*  true if the next bytes in hfile are a zstd frame magic number, hfile is not consumed */
+bool is_zstd(hFILE* hfile);
+
+/*  Zstandard compressed FASTQ
+
+    zstd streams are layered under bgzf as an hFILE, so bgzf reads and writes uncompressed
+    FASTQ through them and kseq and the feed code are unchanged.
+
+    hopen_zstd_reader decompresses the stream in source, which may be any number of concatenated frames.
+    hopen_zstd_writer compresses with level into sink, using threads zstd worker threads when threads is positive.
+    Every hflush ends the current frame, so a file truncated at a checkpoint is a complete stream
+    that can be appended to when resuming.
+    Both take ownership of the wrapped hFILE and close it when they are closed.
+*/
+hFILE* hopen_zstd_reader(hFILE* source);
+hFILE* hopen_zstd_writer(hFILE* sink, const int32_t& level, const int32_t& threads);
+
+#endif /* PHENIQS_ZSTANDARD_H */